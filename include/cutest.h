@@ -277,6 +277,8 @@ extern "C" {
                 (void(*)(void*, unsigned long))cb);\
             cutest_case_convert_parameterized(&s_tests[i],\
                 #TYPE, TEST_STRINGIFY(__VA_ARGS__), (void*)s_parameterized_userdata, i);\
+            s_tests[i].info.file = __FILE__;\
+            s_tests[i].info.line = __LINE__;\
             cutest_register_case(&s_tests[i]);\
         }\
     }\
@@ -343,6 +345,8 @@ extern "C" {
             s_cutest_fixture_setup_##fixture,\
             s_cutest_fixture_teardown_##fixture,\
             s_cutest_proxy_##fixture##_##test);\
+        _case_##fixture##_##test.info.file = __FILE__;\
+        _case_##fixture##_##test.info.line = __LINE__;\
         cutest_register_case(&_case_##fixture##_##test);\
     }\
     TEST_C_API void cutest_usertest_body_##fixture##_##test(void)
@@ -368,6 +372,8 @@ extern "C" {
         static cutest_case_t _case_##fixture##_##test;\
         cutest_case_init(&_case_##fixture##_##test, #fixture,#test,\
             NULL, NULL, s_cutest_proxy_##fixture##_##test);\
+        _case_##fixture##_##test.info.file = __FILE__;\
+        _case_##fixture##_##test.info.line = __LINE__;\
         cutest_register_case(&_case_##fixture##_##test);\
     }\
     TEST_C_API void cutest_usertest_body_##fixture##_##test(void)
@@ -715,6 +721,35 @@ typedef void (*cutest_test_case_teardown_fn)(void);
  */
 typedef void (*cutest_test_case_body_fn)(void* dat, unsigned long idx);
 
+/**
+ * @brief Resource usage of a test case.
+ * @see cutest_get_current_usage()
+ */
+typedef struct cutest_usage
+{
+    unsigned long                       maxrss;         /**< Growth of maximum resident set size in kilobytes. */
+    unsigned long                       minflt;         /**< Minor page faults. */
+    unsigned long                       majflt;         /**< Major page faults. */
+    unsigned long                       nvcsw;          /**< Voluntary context switches. */
+    unsigned long                       nivcsw;         /**< Involuntary context switches. */
+    unsigned long                       inblock;        /**< Block input operations. */
+    unsigned long                       oublock;        /**< Block output operations. */
+} cutest_usage_t;
+
+/**
+ * @brief I/O counters of a test case, as in `/proc/self/io`.
+ * @see cutest_get_current_io()
+ */
+typedef struct cutest_io
+{
+    unsigned long                       rchar;          /**< Bytes read by read-like system calls. */
+    unsigned long                       wchar;          /**< Bytes written by write-like system calls. */
+    unsigned long                       syscr;          /**< Read system calls. */
+    unsigned long                       syscw;          /**< Write system calls. */
+    unsigned long                       read_bytes;     /**< Bytes fetched from the storage layer. */
+    unsigned long                       write_bytes;    /**< Bytes sent to the storage layer. */
+} cutest_io_t;
+
 typedef struct cutest_case
 {
     cutest_map_node_t                   node;           /**< Node in rbtree. */
@@ -723,6 +758,8 @@ typedef struct cutest_case
     {
         const char*                     fixture_name;   /**< suit name. */
         const char*                     case_name;      /**< case name. */
+        const char*                     file;           /**< Source file of definition, can be NULL. */
+        int                             line;           /**< Source line of definition. */
     } info;
 
     struct
@@ -736,6 +773,19 @@ typedef struct cutest_case
     {
         unsigned long                   mask;           /**< Internal mask. */
         unsigned long                   randkey;        /**< Random key. */
+        double                          elapsed;        /**< Elapsed nanoseconds of last run. */
+
+        struct
+        {
+            unsigned long               count;          /**< The number of runs. */
+            double                      min;            /**< Minimum elapsed nanoseconds. */
+            double                      max;            /**< Maximum elapsed nanoseconds. */
+            double                      mean;           /**< Mean elapsed nanoseconds. */
+            double                      m2;             /**< Sum of squares of differences from mean. */
+        } stat;                                         /**< Elapsed time statistics across iterations. */
+
+        cutest_usage_t                  usage;          /**< Resource usage of last run. */
+        cutest_io_t                     io;             /**< I/O counters of last run. */
     } data;
 
     struct
@@ -745,6 +795,15 @@ typedef struct cutest_case
         void*                           param_data;     /**< Data passed to #cutest_case_t::stage::body */
         unsigned long                   param_idx;      /**< Index passed to #cutest_case_t::stage::body */
     } parameterized;
+
+    struct
+    {
+        int                             type;           /**< Benchmark type. See #cutest_bench_type_t. */
+        unsigned long                   rate;           /**< Arrival rate per second of load test. */
+        unsigned long                   duration;       /**< Duration in milliseconds of load test. */
+        unsigned long                   budget;         /**< Time budget in milliseconds of test body, 0 if none. */
+        int                             noalloc;        /**< Test body must not allocate memory. */
+    } bench;
 } cutest_case_t;
 
 /**
@@ -808,6 +867,795 @@ CUTEST_API void cutest_unregister_case(
  * @}
  */
 
+/**
+ * @defgroup TEST_BENCHMARK Benchmark
+ *
+ * A benchmark is a test whose body is one iteration of the code to measure.
+ * The body is called repeatedly, and the number of iterations is calibrated
+ * until one measurement takes at least `--test_bench_min_time` milliseconds.
+ *
+ * ```c
+ * TEST_FIXTURE_SETUP(foo) {}
+ * TEST_FIXTURE_TEARDOWN(foo) {}
+ *
+ * TEST_BENCH(foo, memcpy) {
+ *     memcpy(s_dst, s_src, sizeof(s_src));
+ * }
+ * ```
+ *
+ * The output will be something like:
+ *
+ * ```
+ * [ RUN      ] foo.memcpy
+ * [ BENCH    ] 8388608 iterations, 13.417 ns/op
+ * [       OK ] foo.memcpy (113 ms)
+ * ```
+ *
+ * A multi-threaded benchmark defined by #TEST_BENCH_MT() runs its body in 1, 2,
+ * 4, ... threads up to the number of online CPUs (or `--test_bench_threads`),
+ * and reports the throughput, speedup and efficiency of each thread count, as
+ * well as the serial fraction fitted by Amdahl's law:
+ *
+ * ```
+ * [ RUN      ] foo.queue
+ * [ SCALING  ]  threads           ops/s   speedup  efficiency
+ * [ SCALING  ]        1     20370854.28     1.000      100.0%
+ * [ SCALING  ]        2     36193522.16     1.777       88.8%
+ * [ SCALING  ]        4     55610267.84     2.730       68.2%
+ * [ SCALING  ] amdahl serial fraction: 0.1552
+ * [       OK ] foo.queue (1294 ms)
+ * ```
+ *
+ * The latency of every iteration of #TEST_BENCH() is also recorded into a
+ * fixed-size log-linear histogram, and the tail percentiles are reported. For
+ * #TEST_BENCH_MT() every thread of the largest thread count records its own
+ * histogram, and they are merged into one report. Use `--test_bench_hgrm=DIR`
+ * to export the histogram in HdrHistogram format:
+ *
+ * ```
+ * [ LATENCY  ] p50 13 ns, p90 14 ns, p99 21 ns, p99.9 45 ns, max 20512 ns
+ * ```
+ *
+ * A benchmark judged on throughput can tell how much work one iteration does by
+ * #cutest_bench_set_bytes() and #cutest_bench_set_items(), so GB/s and items/s
+ * are printed next to the timing:
+ *
+ * ```
+ * [ BENCH    ] 8388608 iterations, 13.417 ns/op, 76.322 GB/s, 74533112.17 items/s
+ * ```
+ *
+ * A load test defined by #TEST_LOAD() calls its body on a fixed arrival
+ * schedule instead of back to back, and measures latency from the intended
+ * start time of each call, so a slow call is not hidden by delaying the calls
+ * behind it (coordinated omission):
+ *
+ * ```
+ * [ RUN      ] foo.handler
+ * [ LOAD     ] target 10000/s, achieved 9998.21/s, 20000 calls, backlog 0, max lag 3412 ns
+ * [ LATENCY  ] p50 812 ns, p90 1020 ns, p99 2944 ns, p99.9 17536 ns, max 40211 ns
+ * [       OK ] foo.handler (2001 ms)
+ * ```
+ *
+ * Before the first benchmark, the CPU model, scaling governor, turbo state and
+ * load average are printed (Linux only), with a warning for anything that makes
+ * results noisy. Use `--test_bench_cpu=N` to pin benchmarks to one CPU, and
+ * `--test_bench_warmup=MS` to warm up before measurement.
+ *
+ * @note Both #TEST_FIXTURE_SETUP() and #TEST_FIXTURE_TEARDOWN() are called once
+ *   per benchmark, not once per iteration.
+ *
+ * @warning The body of #TEST_BENCH_MT() runs in worker threads, where a failed
+ *   assertion aborts the program.
+ *
+ * @{
+ */
+
+/**
+ * @brief Benchmark type.
+ */
+typedef enum cutest_bench_type
+{
+    CUTEST_BENCH_NONE       = 0,    /**< Not a benchmark. */
+    CUTEST_BENCH_SINGLE     = 1,    /**< Single-threaded benchmark. */
+    CUTEST_BENCH_THREADED   = 2,    /**< Multi-threaded benchmark. */
+    CUTEST_BENCH_LOAD       = 3,    /**< Open-loop load test. */
+} cutest_bench_type_t;
+
+/**
+ * @brief Define a benchmark.
+ * @param [in] fixture  The name of fixture
+ * @param [in] test     The name of benchmark
+ * @see TEST_FIXTURE_SETUP
+ * @see TEST_FIXTURE_TEARDOWN
+ */
+#define TEST_BENCH(fixture, test) \
+    TEST_INTERNAL_BENCH(fixture, test, CUTEST_BENCH_SINGLE)
+
+/**
+ * @brief Define a multi-threaded benchmark.
+ *
+ * The body is called concurrently from every thread, and the benchmark is
+ * repeated for each thread count.
+ *
+ * @param [in] fixture  The name of fixture
+ * @param [in] test     The name of benchmark
+ * @see TEST_FIXTURE_SETUP
+ * @see TEST_FIXTURE_TEARDOWN
+ */
+#define TEST_BENCH_MT(fixture, test) \
+    TEST_INTERNAL_BENCH(fixture, test, CUTEST_BENCH_THREADED)
+
+/** @cond */
+#define TEST_INTERNAL_BENCH(fixture, test, type) \
+    TEST_INTERNAL_CONVERT(fixture, test, cutest_case_convert_benchmark(_test_case, type))
+
+/**
+ * @brief Define a test case and run \p convert on it before it is registered.
+ *   \p convert refers to the case as `_test_case`.
+ */
+#define TEST_INTERNAL_CONVERT(fixture, test, convert) \
+    TEST_C_API void cutest_usertest_body_##fixture##_##test(void);\
+    static void s_cutest_proxy_##fixture##_##test(void* _test_parameterized_data,\
+        unsigned long _test_parameterized_idx) {\
+        TEST_PARAMETERIZED_SUPPRESS_UNUSED;\
+        cutest_usertest_body_##fixture##_##test();\
+    }\
+    TEST_INITIALIZER(cutest_usertest_interface_##fixture##_##test) {\
+        static cutest_case_t _case_##fixture##_##test;\
+        cutest_case_t* _test_case = &_case_##fixture##_##test;\
+        cutest_case_init(_test_case, #fixture, #test,\
+            s_cutest_fixture_setup_##fixture,\
+            s_cutest_fixture_teardown_##fixture,\
+            s_cutest_proxy_##fixture##_##test);\
+        convert;\
+        _test_case->info.file = __FILE__;\
+        _test_case->info.line = __LINE__;\
+        cutest_register_case(_test_case);\
+    }\
+    TEST_C_API void cutest_usertest_body_##fixture##_##test(void)
+/** @endcond */
+
+/**
+ * @brief Define an open-loop load test.
+ *
+ * The body is called \p rate times per second on a fixed schedule for
+ * \p duration milliseconds. The latency of each call is measured from its
+ * intended start time, so queueing delay caused by slow calls is included.
+ *
+ * Calls that are still not issued when \p duration is over are reported as
+ * backlog, and counted in latency percentiles with the time they have waited.
+ *
+ * @param [in] fixture  The name of fixture
+ * @param [in] test     The name of load test
+ * @param [in] rate     Calls per second, must not be 0.
+ * @param [in] duration Duration in milliseconds, must not be 0.
+ * @see TEST_FIXTURE_SETUP
+ * @see TEST_FIXTURE_TEARDOWN
+ */
+#define TEST_LOAD(fixture, test, rate, duration) \
+    TEST_INTERNAL_CONVERT(fixture, test, cutest_case_convert_load(_test_case, rate, duration))
+
+/**
+ * @brief Convert normal test case to benchmark.
+ * @param[in,out] tc - Test case.
+ * @param[in] type - Benchmark type. See #cutest_bench_type_t.
+ */
+CUTEST_API void cutest_case_convert_benchmark(
+    cutest_case_t* tc,
+    int type
+);
+
+/**
+ * @brief Convert normal test case to open-loop load test.
+ * @param[in,out] tc - Test case.
+ * @param[in] rate - Calls per second.
+ * @param[in] duration - Duration in milliseconds.
+ */
+CUTEST_API void cutest_case_convert_load(
+    cutest_case_t* tc,
+    unsigned long rate,
+    unsigned long duration
+);
+
+/**
+ * @brief Set the number of bytes processed by one iteration of current
+ *   benchmark.
+ * @note Only calls from the thread that runs the test take effect. The body of
+ *   #TEST_BENCH_MT() runs in that thread for the single-threaded round, so
+ *   calls from worker threads are ignored.
+ * @param[in] bytes - Bytes processed per iteration.
+ */
+CUTEST_API void cutest_bench_set_bytes(unsigned long bytes);
+
+/**
+ * @brief Set the number of items processed by one iteration of current
+ *   benchmark.
+ * @note Only calls from the thread that runs the test take effect. The body of
+ *   #TEST_BENCH_MT() runs in that thread for the single-threaded round, so
+ *   calls from worker threads are ignored.
+ * @param[in] items - Items processed per iteration.
+ */
+CUTEST_API void cutest_bench_set_items(unsigned long items);
+
+/**
+ * Group: TEST_BENCHMARK
+ * @}
+ */
+
+/**
+ * @defgroup TEST_BUDGET Performance Budget
+ *
+ * A performance budget is a timing contract checked in an ordinary test run.
+ * Use #TEST_BUDGET() to limit the body of a whole test, or
+ * #ASSERT_ELAPSED_LT_NS() to limit a block inside a test:
+ *
+ * @code{.c}
+ * TEST_BUDGET(foo, lookup, 5)
+ * {
+ *     ASSERT_ELAPSED_LT_NS(200 * 1000)
+ *     {
+ *         lookup_one();
+ *     }
+ * }
+ * @endcode
+ *
+ * To keep noise from failing the run, a budget is exceeded only if the time
+ * is over the budget plus `--test_budget_tolerance` percent, and the code is
+ * repeated up to `--test_budget_retry` times to confirm. A budget fails only
+ * if every attempt is over it:
+ *
+ * ```
+ * [ RUN      ] foo.lookup
+ * foo.c:42:failure:
+ *             expected: elapsed < `200 * 1000' ns (+10%)
+ *               actual: 310522 ns, best of 3 attempts
+ * [  FAILED  ] foo.lookup (2 ms)
+ * ```
+ *
+ * @warning Because of the retry, the body of #TEST_BUDGET() and the block of
+ *   #ASSERT_ELAPSED_LT_NS() must be repeatable. #TEST_FIXTURE_SETUP() and
+ *   #TEST_FIXTURE_TEARDOWN() are called only once.
+ *
+ * @{
+ */
+
+/**
+ * @brief Define a test whose body must finish in \p ms milliseconds.
+ * @param [in] fixture  The name of fixture
+ * @param [in] test     The name of test case
+ * @param [in] ms       Time budget in milliseconds.
+ * @see TEST_FIXTURE_SETUP
+ * @see TEST_FIXTURE_TEARDOWN
+ */
+#define TEST_BUDGET(fixture, test, ms) \
+    TEST_INTERNAL_CONVERT(fixture, test, cutest_case_convert_budget(_test_case, ms))
+
+/**
+ * @brief The following block must finish in \p ns nanoseconds.
+ *
+ * It is used like a loop statement, so do not `break` or `return` out of the
+ * block, otherwise it is not measured.
+ *
+ * @note Requires C99 or C++, as it declares a variable in `for` statement.
+ * @param [in] ns       Time budget in nanoseconds.
+ */
+#define ASSERT_ELAPSED_LT_NS(ns) \
+    for (cutest_elapsed_t TEST_JOIN(_cutest_elapsed_, __LINE__) = {\
+            __FILE__, __LINE__, #ns, (double)(ns), 0, 0, 0 };\
+        cutest_internal_elapsed_check(&TEST_JOIN(_cutest_elapsed_, __LINE__));)
+
+/**
+ * @brief State of #ASSERT_ELAPSED_LT_NS().
+ * @warning It is for internal usage.
+ */
+typedef struct cutest_elapsed
+{
+    const char*                         file;           /**< File name. */
+    int                                 line;           /**< Line number. */
+    const char*                         expr;           /**< Budget expression. */
+    double                              budget;         /**< Budget in nanoseconds. */
+    double                              start;          /**< Start time in nanoseconds of current attempt. */
+    double                              best;           /**< The best elapsed nanoseconds. */
+    unsigned long                       attempt;        /**< The number of finished attempts. */
+} cutest_elapsed_t;
+
+/**
+ * @brief Convert normal test case to test with time budget.
+ * @param[in,out] tc - Test case.
+ * @param[in] ms - Time budget in milliseconds.
+ */
+CUTEST_API void cutest_case_convert_budget(
+    cutest_case_t* tc,
+    unsigned long ms
+);
+
+/**
+ * @brief Check the block of #ASSERT_ELAPSED_LT_NS().
+ * @warning It is for internal usage.
+ * @param[in,out] elapsed - State.
+ * @return 1 if the block should run (again), 0 if it is within budget.
+ */
+CUTEST_API int cutest_internal_elapsed_check(cutest_elapsed_t* elapsed);
+
+/**
+ * Group: TEST_BUDGET
+ * @}
+ */
+
+/**
+ * @defgroup TEST_NOALLOC No-Allocation Scope
+ *
+ * Check that a hot path does not allocate heap memory. Use #TEST_NOALLOC() to
+ * check the body of a whole test, or #CUTEST_NO_ALLOC_BEGIN() and
+ * #CUTEST_NO_ALLOC_END() to check part of a test:
+ *
+ * @code{.c}
+ * TEST(foo, packet)
+ * {
+ *     packet_t* pkt = packet_new();
+ *
+ *     CUTEST_NO_ALLOC_BEGIN();
+ *     packet_process(pkt);
+ *     CUTEST_NO_ALLOC_END();
+ *
+ *     packet_free(pkt);
+ * }
+ * @endcode
+ *
+ * If anything is allocated in scope, the test fails with the size and the
+ * backtrace of the first allocation:
+ *
+ * ```
+ * [ RUN      ] foo.packet
+ * foo.c:46:failure:
+ *             expected: no allocation
+ *               actual: 1 allocation, first of 64 bytes at:
+ *                 #0 packet_clone
+ *                 #1 packet_process
+ *                 #2 cutest_usertest_body_foo_packet
+ * [  FAILED  ] foo.packet (0 ms)
+ * ```
+ *
+ * Only allocations of the thread that begins the scope are checked, and
+ * scopes can be nested. Allocations are only seen if cutest is built with
+ * `CUTEST_ALLOC_TRACKER`, otherwise the scopes check nothing and a warning is
+ * printed once. Static functions are printed as module offset.
+ *
+ * @{
+ */
+
+/**
+ * @brief Define a test whose body must not allocate memory.
+ * @param [in] fixture  The name of fixture
+ * @param [in] test     The name of test case
+ * @see TEST_FIXTURE_SETUP
+ * @see TEST_FIXTURE_TEARDOWN
+ */
+#define TEST_NOALLOC(fixture, test) \
+    TEST_INTERNAL_CONVERT(fixture, test, cutest_case_convert_noalloc(_test_case))
+
+/**
+ * @brief Begin a scope that must not allocate memory.
+ */
+#define CUTEST_NO_ALLOC_BEGIN()     cutest_no_alloc_begin()
+
+/**
+ * @brief End the scope of #CUTEST_NO_ALLOC_BEGIN().
+ */
+#define CUTEST_NO_ALLOC_END()       cutest_no_alloc_end(__FILE__, __LINE__)
+
+/**
+ * @brief Convert normal test case to test without allocation.
+ * @param[in,out] tc - Test case.
+ */
+CUTEST_API void cutest_case_convert_noalloc(cutest_case_t* tc);
+
+/**
+ * @brief Begin no-allocation scope.
+ * @see CUTEST_NO_ALLOC_BEGIN
+ */
+CUTEST_API void cutest_no_alloc_begin(void);
+
+/**
+ * @brief End no-allocation scope.
+ * @see CUTEST_NO_ALLOC_END
+ * @param[in] file - File name.
+ * @param[in] line - Line number.
+ */
+CUTEST_API void cutest_no_alloc_end(const char* file, int line);
+
+/**
+ * @brief Begin a scope whose allocations are never reported as leaks, nor as
+ *   allocations in #CUTEST_NO_ALLOC_BEGIN().
+ *
+ * Use it for memory that a library caches on first use:
+ *
+ * @code{.c}
+ * CUTEST_ALLOC_IGNORE_BEGIN();
+ * setlocale(LC_ALL, "");
+ * CUTEST_ALLOC_IGNORE_END();
+ * @endcode
+ *
+ * Only allocations of current thread are ignored, and scopes can be nested.
+ * Freeing an ignored block does not cancel out a leak. At most
+ * `CUTEST_ALLOC_IGNORE_MAX` (256 by default) ignored blocks are remembered at
+ * the same time, and more are tracked as usual.
+ */
+#define CUTEST_ALLOC_IGNORE_BEGIN() cutest_alloc_ignore_begin()
+
+/**
+ * @brief End the scope of #CUTEST_ALLOC_IGNORE_BEGIN().
+ */
+#define CUTEST_ALLOC_IGNORE_END()   cutest_alloc_ignore_end()
+
+/**
+ * @brief Begin ignore scope.
+ * @see CUTEST_ALLOC_IGNORE_BEGIN
+ */
+CUTEST_API void cutest_alloc_ignore_begin(void);
+
+/**
+ * @brief End ignore scope.
+ * @see CUTEST_ALLOC_IGNORE_END
+ */
+CUTEST_API void cutest_alloc_ignore_end(void);
+
+/**
+ * Group: TEST_NOALLOC
+ * @}
+ */
+
+/**
+ * @defgroup TEST_GUARDED Guarded Allocation
+ *
+ * Catch buffer overflow at the faulting instruction, without building the
+ * test with a sanitizer. A buffer from #cutest_guarded_alloc() is placed
+ * against an inaccessible guard page, so the first byte out of bounds faults:
+ *
+ * @code{.c}
+ * TEST(foo, parse)
+ * {
+ *     char* buf = cutest_guarded_alloc(5, CUTEST_GUARD_END);
+ *     memcpy(buf, "hello", 5);
+ *     parse(buf, 5);      // Crash here if parse() reads buf[5].
+ *     cutest_guarded_free(buf);
+ * }
+ * @endcode
+ *
+ * With #CUTEST_GUARD_END the buffer ends at page boundary, so it is only
+ * aligned as its size is. With #CUTEST_GUARD_START it is page aligned.
+ *
+ * Each buffer takes at least two pages, so use it for buffers under test
+ * rather than as a general allocator. At most #CUTEST_GUARDED_MAX buffers can
+ * be alive at the same time. Buffers still alive after teardown are freed,
+ * with a warning if the test passed. Guarded allocation is supported on Linux and
+ * Windows; on other platforms #cutest_guarded_alloc() returns NULL.
+ *
+ * @{
+ */
+
+/**
+ * @brief Maximum number of live guarded buffers.
+ */
+#if !defined(CUTEST_GUARDED_MAX)
+#   define CUTEST_GUARDED_MAX   1024
+#endif
+
+/**
+ * @brief Which side of buffer the guard page is on.
+ */
+typedef enum cutest_guard
+{
+    CUTEST_GUARD_END        = 0,    /**< Guard page after buffer, catch overflow. */
+    CUTEST_GUARD_START      = 1,    /**< Guard page before buffer, catch underflow. */
+} cutest_guard_t;
+
+/**
+ * @brief Allocate \p size bytes against a guard page.
+ * @param[in] size - Size of buffer.
+ * @param[in] guard - Side of guard page.
+ * @return  Buffer, or NULL if failure.
+ */
+CUTEST_API void* cutest_guarded_alloc(size_t size, cutest_guard_t guard);
+
+/**
+ * @brief Free buffer from #cutest_guarded_alloc().
+ * The pages are unmapped, so use after free also faults unless the address
+ * is reused.
+ * @param[in] ptr - Buffer, can be NULL.
+ */
+CUTEST_API void cutest_guarded_free(void* ptr);
+
+/**
+ * Group: TEST_GUARDED
+ * @}
+ */
+
+/**
+ * @defgroup TEST_ARENA Test Arena
+ *
+ * Scaffolding of a test can be allocated by #cutest_arena_alloc() instead of
+ * malloc(). It is a bump allocator over one large mapping, and everything in
+ * it is freed at once after teardown of each test:
+ *
+ * @code{.c}
+ * TEST(foo, graph)
+ * {
+ *     size_t i;
+ *     node_t* nodes = cutest_arena_alloc(sizeof(node_t) * 1000);
+ *     for (i = 0; i < 1000; i++)
+ *     {
+ *         nodes[i].name = cutest_arena_alloc(16);
+ *     }
+ *     ASSERT_EQ_INT(graph_check(nodes, 1000), 0);
+ *     // No free() needed.
+ * }
+ * @endcode
+ *
+ * The arena is mapped on first use with `--test_arena_size` megabytes of
+ * address space, which only takes physical memory when touched. Pass
+ * `--test_arena_huge_pages` to ask for transparent huge pages. Memory from
+ * the arena is not seen by `CUTEST_ALLOC_TRACKER`, so it is never a leak.
+ *
+ * @{
+ */
+
+/**
+ * @brief Allocate memory that is freed after teardown of current test.
+ * @note It is thread safe.
+ * @param[in] size - Size of memory.
+ * @return  Memory aligned to 16 bytes, or NULL if arena is exhausted or not
+ *   supported on this platform.
+ */
+CUTEST_API void* cutest_arena_alloc(size_t size);
+
+/**
+ * Group: TEST_ARENA
+ * @}
+ */
+
+/**
+ * @defgroup TEST_TMPDIR Test Temporary Directory
+ *
+ * A test that needs files can ask for its own directory instead of calling
+ * mkdtemp() and cleaning up by hand:
+ *
+ * @code{.c}
+ * TEST(foo, save)
+ * {
+ *     char path[256];
+ *     snprintf(path, sizeof(path), "%s/db", cutest_tmpdir());
+ *     ASSERT_EQ_INT(db_save(path), 0);
+ * }
+ * @endcode
+ *
+ * The directory is created on first call in each test, under
+ * `--test_tmpdir_root`, or `/dev/shm` (falling back to `/tmp`) by default,
+ * so it lives in memory where possible. Its name has the process ID, so
+ * processes running at the same time never share it, and a name that
+ * already exists is never reused. It is removed with everything in it after
+ * teardown.
+ *
+ * @{
+ */
+
+/**
+ * @brief Get temporary directory of current test, create it on first call.
+ * @note It is thread safe.
+ * @return  Path of directory, or NULL if no test is running, the directory
+ *   cannot be created, or not supported on this platform.
+ */
+CUTEST_API const char* cutest_tmpdir(void);
+
+/**
+ * Group: TEST_TMPDIR
+ * @}
+ */
+
+/**
+ * @defgroup TEST_VTIME Virtual Time
+ *
+ * Code under test that takes time through #cutest_now() and #cutest_sleep()
+ * can run on a simulated clock with `--test_virtual_time`, so timeouts and
+ * retry loops finish at once:
+ *
+ * @code{.c}
+ * TEST(foo, retry)
+ * {
+ *     unsigned long long beg = cutest_now();
+ *     ASSERT_EQ_INT(connect_with_retry(5), -1); // Sleeps 1s between tries.
+ *     ASSERT_EQ_ULONGLONG(cutest_now() - beg, 4000000000ULL);
+ * }
+ * @endcode
+ *
+ * The clock only moves when every attached thread is in #cutest_sleep(), and
+ * then it jumps to the earliest wake up time. The main thread is always
+ * attached. Call #cutest_time_attach() before starting a thread that sleeps
+ * on the clock, and #cutest_time_detach() when that thread is done.
+ * Attachments are kept across tests, so a thread attached in a hook before
+ * all tests keeps counting. A thread blocked anywhere else stops the clock,
+ * so it must be detached while it waits. Threads in #cutest_sleep() block
+ * until the clock reaches them instead of spinning. Without
+ * `--test_virtual_time` these functions use real time.
+ *
+ * Timing reported by cutest itself is always in real time.
+ *
+ * @{
+ */
+
+/**
+ * @brief Get monotonic time in nanoseconds.
+ * @return  Nanoseconds since an unspecified point.
+ */
+CUTEST_API unsigned long long cutest_now(void);
+
+/**
+ * @brief Sleep for \p ns nanoseconds.
+ * @note It is thread safe.
+ * @param[in] ns - Nanoseconds to sleep.
+ */
+CUTEST_API void cutest_sleep(unsigned long long ns);
+
+/**
+ * @brief Count one more thread that the virtual clock waits for.
+ */
+CUTEST_API void cutest_time_attach(void);
+
+/**
+ * @brief Stop counting a thread added by #cutest_time_attach().
+ */
+CUTEST_API void cutest_time_detach(void);
+
+/**
+ * Group: TEST_VTIME
+ * @}
+ */
+
+/**
+ * @defgroup TEST_IO_FAULT I/O Fault Injection
+ *
+ * If cutest is built with `CUTEST_IO_FAULT` (Linux only), it replaces open(),
+ * close(), read(), write() and fsync() of the program, so a test can make
+ * them slow or fail:
+ *
+ * @code{.c}
+ * TEST(foo, slow_disk)
+ * {
+ *     cutest_io_fault_t fault;
+ *     memset(&fault, 0, sizeof(fault));
+ *     fault.ops = CUTEST_IO_READ | CUTEST_IO_WRITE;
+ *     fault.path = cutest_tmpdir();
+ *     fault.latency_us = 100;
+ *     fault.tail_pct = 1;
+ *     fault.tail_us = 50000;
+ *     fault.short_pct = 10;
+ *     ASSERT_EQ_INT(cutest_io_fault_set(&fault), 0);
+ *     ASSERT_EQ_INT(storage_replay(fault.path), 0);
+ * }
+ * @endcode
+ *
+ * Faults only last until teardown of current test. The same
+ * #cutest_io_fault_t::seed gives the same faults. Latency is spent in
+ * #cutest_sleep(), so with `--test_virtual_time` it takes no wall time.
+ * Calls made inside the C library, such as by fwrite(), are not affected.
+ *
+ * @{
+ */
+
+/**
+ * @brief Operations to inject faults into.
+ */
+typedef enum cutest_io_op
+{
+    CUTEST_IO_OPEN          = 0x01,     /**< open() */
+    CUTEST_IO_READ          = 0x02,     /**< read() */
+    CUTEST_IO_WRITE         = 0x04,     /**< write() */
+    CUTEST_IO_FSYNC         = 0x08,     /**< fsync() */
+} cutest_io_op_t;
+
+/**
+ * @brief Faults of I/O operations.
+ */
+typedef struct cutest_io_fault
+{
+    unsigned                            ops;            /**< Bit OR of #cutest_io_op_t. */
+    const char*                         path;           /**< Only files under this prefix opened after the call, NULL for all. Must live until teardown. */
+    unsigned long                       latency_us;     /**< Latency of every operation. */
+    unsigned long                       jitter_us;      /**< Extra latency, uniform in [0, jitter_us]. */
+    unsigned                            tail_pct;       /**< Percent of operations that are also delayed by #cutest_io_fault_t::tail_us. */
+    unsigned long                       tail_us;        /**< Extra latency of slow operations. */
+    unsigned                            short_pct;      /**< Percent of reads and writes that transfer fewer bytes. */
+    unsigned                            eintr_pct;      /**< Percent of operations that fail with EINTR. */
+    unsigned                            eio_pct;        /**< Percent of operations that fail with EIO. */
+    unsigned long                       seed;           /**< Random seed. */
+} cutest_io_fault_t;
+
+/**
+ * @brief Inject I/O faults until teardown of current test.
+ * @note It is thread safe.
+ * @param[in] fault - Faults, NULL to stop.
+ * @return  0 if success, -1 if no test is running, \p fault is invalid, or
+ *   cutest is not built with `CUTEST_IO_FAULT`.
+ */
+CUTEST_API int cutest_io_fault_set(const cutest_io_fault_t* fault);
+
+/**
+ * Group: TEST_IO_FAULT
+ * @}
+ */
+
+/**
+ * @defgroup TEST_TIMER Timing Region
+ *
+ * Measure phases of a test without hand-rolled timing code:
+ *
+ * @code{.c}
+ * TEST(foo, search)
+ * {
+ *     CUTEST_TIMER_BEGIN("parse");
+ *     parse();
+ *     CUTEST_TIMER_END("parse");
+ *
+ *     CUTEST_TIMER_BEGIN("query");
+ *     query();
+ *     CUTEST_TIMER_END("query");
+ * }
+ * @endcode
+ *
+ * Regions with the same name are aggregated, and reported under the test in
+ * the output and in `--test_trace`:
+ *
+ * ```
+ * [ RUN      ] foo.search
+ * [       OK ] foo.search (31 ms)
+ * [ TIMER    ] parse: 1 calls, 12.052 ms total, 12.052 ms avg
+ * [ TIMER    ] query: 1 calls, 18.774 ms total, 18.774 ms avg
+ * ```
+ *
+ * At most #CUTEST_TIMER_MAX regions are recorded for one test. Regions can be
+ * nested, but only in the thread that runs the test.
+ *
+ * @{
+ */
+
+/**
+ * @brief Maximum number of timing regions of one test.
+ */
+#if !defined(CUTEST_TIMER_MAX)
+#   define CUTEST_TIMER_MAX     16
+#endif
+
+/**
+ * @brief Start timing region \p name.
+ * @param [in] name     Region name. It must be valid until the test finishes.
+ */
+#define CUTEST_TIMER_BEGIN(name)    cutest_timer_begin(name)
+
+/**
+ * @brief Stop timing region \p name.
+ * @param [in] name     Region name.
+ */
+#define CUTEST_TIMER_END(name)      cutest_timer_end(name)
+
+/**
+ * @brief Start timing region.
+ * @see CUTEST_TIMER_BEGIN
+ * @param[in] name - Region name.
+ */
+CUTEST_API void cutest_timer_begin(const char* name);
+
+/**
+ * @brief Stop timing region.
+ * @see CUTEST_TIMER_END
+ * @param[in] name - Region name.
+ */
+CUTEST_API void cutest_timer_end(const char* name);
+
+/**
+ * Group: TEST_TIMER
+ * @}
+ */
+
 /**
  * @defgroup TEST_ASSERTION Assertion
  *
@@ -1676,6 +2524,103 @@ typedef struct cutest_hook
     void(*after_test)(const char* fixture, const char* test_name, int ret);
 } cutest_hook_t;
 
+/**
+ * @brief Version of #cutest_hook_ex_t and #cutest_result_t.
+ */
+#define CUTEST_HOOK_EX_VERSION      1
+
+/**
+ * @brief Status bits of #cutest_result_t::status.
+ */
+typedef enum cutest_result_status
+{
+    CUTEST_RESULT_FAILURE   = 0x01, /**< Test failed. */
+    CUTEST_RESULT_SKIPPED   = 0x02, /**< Test skipped. */
+} cutest_result_status_t;
+
+/**
+ * @brief Heap allocations of a test.
+ *
+ * Allocations are only tracked if cutest is built with `CUTEST_ALLOC_TRACKER`
+ * (Linux with glibc only), which replaces malloc(), calloc(), realloc(),
+ * free() and the aligned variants of the whole program. cutest itself still
+ * allocates nothing, the replacements forward to glibc. A passing test that
+ * does not free everything it allocated fails as a leak, or is only warned by
+ * `--test_alloc_leaks=1`. Memory that a library keeps on purpose can be
+ * allocated between #CUTEST_ALLOC_IGNORE_BEGIN() and #CUTEST_ALLOC_IGNORE_END().
+ */
+typedef struct cutest_alloc_stat
+{
+    unsigned long                       allocs;         /**< The number of allocations. */
+    unsigned long                       bytes;          /**< Total usable bytes of allocations. */
+    unsigned long                       peak;           /**< Peak growth of heap in bytes. */
+    unsigned long                       leaks;          /**< The number of allocations not freed. */
+    unsigned long                       leak_bytes;     /**< Bytes not freed. */
+} cutest_alloc_stat_t;
+
+/**
+ * @brief Read-only result record of a test.
+ *
+ * New fields are only appended, and #cutest_result_t::version tells which
+ * fields are valid.
+ *
+ * @note The record and #cutest_result_t::full_name are only valid during the
+ *   callback, copy them if needed later.
+ */
+typedef struct cutest_result
+{
+    unsigned                            version;        /**< #CUTEST_HOOK_EX_VERSION of the library. */
+    const cutest_case_t*                test_case;      /**< Test case. */
+    const char*                         fixture_name;   /**< Fixture name. */
+    const char*                         case_name;      /**< Case name. */
+    const char*                         full_name;      /**< Full name as printed, like `fixture.test/0`. */
+    const char*                         file;           /**< Source file of definition, can be NULL. */
+    int                                 line;           /**< Source line of definition. */
+    const char*                         param_type;     /**< Parameter type name, NULL if not parameterized. */
+    unsigned long                       param_idx;      /**< Parameter index. */
+
+    /* The following fields are only valid in #cutest_hook_ex_t::after_test. */
+    unsigned long                       status;         /**< Bit OR of #cutest_result_status_t. */
+    unsigned long                       assertions;     /**< The number of assertions evaluated in main thread. */
+    const char*                         failure_file;   /**< Source file of failed assertion, can be NULL. */
+    int                                 failure_line;   /**< Source line of failed assertion. */
+    double                              elapsed_ns;     /**< Total elapsed nanoseconds. */
+    double                              setup_ns;       /**< Nanoseconds of setup stage, including hooks. */
+    double                              body_ns;        /**< Nanoseconds of body stage, including hooks. */
+    double                              teardown_ns;    /**< Nanoseconds of teardown stage, including hooks. */
+    double                              cpu_ns;         /**< Process CPU nanoseconds, 0 if not supported. */
+    double                              thread_cpu_ns;  /**< Thread CPU nanoseconds, 0 if not supported. */
+    cutest_usage_t                      usage;          /**< Resource usage, zero if not supported. */
+    cutest_io_t                         io;             /**< I/O counters, zero if not supported. */
+    cutest_alloc_stat_t                 alloc;          /**< Heap allocations, zero if not tracked. */
+} cutest_result_t;
+
+/**
+ * @brief Extended hook, called along with #cutest_hook_t.
+ *
+ * Set #cutest_hook_ex_t::version to #CUTEST_HOOK_EX_VERSION. New callbacks are
+ * only appended, and a callback is only read if the version of the hook is
+ * not older than the one that introduced it, so a hook built against an
+ * older header still works.
+ */
+typedef struct cutest_hook_ex
+{
+    unsigned                            version;        /**< Must be #CUTEST_HOOK_EX_VERSION. */
+
+    /**
+     * @brief Hook before a test runs. Only names, location and parameter of
+     *   \p result are valid. Since version 1.
+     * @param[in] result    Result record.
+     */
+    void(*before_test)(const cutest_result_t* result);
+
+    /**
+     * @brief Hook after a test finished. Since version 1.
+     * @param[in] result    Result record.
+     */
+    void(*after_test)(const cutest_result_t* result);
+} cutest_hook_ex_t;
+
 /**
  * @brief Run all test cases
  * @snippet main.c ENTRYPOINT
@@ -1692,6 +2637,23 @@ CUTEST_API int cutest_run_tests(
     const cutest_hook_t* hook
 );
 
+/**
+ * @brief Run all test cases with extended hook.
+ * @param[in] argc      The number of arguments.
+ * @param[in] argv      The argument list.
+ * @param[in] out       Output stream, cannot be NULL.
+ * @param[in] hook      Test hook, can be NULL.
+ * @param[in] hook_ex   Extended test hook, can be NULL.
+ * @return              0 if success, otherwise failure.
+ */
+CUTEST_API int cutest_run_tests_ex(
+    int argc,
+    char* argv[],
+    FILE* out,
+    const cutest_hook_t* hook,
+    const cutest_hook_ex_t* hook_ex
+);
+
 /**
  * @brief Get current running suit name
  * @return              The suit name
@@ -1704,6 +2666,30 @@ CUTEST_API const char* cutest_get_current_fixture(void);
  */
 CUTEST_API const char* cutest_get_current_test(void);
 
+/**
+ * @brief Get resource usage of current running case so far.
+ *
+ * The usage is counted for the whole process since the case started, so it can
+ * be used in hooks, for example #cutest_hook_t::after_test. After the case is
+ * finished, it is also available in #cutest_case_t::data::usage.
+ *
+ * @param[out] usage    Resource usage.
+ * @return              0 if success, -1 if no case is running or not supported.
+ */
+CUTEST_API int cutest_get_current_usage(cutest_usage_t* usage);
+
+/**
+ * @brief Get I/O counters of current running case so far.
+ *
+ * Like #cutest_get_current_usage(), the counters are for the whole process
+ * since the case started. After the case is finished, they are also available
+ * in #cutest_case_t::data::io.
+ *
+ * @param[out] io       I/O counters.
+ * @return              0 if success, -1 if no case is running or not supported.
+ */
+CUTEST_API int cutest_get_current_io(cutest_io_t* io);
+
 /**
  * @brief Skip current test case.
  * @note This function only has affect in setup stage.
@@ -2,6 +2,10 @@
 #   define _WIN32_WINNT   0x0600
 #endif
 
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#   define _GNU_SOURCE
+#endif
+
 #define CUTEST_BUILDING_DLL
 #include "cutest.h"
 
@@ -1742,7 +1746,7 @@ static int cutest_timestamp_dif(const cutest_porting_timespec_t* t1,
     tmp_dif.tv_sec = large_t->tv_sec - little_t->tv_sec;
     if (large_t->tv_nsec < little_t->tv_nsec)
     {
-        tmp_dif.tv_nsec = little_t->tv_nsec - large_t->tv_nsec;
+        tmp_dif.tv_nsec = 1000000000 - (little_t->tv_nsec - large_t->tv_nsec);
         tmp_dif.tv_sec--;
     }
     else
@@ -1762,575 +1766,5283 @@ static int cutest_timestamp_dif(const cutest_porting_timespec_t* t1,
     return t1 == little_t ? -1 : 1;
 }
 
-/************************************************************************/
-/* test                                                                 */
-/************************************************************************/
-
-#define COLOR_GREEN(str)                    "@G" str "@D"
-#define COLOR_RED(str)                      "@R" str "@D"
-#define COLOR_YELLO(str)                    "@Y" str "@D"
-
-#define MASK_FAILURE                        (0x01 << 0x00)
-#define MASK_SKIPPED                        (0x01 << 0x01)
-#define SET_MASK(val, mask)                 do { (val) |= (mask); } while (0)
-#define HAS_MASK(val, mask)                 ((val) & (mask))
-
-#define MAX_RAND                            99999
-
 /**
- * @brief microseconds in one second
+ * @brief Convert timestamp into nanoseconds.
+ * @param[in] ts    Timestamp.
+ * @return          Nanoseconds.
  */
-#define USEC_IN_SEC                         (1 * 1000 * 1000)
-
-#define CONTAINER_OF(ptr, TYPE, member) \
-    ((TYPE*)((char*)(ptr) - (char*)&((TYPE*)0)->member))
+static double cutest_timestamp_ns(const cutest_porting_timespec_t* ts)
+{
+    return (double)ts->tv_sec * 1000000000.0 + (double)ts->tv_nsec;
+}
 
 /**
- * @brief Create compare context for \p TYPE.
- * @param[in] TYPE  Data type.
+ * @brief Square root by Newton's method, so we do not depend on libm.
  */
-#define TEST_GENERATE_NATIVE_COMPARE(NAME, TYPE)  \
-    TEST_GENERATE_TEMPLATE_COMPARE(NAME, TYPE, _cutest_smart_print_int)
+static double _cutest_sqrt(double x)
+{
+    double r = x > 1 ? x : 1;
+    double prev = 0;
 
-#define TEST_GENERATE_TEMPLATE_COMPARE(NAME, TYPE, PRINT)   \
-    static int _test_cmp_##NAME(TYPE* addr1, TYPE* addr2) {\
-        TYPE v1 = *addr1;\
-        TYPE v2 = *addr2;\
-        if (v1 == v2) {\
-            return 0;\
-        }\
-        return v1 < v2 ? -1 : 1;\
-    }\
-    static int _test_print_##NAME(FILE* file, TYPE* addr) {\
-        int is_signed = ((TYPE)(-1)) < ((TYPE)1);\
-        return PRINT(file, addr, sizeof(TYPE), is_signed);\
-    }\
-    static cutest_type_info_t NAME = {\
-        { NULL, NULL, NULL }, #TYPE,\
-        (cutest_custom_type_cmp_fn)_test_cmp_##NAME,\
-        (cutest_custom_type_dump_fn)_test_print_##NAME,\
+    if (x <= 0)
+    {
+        return 0;
     }
 
-typedef struct test_case_info
-{
-    char                        fmt_name[256];  /**< Formatted name. */
-    unsigned long               fmt_name_sz;    /**< The length of formatted name, not include NULL termainator. */
+    while (r != prev)
+    {
+        prev = r;
+        r = (r + x / r) / 2;
+        if (r >= prev)
+        {
+            break;
+        }
+    }
+    return r;
+}
 
-    cutest_case_t*              test_case;      /**< Test case. */
+///////////////////////////////////////////////////////////////////////////////
+// Thread
+///////////////////////////////////////////////////////////////////////////////
 
-    cutest_porting_timespec_t   tv_case_beg;    /**< Start time. */
-    cutest_porting_timespec_t   tv_case_end;    /**< End time. */
-} test_case_info_t;
+typedef void (*cutest_thread_fn)(void* arg);
 
-typedef struct fixture_run_helper
+#if defined(CUTEST_NO_THREADS)
+
+#define CUTEST_HAVE_THREADS     0
+
+#elif defined(_WIN32)
+
+#include <windows.h>
+
+#define CUTEST_HAVE_THREADS     1
+
+typedef struct cutest_thread
 {
-    test_case_info_t*           info;
-    int                         ret;
-} fixture_run_helper_t;
+    HANDLE                      handle;
+    cutest_thread_fn            fn;
+    void*                       arg;
+} cutest_thread_t;
 
-typedef struct test_case_helper
+typedef struct cutest_event
 {
-    test_case_info_t*           info;
-    int                         ret;
-} test_case_helper_t;
+    SRWLOCK                     lock;
+    CONDITION_VARIABLE          cond;
+    int                         is_set;
+} cutest_event_t;
 
-typedef struct test_run_parameterized_helper
+typedef struct cutest_cond
 {
-    test_case_info_t*           info;
-} test_run_parameterized_helper_t;
+    SRWLOCK                     lock;
+    CONDITION_VARIABLE          cond;
+    unsigned long               seq;
+} cutest_cond_t;
 
-typedef struct test_ctx
+static DWORD WINAPI _cutest_thread_proxy(LPVOID arg)
 {
-    cutest_map_t                    case_table;                     /**< Cases in map */
-    cutest_map_t                    type_table;                     /**< Type table. */
+    cutest_thread_t* thr = arg;
+    thr->fn(thr->arg);
+    return 0;
+}
 
-    struct
-    {
-        void*                       tid;                            /**< Thread ID */
-        cutest_case_t*              cur_node;                       /**< Current running test case node. */
-    } runtime;
+static int cutest_thread_create(cutest_thread_t* thr, cutest_thread_fn fn, void* arg)
+{
+    thr->fn = fn;
+    thr->arg = arg;
+    thr->handle = CreateThread(NULL, 0, _cutest_thread_proxy, thr, 0, NULL);
+    return thr->handle != NULL ? 0 : -1;
+}
 
-    struct
-    {
-        struct
-        {
-            unsigned                total;                          /**< The number of total running cases */
-            unsigned                disabled;                       /**< The number of disabled cases */
-            unsigned                success;                        /**< The number of success cases */
-            unsigned                skipped;                        /**< The number of skipped cases */
-            unsigned                failed;                         /**< The number of failed cases */
-        } result;
+static void cutest_thread_join(cutest_thread_t* thr)
+{
+    WaitForSingleObject(thr->handle, INFINITE);
+    CloseHandle(thr->handle);
+}
 
-        struct
-        {
-            unsigned long           repeat;                         /**< How many times need to repeat */
-            unsigned long           repeated;                       /**< How many times already repeated */
-        } repeat;
-    } counter;
+static void cutest_event_init(cutest_event_t* evt)
+{
+    InitializeSRWLock(&evt->lock);
+    InitializeConditionVariable(&evt->cond);
+    evt->is_set = 0;
+}
 
-    struct
-    {
-        test_str_t                  pattern;                         /**< `--test_filter` */
-    } filter;
+static void cutest_event_exit(cutest_event_t* evt)
+{
+    (void)evt;
+}
 
-    struct
-    {
-        unsigned                    break_on_failure : 1;           /**< DebugBreak when failure */
-        unsigned                    no_print_time : 1;              /**< Whether to print execution cost time */
-        unsigned                    also_run_disabled_tests : 1;    /**< Also run disabled tests */
-        unsigned                    shuffle : 1;                    /**< Randomize running cases */
-    } mask;
+static void cutest_event_set(cutest_event_t* evt)
+{
+    AcquireSRWLockExclusive(&evt->lock);
+    evt->is_set = 1;
+    ReleaseSRWLockExclusive(&evt->lock);
+    WakeAllConditionVariable(&evt->cond);
+}
 
-    struct
+static void cutest_event_wait(cutest_event_t* evt)
+{
+    AcquireSRWLockExclusive(&evt->lock);
+    while (!evt->is_set)
     {
-        cutest_porting_jmpbuf_t*    addr;                           /**< Jump address. */
-        cutest_porting_longjmp_fn   func;                           /**< Long jump function. */
-    } jmp;
+        SleepConditionVariableSRW(&evt->cond, &evt->lock, INFINITE, 0);
+    }
+    ReleaseSRWLockExclusive(&evt->lock);
+}
 
-    FILE*                           out;
-    const cutest_hook_t*            hook;
-} test_ctx_t;
+static void cutest_cond_init(cutest_cond_t* cond)
+{
+    InitializeSRWLock(&cond->lock);
+    InitializeConditionVariable(&cond->cond);
+    cond->seq = 0;
+}
 
-static int _cutest_on_cmp_case(const cutest_map_node_t* key1, const cutest_map_node_t* key2, void* arg)
+static unsigned long cutest_cond_seq(cutest_cond_t* cond)
 {
-    (void)arg;
-    int ret;
+    AcquireSRWLockShared(&cond->lock);
+    unsigned long seq = cond->seq;
+    ReleaseSRWLockShared(&cond->lock);
+    return seq;
+}
 
-    cutest_case_t* t1 = CONTAINER_OF(key1, cutest_case_t, node);
-    cutest_case_t* t2 = CONTAINER_OF(key2, cutest_case_t, node);
+static void cutest_cond_broadcast(cutest_cond_t* cond)
+{
+    AcquireSRWLockExclusive(&cond->lock);
+    cond->seq++;
+    ReleaseSRWLockExclusive(&cond->lock);
+    WakeAllConditionVariable(&cond->cond);
+}
 
-    /* randkey always go first. */
-    if (t1->data.randkey < t2->data.randkey)
-    {
-        return -1;
-    }
-    if (t1->data.randkey > t2->data.randkey)
+static void cutest_cond_wait(cutest_cond_t* cond, unsigned long seq)
+{
+    AcquireSRWLockExclusive(&cond->lock);
+    while (cond->seq == seq)
     {
-        return 1;
+        SleepConditionVariableSRW(&cond->cond, &cond->lock, INFINITE, 0);
     }
+    ReleaseSRWLockExclusive(&cond->lock);
+}
 
-    if ((ret = cutest_porting_strcmp(t1->info.fixture_name, t2->info.fixture_name)) != 0)
-    {
-        return ret;
-    }
+static unsigned long cutest_cpu_count(void)
+{
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return (unsigned long)info.dwNumberOfProcessors;
+}
 
-    if ((ret = cutest_porting_strcmp(t1->info.case_name, t2->info.case_name)) != 0)
-    {
-        return ret;
-    }
+#elif defined(__linux__)
 
-    if (t1->parameterized.param_idx == t2->parameterized.param_idx)
-    {
-        return 0;
-    }
-    return t1->parameterized.param_idx < t2->parameterized.param_idx ? -1 : 1;
-}
+#include <pthread.h>
+#include <unistd.h>
 
-static int _cutest_on_cmp_type(const cutest_map_node_t* key1, const cutest_map_node_t* key2, void* arg)
+#define CUTEST_HAVE_THREADS     1
+
+typedef struct cutest_thread
 {
-    (void)arg;
-    cutest_type_info_t* t1 = CONTAINER_OF(key1, cutest_type_info_t, node);
-    cutest_type_info_t* t2 = CONTAINER_OF(key2, cutest_type_info_t, node);
+    pthread_t                   handle;
+    cutest_thread_fn            fn;
+    void*                       arg;
+} cutest_thread_t;
 
-    return cutest_porting_strcmp(t1->type_name, t2->type_name);
+typedef struct cutest_event
+{
+    pthread_mutex_t             lock;
+    pthread_cond_t              cond;
+    int                         is_set;
+} cutest_event_t;
+
+typedef struct cutest_cond
+{
+    pthread_mutex_t             lock;
+    pthread_cond_t              cond;
+    unsigned long               seq;
+} cutest_cond_t;
+
+static void* _cutest_thread_proxy(void* arg)
+{
+    cutest_thread_t* thr = arg;
+    thr->fn(thr->arg);
+    return NULL;
 }
 
-static test_ctx_t g_test_ctx = {
-    CUTEST_MAP_INIT(_cutest_on_cmp_case, NULL),                         /* .case_table */
-    CUTEST_MAP_INIT(_cutest_on_cmp_type, NULL),                         /* .type_table */
-    { NULL, NULL },                                                     /* .runtime */
-    { { 0, 0, 0, 0, 0 }, { 0, 0 } },                                    /* .counter */
-    { { NULL, 0 } },                                                    /* .filter */
-    { 0, 0, 0, 0 },                                                     /* .mask */
-    { NULL, NULL },                                                     /* .jmp */
-    NULL,                                                               /* .out */
-    NULL,                                                               /* .hook */
-};
+static int cutest_thread_create(cutest_thread_t* thr, cutest_thread_fn fn, void* arg)
+{
+    thr->fn = fn;
+    thr->arg = arg;
+    return pthread_create(&thr->handle, NULL, _cutest_thread_proxy, thr) == 0 ? 0 : -1;
+}
 
-static const char* s_test_help_encoded =
-"This program contains tests written using cutest. You can use the\n"
-"following command line flags to control its behavior:\n"
-"\n"
-"Test Selection:\n"
-"  " COLOR_GREEN("--test_list_tests") "\n"
-"      List the names of all tests instead of running them. The name of\n"
-"      TEST(Foo, Bar) is \"Foo.Bar\".\n"
-"  " COLOR_GREEN("--test_list_types") "\n"
-"      List the names of all support types.\n"
-"  " COLOR_GREEN("--test_filter=") COLOR_YELLO("POSTIVE_PATTERNS[") COLOR_GREEN("-") COLOR_YELLO("NEGATIVE_PATTERNS]") "\n"
-"      Run only the tests whose name matches one of the positive patterns but\n"
-"      none of the negative patterns. '?' matches any single character; '*'\n"
-"      matches any substring; ':' separates two patterns.\n"
-"  " COLOR_GREEN("--test_also_run_disabled_tests") "\n"
-"      Run all disabled tests too.\n"
-"\n"
-"Test Execution:\n"
-"  " COLOR_GREEN("--test_repeat=") COLOR_YELLO("[COUNT]") "\n"
-"      Run the tests repeatedly; use a negative count to repeat forever.\n"
-"  " COLOR_GREEN("--test_shuffle") "\n"
-"      Randomize tests' orders on every iteration.\n"
-"  " COLOR_GREEN("--test_random_seed=") COLOR_YELLO("[NUMBER]") "\n"
-"      Random number seed to use for shuffling test orders (between 0 and\n"
-"      " TEST_STRINGIFY(MAX_RAND) ". By default a seed based on the current time is used for shuffle).\n"
-"\n"
-"Test Output:\n"
-"  " COLOR_GREEN("--test_print_time=") COLOR_YELLO("(") COLOR_GREEN("0") COLOR_YELLO("|") COLOR_GREEN("1") COLOR_YELLO(")") "\n"
-"      Don't print the elapsed time of each test.\n"
-"\n"
-"Assertion Behavior:\n"
-"  " COLOR_GREEN("--test_break_on_failure") "\n"
-"      Turn assertion failures into debugger break-points.\n"
-;
+static void cutest_thread_join(cutest_thread_t* thr)
+{
+    pthread_join(thr->handle, NULL);
+}
 
-/**
- * @brief Check if `str` match `pat`
- * @return bool
- */
-static int _cutest_pattern_match(const char* pat, unsigned long pat_sz,
-    const char* str, unsigned long str_sz)
+static void cutest_event_init(cutest_event_t* evt)
 {
-    const char* name = str;
-    const char* const name_begin = name;
-    const char* const name_end = name + str_sz;
+    CUTEST_PORTING_ASSERT(pthread_mutex_init(&evt->lock, NULL) == 0);
+    CUTEST_PORTING_ASSERT(pthread_cond_init(&evt->cond, NULL) == 0);
+    evt->is_set = 0;
+}
 
-    const char* pattern = pat;
-    const char* pattern_end = pat + pat_sz;
-    const char* pattern_next = pattern;
-    const char* name_next = name;
+static void cutest_event_exit(cutest_event_t* evt)
+{
+    pthread_cond_destroy(&evt->cond);
+    pthread_mutex_destroy(&evt->lock);
+}
 
-    while (pattern < pattern_end || name < name_end)
+static void cutest_event_set(cutest_event_t* evt)
+{
+    pthread_mutex_lock(&evt->lock);
+    evt->is_set = 1;
+    pthread_cond_broadcast(&evt->cond);
+    pthread_mutex_unlock(&evt->lock);
+}
+
+static void cutest_event_wait(cutest_event_t* evt)
+{
+    pthread_mutex_lock(&evt->lock);
+    while (!evt->is_set)
     {
-        if (pattern < pattern_end)
+        pthread_cond_wait(&evt->cond, &evt->lock);
+    }
+    pthread_mutex_unlock(&evt->lock);
+}
+
+static void cutest_cond_init(cutest_cond_t* cond)
+{
+    CUTEST_PORTING_ASSERT(pthread_mutex_init(&cond->lock, NULL) == 0);
+    CUTEST_PORTING_ASSERT(pthread_cond_init(&cond->cond, NULL) == 0);
+    cond->seq = 0;
+}
+
+static unsigned long cutest_cond_seq(cutest_cond_t* cond)
+{
+    pthread_mutex_lock(&cond->lock);
+    unsigned long seq = cond->seq;
+    pthread_mutex_unlock(&cond->lock);
+    return seq;
+}
+
+static void cutest_cond_broadcast(cutest_cond_t* cond)
+{
+    pthread_mutex_lock(&cond->lock);
+    cond->seq++;
+    pthread_cond_broadcast(&cond->cond);
+    pthread_mutex_unlock(&cond->lock);
+}
+
+static void cutest_cond_wait(cutest_cond_t* cond, unsigned long seq)
+{
+    pthread_mutex_lock(&cond->lock);
+    while (cond->seq == seq)
+    {
+        pthread_cond_wait(&cond->cond, &cond->lock);
+    }
+    pthread_mutex_unlock(&cond->lock);
+}
+
+static unsigned long cutest_cpu_count(void)
+{
+    long ret = sysconf(_SC_NPROCESSORS_ONLN);
+    return ret > 0 ? (unsigned long)ret : 1;
+}
+
+#else
+
+#define CUTEST_HAVE_THREADS     0
+
+#endif
+
+#if !CUTEST_HAVE_THREADS
+
+typedef struct cutest_thread
+{
+    int                         reserved;
+} cutest_thread_t;
+
+typedef struct cutest_cond
+{
+    unsigned long               seq;
+} cutest_cond_t;
+
+static void cutest_cond_init(cutest_cond_t* cond)
+{
+    cond->seq = 0;
+}
+
+static unsigned long cutest_cond_seq(cutest_cond_t* cond)
+{
+    return cond->seq;
+}
+
+static void cutest_cond_broadcast(cutest_cond_t* cond)
+{
+    cond->seq++;
+}
+
+/* Without threads nobody else can change it, so callers just poll. */
+static void cutest_cond_wait(cutest_cond_t* cond, unsigned long seq)
+{
+    (void)cond; (void)seq;
+}
+
+static unsigned long cutest_cpu_count(void)
+{
+    return 1;
+}
+
+#endif
+
+///////////////////////////////////////////////////////////////////////////////
+// Environment
+///////////////////////////////////////////////////////////////////////////////
+
+typedef struct cutest_cputime
+{
+    double                      process_ns;     /**< CPU time of the whole process. */
+    double                      thread_ns;      /**< CPU time of calling thread. */
+} cutest_cputime_t;
+
+/**
+ * @fn static int cutest_cputime_get(cutest_cputime_t* cpu)
+ * @brief Get CPU time consumed so far, including user and system time.
+ * @return  0 if success, -1 if not supported.
+ */
+
+/**
+ * @fn static void* cutest_page_alloc(size_t length, int huge)
+ * @brief Map \p length bytes of pages. Physical memory is committed on first
+ *   touch where supported.
+ * @param[in] length    Length of mapping, must be a multiple of page size.
+ * @param[in] huge      Ask for transparent huge pages, ignored if not supported.
+ * @return  Start of mapping, or NULL if failure or not supported.
+ */
+
+/**
+ * @fn static void* cutest_page_map(size_t length, size_t guard_off)
+ * @brief Map \p length bytes of pages, and make the page at \p guard_off
+ *   inaccessible.
+ * @param[in] length    Length of mapping, must be a multiple of page size.
+ * @param[in] guard_off Offset of guard page.
+ * @return  Start of mapping, or NULL if failure or not supported.
+ */
+
+/**
+ * @fn static void cutest_page_unmap(void* addr, size_t length)
+ * @brief Unmap pages from #cutest_page_map().
+ */
+
+/**
+ * @fn static size_t cutest_page_size(void)
+ * @brief Get page size, 0 if not supported.
+ */
+
+/**
+ * @fn static long cutest_proc_list(const char* dir, unsigned long* buf, long size)
+ * @brief List numeric entries of \p dir, such as `/proc/self/fd`.
+ * @note The descriptor used to read `/proc/self/fd` is not listed.
+ * @param[out] buf  The lowest numbers in ascending order.
+ * @param[in] size  Capacity of \p buf, the highest entries are dropped.
+ * @return  The number of entries, including dropped ones, or -1 if not
+ *   supported.
+ */
+
+/**
+ * @fn static int cutest_proc_describe(const char* dir, unsigned long num, char* buf, unsigned long size)
+ * @brief Describe entry \p num of \p dir: target path of a file descriptor in
+ *   `/proc/self/fd`, or name of a thread in `/proc/self/task`.
+ * @return  0 if success, -1 if failure.
+ */
+
+/**
+ * @fn static int cutest_rusage_get(cutest_usage_t* usage)
+ * @brief Get resource usage of the whole process so far.
+ * @note #cutest_usage_t::maxrss is the peak resident set size, not a growth.
+ * @return  0 if success, -1 if not supported.
+ */
+
+/**
+ * @fn static int cutest_io_get(cutest_io_t* io)
+ * @brief Get I/O counters of the whole process so far.
+ * @return  0 if success, -1 if not supported.
+ */
+
+/**
+ * @fn static unsigned long cutest_process_id(void)
+ * @brief Get ID of current process.
+ */
+
+/**
+ * @fn static int cutest_dir_create(const char* path)
+ * @brief Create directory \p path that only current user can access.
+ * @return  0 if success, 1 if \p path exists, -1 if failure.
+ */
+
+/**
+ * @fn static int cutest_dir_remove(const char* path)
+ * @brief Remove directory \p path and everything in it.
+ * @return  0 if success, -1 if failure.
+ */
+
+/**
+ * @fn static int cutest_nanosleep(unsigned long long ns)
+ * @brief Sleep for at least \p ns nanoseconds.
+ * @return  0 if success, -1 if not supported.
+ */
+
+/**
+ * @fn static void cutest_thread_yield(void)
+ * @brief Give up the rest of time slice of current thread.
+ */
+
+#if defined(_WIN32)
+
+#include <windows.h>
+
+typedef struct cutest_affinity
+{
+    DWORD_PTR                   mask;           /**< Affinity before pin. */
+} cutest_affinity_t;
+
+/**
+ * @brief Pin current thread to \p cpu.
+ * @param[out] aff  Affinity before pin.
+ * @param[in] cpu   CPU index.
+ * @return          0 if success, otherwise failure.
+ */
+static int cutest_affinity_pin(cutest_affinity_t* aff, unsigned long cpu)
+{
+    if (cpu >= sizeof(DWORD_PTR) * 8)
+    {
+        return -1;
+    }
+    aff->mask = SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR)1 << cpu);
+    return aff->mask != 0 ? 0 : -1;
+}
+
+static void cutest_affinity_restore(cutest_affinity_t* aff)
+{
+    SetThreadAffinityMask(GetCurrentThread(), aff->mask);
+}
+
+static long cutest_read_file(const char* path, char* buf, unsigned long size)
+{
+    (void)path; (void)buf; (void)size;
+    return -1;
+}
+
+static size_t cutest_page_size(void)
+{
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return (size_t)info.dwPageSize;
+}
+
+static void* cutest_page_alloc(size_t length, int huge)
+{
+    (void)huge;
+    return VirtualAlloc(NULL, length, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+}
+
+static void* cutest_page_map(size_t length, size_t guard_off)
+{
+    DWORD old_protect;
+    char* addr = cutest_page_alloc(length, 0);
+    if (addr == NULL)
+    {
+        return NULL;
+    }
+    if (!VirtualProtect(addr + guard_off, cutest_page_size(), PAGE_NOACCESS, &old_protect))
+    {
+        VirtualFree(addr, 0, MEM_RELEASE);
+        return NULL;
+    }
+    return addr;
+}
+
+static void cutest_page_unmap(void* addr, size_t length)
+{
+    (void)length;
+    VirtualFree(addr, 0, MEM_RELEASE);
+}
+
+static double _cutest_filetime_ns(const FILETIME* kernel, const FILETIME* user)
+{
+    ULARGE_INTEGER k, u;
+    k.LowPart = kernel->dwLowDateTime; k.HighPart = kernel->dwHighDateTime;
+    u.LowPart = user->dwLowDateTime; u.HighPart = user->dwHighDateTime;
+    return ((double)k.QuadPart + (double)u.QuadPart) * 100.0;
+}
+
+static long cutest_proc_list(const char* dir, unsigned long* buf, long size)
+{
+    (void)dir; (void)buf; (void)size;
+    return -1;
+}
+
+static int cutest_proc_describe(const char* dir, unsigned long num, char* buf, unsigned long size)
+{
+    (void)dir; (void)num; (void)buf; (void)size;
+    return -1;
+}
+
+static int cutest_rusage_get(cutest_usage_t* usage)
+{
+    (void)usage;
+    return -1;
+}
+
+static int cutest_io_get(cutest_io_t* io)
+{
+    IO_COUNTERS counters;
+    if (!GetProcessIoCounters(GetCurrentProcess(), &counters))
+    {
+        return -1;
+    }
+
+    io->rchar = (unsigned long)counters.ReadTransferCount;
+    io->wchar = (unsigned long)counters.WriteTransferCount;
+    io->syscr = (unsigned long)counters.ReadOperationCount;
+    io->syscw = (unsigned long)counters.WriteOperationCount;
+    io->read_bytes = 0;
+    io->write_bytes = 0;
+    return 0;
+}
+
+static unsigned long cutest_process_id(void)
+{
+    return (unsigned long)GetCurrentProcessId();
+}
+
+static int cutest_dir_create(const char* path)
+{
+    (void)path;
+    return -1;
+}
+
+static int cutest_dir_remove(const char* path)
+{
+    (void)path;
+    return -1;
+}
+
+static int cutest_nanosleep(unsigned long long ns)
+{
+    Sleep((DWORD)((ns + 999999) / 1000000));
+    return 0;
+}
+
+static void cutest_thread_yield(void)
+{
+    SwitchToThread();
+}
+
+static int cutest_cputime_get(cutest_cputime_t* cpu)
+{
+    FILETIME create, exit, kernel, user;
+    if (!GetProcessTimes(GetCurrentProcess(), &create, &exit, &kernel, &user))
+    {
+        return -1;
+    }
+    cpu->process_ns = _cutest_filetime_ns(&kernel, &user);
+
+    if (!GetThreadTimes(GetCurrentThread(), &create, &exit, &kernel, &user))
+    {
+        return -1;
+    }
+    cpu->thread_ns = _cutest_filetime_ns(&kernel, &user);
+    return 0;
+}
+
+#elif defined(__linux__)
+
+#include <sched.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+
+typedef struct cutest_affinity
+{
+    cpu_set_t                   mask;           /**< Affinity before pin. */
+} cutest_affinity_t;
+
+static int cutest_affinity_pin(cutest_affinity_t* aff, unsigned long cpu)
+{
+    cpu_set_t mask;
+    if (cpu >= CPU_SETSIZE || sched_getaffinity(0, sizeof(aff->mask), &aff->mask) != 0)
+    {
+        return -1;
+    }
+
+    CPU_ZERO(&mask);
+    CPU_SET(cpu, &mask);
+    return sched_setaffinity(0, sizeof(mask), &mask) == 0 ? 0 : -1;
+}
+
+static void cutest_affinity_restore(cutest_affinity_t* aff)
+{
+    sched_setaffinity(0, sizeof(aff->mask), &aff->mask);
+}
+
+/**
+ * @brief Read content of file \p path into \p buf, NULL terminated.
+ * @return The number of bytes read, or -1 if failure.
+ */
+static long cutest_read_file(const char* path, char* buf, unsigned long size)
+{
+    long total = 0;
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+    {
+        return -1;
+    }
+
+    while ((unsigned long)total < size - 1)
+    {
+        ssize_t n = read(fd, buf + total, size - 1 - total);
+        if (n <= 0)
+        {
+            break;
+        }
+        total += (long)n;
+    }
+    buf[total] = '\0';
+
+    close(fd);
+    return total;
+}
+
+static size_t cutest_page_size(void)
+{
+    return (size_t)sysconf(_SC_PAGESIZE);
+}
+
+static void* cutest_page_alloc(size_t length, int huge)
+{
+    void* addr = mmap(NULL, length, PROT_READ | PROT_WRITE,
+        MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (addr == MAP_FAILED)
+    {
+        return NULL;
+    }
+#if defined(MADV_HUGEPAGE)
+    if (huge)
+    {
+        madvise(addr, length, MADV_HUGEPAGE);
+    }
+#else
+    (void)huge;
+#endif
+    return addr;
+}
+
+static void* cutest_page_map(size_t length, size_t guard_off)
+{
+    char* addr = cutest_page_alloc(length, 0);
+    if (addr == NULL)
+    {
+        return NULL;
+    }
+    if (mprotect(addr + guard_off, cutest_page_size(), PROT_NONE) != 0)
+    {
+        munmap(addr, length);
+        return NULL;
+    }
+    return addr;
+}
+
+static void cutest_page_unmap(void* addr, size_t length)
+{
+    munmap(addr, length);
+}
+
+/**
+ * @brief Layout of getdents64(2) record, which glibc does not declare.
+ */
+struct cutest_dirent64
+{
+    unsigned long long          d_ino;
+    long long                   d_off;
+    unsigned short              d_reclen;
+    unsigned char               d_type;
+    char                        d_name[1];
+};
+
+static long cutest_proc_list(const char* dir, unsigned long* buf, long size)
+{
+    /* opendir() allocates memory, use getdents64 directly. */
+    char records[4096];
+    long cnt = 0;
+    int fd = open(dir, O_RDONLY | O_DIRECTORY);
+    if (fd < 0)
+    {
+        return -1;
+    }
+
+    for (;;)
+    {
+        long n = syscall(SYS_getdents64, fd, records, sizeof(records));
+        if (n <= 0)
+        {
+            break;
+        }
+
+        long pos;
+        for (pos = 0; pos < n; pos += ((struct cutest_dirent64*)(records + pos))->d_reclen)
+        {
+            const struct cutest_dirent64* ent = (struct cutest_dirent64*)(records + pos);
+            unsigned long num;
+            if (cutest_porting_atoul(ent->d_name, &num) != 0 || (num == (unsigned long)fd
+                && cutest_porting_strcmp(dir, "/proc/self/fd") == 0))
+            {
+                continue;
+            }
+            /* Keep the lowest, whatever order getdents64 returns them in. */
+            long i = cnt++;
+            if (i >= size)
+            {
+                if (size == 0 || buf[size - 1] <= num)
+                {
+                    continue;
+                }
+                i = size - 1;
+            }
+
+            /* Entries are mostly in order already. */
+            for (; i > 0 && buf[i - 1] > num; i--)
+            {
+                buf[i] = buf[i - 1];
+            }
+            buf[i] = num;
+        }
+    }
+
+    close(fd);
+    return cnt;
+}
+
+static int cutest_proc_describe(const char* dir, unsigned long num, char* buf, unsigned long size)
+{
+    char path[128];
+    unsigned long len = cutest_porting_strlen(dir);
+    if (len + 32 > sizeof(path))
+    {
+        return -1;
+    }
+    cutest_porting_memcpy(path, dir, len);
+    path[len] = '/';
+    cutest_porting_ultoa(path + len + 1, num);
+
+    if (cutest_porting_strcmp(dir, "/proc/self/task") == 0)
+    {
+        char* end = path + cutest_porting_strlen(path);
+        cutest_porting_memcpy(end, "/comm", sizeof("/comm"));
+        if (cutest_read_file(path, buf, size) <= 0)
+        {
+            return -1;
+        }
+        *cutest_porting_strchrnul(buf, '\n') = '\0';
+        return 0;
+    }
+
+    ssize_t n = readlink(path, buf, size - 1);
+    if (n < 0)
+    {
+        return -1;
+    }
+    buf[n] = '\0';
+    return 0;
+}
+
+static int cutest_rusage_get(cutest_usage_t* usage)
+{
+    struct rusage ru;
+    if (getrusage(RUSAGE_SELF, &ru) != 0)
+    {
+        return -1;
+    }
+
+    usage->maxrss = (unsigned long)ru.ru_maxrss;
+    usage->minflt = (unsigned long)ru.ru_minflt;
+    usage->majflt = (unsigned long)ru.ru_majflt;
+    usage->nvcsw = (unsigned long)ru.ru_nvcsw;
+    usage->nivcsw = (unsigned long)ru.ru_nivcsw;
+    usage->inblock = (unsigned long)ru.ru_inblock;
+    usage->oublock = (unsigned long)ru.ru_oublock;
+    return 0;
+}
+
+/**
+ * @brief Find the field of \p io named \p key in `/proc/self/io`.
+ * @return  Address of the field, or NULL if unknown.
+ */
+static unsigned long* _cutest_io_field(cutest_io_t* io, const char* key)
+{
+    if (cutest_porting_strcmp(key, "rchar") == 0) return &io->rchar;
+    if (cutest_porting_strcmp(key, "wchar") == 0) return &io->wchar;
+    if (cutest_porting_strcmp(key, "syscr") == 0) return &io->syscr;
+    if (cutest_porting_strcmp(key, "syscw") == 0) return &io->syscw;
+    if (cutest_porting_strcmp(key, "read_bytes") == 0) return &io->read_bytes;
+    if (cutest_porting_strcmp(key, "write_bytes") == 0) return &io->write_bytes;
+    return NULL;
+}
+
+static int cutest_io_get(cutest_io_t* io)
+{
+    char buf[512];
+    if (cutest_read_file("/proc/self/io", buf, sizeof(buf)) <= 0)
+    {
+        return -1;
+    }
+
+    /* Each line is `key: value`. */
+    unsigned found = 0;
+    char* line = buf;
+    while (*line != '\0')
+    {
+        char* end = cutest_porting_strchrnul(line, '\n');
+        char* next = *end == '\0' ? end : end + 1;
+        *end = '\0';
+
+        char* val = cutest_porting_strchrnul(line, ':');
+        if (*val == ':')
+        {
+            *val++ = '\0';
+            unsigned long* field = _cutest_io_field(io, line);
+            if (field != NULL && cutest_porting_atoul(val, field) == 0)
+            {
+                found++;
+            }
+        }
+        line = next;
+    }
+    return found == 6 ? 0 : -1;
+}
+
+static unsigned long cutest_process_id(void)
+{
+    return (unsigned long)getpid();
+}
+
+static int cutest_dir_create(const char* path)
+{
+    if (mkdir(path, 0700) == 0)
+    {
+        return 0;
+    }
+    return errno == EEXIST ? 1 : -1;
+}
+
+/**
+ * @brief Remove everything in directory \p fd.
+ * @return  0 if success, -1 if failure.
+ */
+static int _cutest_dir_clear(int fd)
+{
+    char records[2048];
+    int ret = 0;
+
+    for (;;)
+    {
+        long n = syscall(SYS_getdents64, fd, records, sizeof(records));
+        if (n <= 0)
+        {
+            return n < 0 ? -1 : ret;
+        }
+
+        long pos;
+        for (pos = 0; pos < n; pos += ((struct cutest_dirent64*)(records + pos))->d_reclen)
+        {
+            const char* name = ((struct cutest_dirent64*)(records + pos))->d_name;
+            if (cutest_porting_strcmp(name, ".") == 0 || cutest_porting_strcmp(name, "..") == 0
+                || unlinkat(fd, name, 0) == 0)
+            {
+                continue;
+            }
+            if (errno != EISDIR)
+            {
+                ret = -1;
+                continue;
+            }
+
+            int sub = openat(fd, name, O_RDONLY | O_DIRECTORY | O_NOFOLLOW);
+            if (sub < 0 || _cutest_dir_clear(sub) != 0 || unlinkat(fd, name, AT_REMOVEDIR) != 0)
+            {
+                ret = -1;
+            }
+            if (sub >= 0)
+            {
+                close(sub);
+            }
+        }
+    }
+}
+
+static int cutest_dir_remove(const char* path)
+{
+    int fd = open(path, O_RDONLY | O_DIRECTORY | O_NOFOLLOW);
+    if (fd < 0)
+    {
+        return -1;
+    }
+
+    int ret = _cutest_dir_clear(fd);
+    close(fd);
+    return ret == 0 && rmdir(path) == 0 ? 0 : -1;
+}
+
+static int cutest_nanosleep(unsigned long long ns)
+{
+    struct timespec req;
+    req.tv_sec = (time_t)(ns / 1000000000);
+    req.tv_nsec = (long)(ns % 1000000000);
+    while (nanosleep(&req, &req) != 0)
+    {
+        if (errno != EINTR)
+        {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static void cutest_thread_yield(void)
+{
+    sched_yield();
+}
+
+static int cutest_cputime_get(cutest_cputime_t* cpu)
+{
+    struct timespec ts;
+    if (clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts) != 0)
+    {
+        return -1;
+    }
+    cpu->process_ns = (double)ts.tv_sec * 1000000000.0 + (double)ts.tv_nsec;
+
+    if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) != 0)
+    {
+        return -1;
+    }
+    cpu->thread_ns = (double)ts.tv_sec * 1000000000.0 + (double)ts.tv_nsec;
+    return 0;
+}
+
+#else
+
+typedef struct cutest_affinity
+{
+    int                         reserved;
+} cutest_affinity_t;
+
+static int cutest_affinity_pin(cutest_affinity_t* aff, unsigned long cpu)
+{
+    (void)aff; (void)cpu;
+    return -1;
+}
+
+static void cutest_affinity_restore(cutest_affinity_t* aff)
+{
+    (void)aff;
+}
+
+static long cutest_read_file(const char* path, char* buf, unsigned long size)
+{
+    (void)path; (void)buf; (void)size;
+    return -1;
+}
+
+static size_t cutest_page_size(void)
+{
+    return 0;
+}
+
+static void* cutest_page_alloc(size_t length, int huge)
+{
+    (void)length; (void)huge;
+    return NULL;
+}
+
+static void* cutest_page_map(size_t length, size_t guard_off)
+{
+    (void)length; (void)guard_off;
+    return NULL;
+}
+
+static void cutest_page_unmap(void* addr, size_t length)
+{
+    (void)addr; (void)length;
+}
+
+static long cutest_proc_list(const char* dir, unsigned long* buf, long size)
+{
+    (void)dir; (void)buf; (void)size;
+    return -1;
+}
+
+static int cutest_proc_describe(const char* dir, unsigned long num, char* buf, unsigned long size)
+{
+    (void)dir; (void)num; (void)buf; (void)size;
+    return -1;
+}
+
+static int cutest_rusage_get(cutest_usage_t* usage)
+{
+    (void)usage;
+    return -1;
+}
+
+static int cutest_io_get(cutest_io_t* io)
+{
+    (void)io;
+    return -1;
+}
+
+static unsigned long cutest_process_id(void)
+{
+    return 0;
+}
+
+static int cutest_dir_create(const char* path)
+{
+    (void)path;
+    return -1;
+}
+
+static int cutest_dir_remove(const char* path)
+{
+    (void)path;
+    return -1;
+}
+
+static int cutest_nanosleep(unsigned long long ns)
+{
+    (void)ns;
+    return -1;
+}
+
+static void cutest_thread_yield(void)
+{
+}
+
+static int cutest_cputime_get(cutest_cputime_t* cpu)
+{
+    (void)cpu;
+    return -1;
+}
+
+#endif
+
+///////////////////////////////////////////////////////////////////////////////
+// Allocation
+///////////////////////////////////////////////////////////////////////////////
+
+typedef struct test_alloc_counter
+{
+    volatile unsigned long      allocs;         /**< The number of allocations. */
+    volatile unsigned long      bytes;          /**< Total bytes of allocations. */
+    volatile unsigned long      live;           /**< The number of live allocations. */
+    volatile unsigned long      live_bytes;     /**< Bytes of live allocations. */
+    volatile unsigned long      peak_bytes;     /**< Peak of live bytes. */
+} test_alloc_counter_t;
+
+/**
+ * @brief Maximum number of frames of an allocation in no-allocation scope.
+ */
+#define ALLOC_SCOPE_MAX_FRAMES      16
+
+/**
+ * @brief Frames of #_cutest_alloc_on_alloc() and allocation function.
+ */
+#define ALLOC_SCOPE_SKIP_FRAMES     2
+
+typedef struct test_alloc_scope
+{
+    int                         depth;          /**< Nested level of scope. */
+    int                         ignore;         /**< Nested level of ignore scope. */
+    int                         busy;           /**< Recording backtrace. */
+    unsigned long               violations;     /**< The number of allocations in scope. */
+    size_t                      size;           /**< Size of first allocation in scope. */
+    int                         depth_frames;   /**< The number of frames of first allocation. */
+    void*                       frames[ALLOC_SCOPE_MAX_FRAMES]; /**< Backtrace of first allocation. */
+} test_alloc_scope_t;
+
+#if defined(CUTEST_ALLOC_TRACKER)
+
+#if !defined(__linux__) || !defined(__GLIBC__)
+#   error "CUTEST_ALLOC_TRACKER requires Linux with glibc."
+#endif
+
+#include <errno.h>
+#include <execinfo.h>
+#include <malloc.h>
+#include <time.h>
+
+/* Real allocator of glibc, which does not need dlsym() to find. */
+extern void* __libc_malloc(size_t size);
+extern void* __libc_calloc(size_t nmemb, size_t size);
+extern void* __libc_realloc(void* ptr, size_t size);
+extern void* __libc_memalign(size_t alignment, size_t size);
+extern void* __libc_valloc(size_t size);
+extern void* __libc_pvalloc(size_t size);
+extern void __libc_free(void* ptr);
+
+#define CUTEST_ALLOC_API    __attribute__((visibility("default")))
+
+static test_alloc_counter_t s_alloc;
+
+/**
+ * @brief Maximum number of live blocks allocated in ignore scope. Blocks
+ *   beyond it are tracked as usual.
+ */
+#if !defined(CUTEST_ALLOC_IGNORE_MAX)
+#   define CUTEST_ALLOC_IGNORE_MAX  256
+#endif
+
+typedef struct test_alloc_ignored
+{
+    volatile long               lock;           /**< Spin lock of blocks. */
+    volatile unsigned long      size;           /**< The number of blocks. */
+    void*                       ptrs[CUTEST_ALLOC_IGNORE_MAX];  /**< Blocks allocated in ignore scope. */
+} test_alloc_ignored_t;
+
+/**
+ * @brief Live blocks allocated in ignore scope, which are not counted as live,
+ *   so freeing them does not cancel out a real leak.
+ */
+static test_alloc_ignored_t s_alloc_ignored;
+
+/**
+ * @brief No-allocation scope of current thread.
+ * Use initial-exec model, as other models may allocate on first access.
+ */
+static __thread test_alloc_scope_t s_alloc_scope __attribute__((tls_model("initial-exec")));
+
+/**
+ * @brief Sequence number of allocation to fail, 0 if none.
+ */
+static unsigned long s_alloc_fail_at;
+
+/**
+ * @brief The number of allocation attempts since #cutest_alloc_begin().
+ */
+static volatile unsigned long s_alloc_fail_seq;
+
+/**
+ * @brief Check if current allocation should fail.
+ */
+static int _cutest_alloc_should_fail(void)
+{
+    if (s_alloc_fail_at == 0 || __sync_add_and_fetch(&s_alloc_fail_seq, 1) != s_alloc_fail_at)
+    {
+        return 0;
+    }
+    errno = ENOMEM;
+    return 1;
+}
+
+/**
+ * @brief Remember \p ptr allocated in ignore scope.
+ * @return  0 if success, -1 if the table is full.
+ */
+static int _cutest_alloc_ignored_add(void* ptr)
+{
+    int ret = -1;
+    while (__sync_lock_test_and_set(&s_alloc_ignored.lock, 1)) {}
+    if (s_alloc_ignored.size < CUTEST_ALLOC_IGNORE_MAX)
+    {
+        s_alloc_ignored.ptrs[s_alloc_ignored.size++] = ptr;
+        ret = 0;
+    }
+    __sync_lock_release(&s_alloc_ignored.lock);
+    return ret;
+}
+
+/**
+ * @brief Forget \p ptr if it is allocated in ignore scope.
+ * @return  1 if \p ptr is allocated in ignore scope, 0 if not.
+ */
+static int _cutest_alloc_ignored_remove(void* ptr)
+{
+    int ret = 0;
+    unsigned long i;
+
+    /* A block is added before its pointer is returned, so it is seen here. */
+    if (s_alloc_ignored.size == 0)
+    {
+        return 0;
+    }
+
+    while (__sync_lock_test_and_set(&s_alloc_ignored.lock, 1)) {}
+    for (i = 0; i < s_alloc_ignored.size; i++)
+    {
+        if (s_alloc_ignored.ptrs[i] == ptr)
+        {
+            s_alloc_ignored.ptrs[i] = s_alloc_ignored.ptrs[--s_alloc_ignored.size];
+            ret = 1;
+            break;
+        }
+    }
+    __sync_lock_release(&s_alloc_ignored.lock);
+    return ret;
+}
+
+/**
+ * @brief Count an allocation of \p size bytes.
+ * @param[in] live - 0 if the block is allocated in ignore scope.
+ */
+static void _cutest_alloc_add(size_t size, int live)
+{
+    __sync_add_and_fetch(&s_alloc.allocs, 1);
+    __sync_add_and_fetch(&s_alloc.bytes, size);
+    if (!live)
+    {
+        return;
+    }
+
+    __sync_add_and_fetch(&s_alloc.live, 1);
+    unsigned long live_bytes = __sync_add_and_fetch(&s_alloc.live_bytes, size);
+
+    unsigned long peak;
+    while ((peak = s_alloc.peak_bytes) < live_bytes
+        && __sync_val_compare_and_swap(&s_alloc.peak_bytes, peak, live_bytes) != peak)
+    {
+    }
+}
+
+static void _cutest_alloc_sub(size_t size)
+{
+    __sync_sub_and_fetch(&s_alloc.live, 1);
+    __sync_sub_and_fetch(&s_alloc.live_bytes, size);
+}
+
+/**
+ * @brief Check allocation inside #CUTEST_NO_ALLOC_BEGIN().
+ * It must be called by allocation functions directly, so the first two frames
+ * of backtrace are this function and the allocation function.
+ */
+static void __attribute__((noinline)) _cutest_alloc_on_alloc(void* ptr, size_t size)
+{
+    if (ptr == NULL)
+    {
+        return;
+    }
+    size_t usable = malloc_usable_size(ptr);
+
+    if (s_alloc_scope.ignore != 0)
+    {
+        _cutest_alloc_add(usable, _cutest_alloc_ignored_add(ptr) != 0);
+        return;
+    }
+    _cutest_alloc_add(usable, 1);
+    if (s_alloc_scope.depth == 0 || s_alloc_scope.busy)
+    {
+        return;
+    }
+    if (s_alloc_scope.violations++ != 0)
+    {
+        return;
+    }
+
+    /* backtrace() is warmed up in cutest_alloc_scope_enter(), keep it safe anyway. */
+    s_alloc_scope.busy = 1;
+    s_alloc_scope.size = size;
+    s_alloc_scope.depth_frames = backtrace(s_alloc_scope.frames, TEST_ARRAY_SIZE(s_alloc_scope.frames));
+    s_alloc_scope.busy = 0;
+}
+
+CUTEST_ALLOC_API void* malloc(size_t size)
+{
+    if (_cutest_alloc_should_fail())
+    {
+        return NULL;
+    }
+    void* ptr = __libc_malloc(size);
+    _cutest_alloc_on_alloc(ptr, size);
+    return ptr;
+}
+
+CUTEST_ALLOC_API void* calloc(size_t nmemb, size_t size)
+{
+    if (_cutest_alloc_should_fail())
+    {
+        return NULL;
+    }
+    void* ptr = __libc_calloc(nmemb, size);
+    _cutest_alloc_on_alloc(ptr, nmemb * size);
+    return ptr;
+}
+
+CUTEST_ALLOC_API void* realloc(void* ptr, size_t size)
+{
+    if ((ptr == NULL || size != 0) && _cutest_alloc_should_fail())
+    {
+        return NULL;
+    }
+    if (ptr == NULL)
+    {
+        ptr = __libc_malloc(size);
+        _cutest_alloc_on_alloc(ptr, size);
+        return ptr;
+    }
+
+    size_t old_size = malloc_usable_size(ptr);
+    void* ret = __libc_realloc(ptr, size);
+    if ((ret != NULL || size == 0) && !_cutest_alloc_ignored_remove(ptr))
+    {
+        _cutest_alloc_sub(old_size);
+    }
+    _cutest_alloc_on_alloc(ret, size);
+    return ret;
+}
+
+CUTEST_ALLOC_API void free(void* ptr)
+{
+    if (ptr == NULL)
+    {
+        return;
+    }
+    if (!_cutest_alloc_ignored_remove(ptr))
+    {
+        _cutest_alloc_sub(malloc_usable_size(ptr));
+    }
+    __libc_free(ptr);
+}
+
+CUTEST_ALLOC_API void* memalign(size_t alignment, size_t size)
+{
+    if (_cutest_alloc_should_fail())
+    {
+        return NULL;
+    }
+    void* ptr = __libc_memalign(alignment, size);
+    _cutest_alloc_on_alloc(ptr, size);
+    return ptr;
+}
+
+CUTEST_ALLOC_API void* aligned_alloc(size_t alignment, size_t size)
+{
+    if (_cutest_alloc_should_fail())
+    {
+        return NULL;
+    }
+    void* ptr = __libc_memalign(alignment, size);
+    _cutest_alloc_on_alloc(ptr, size);
+    return ptr;
+}
+
+CUTEST_ALLOC_API int posix_memalign(void** memptr, size_t alignment, size_t size)
+{
+    if (alignment < sizeof(void*) || (alignment & (alignment - 1)) != 0)
+    {
+        return EINVAL;
+    }
+    if (_cutest_alloc_should_fail())
+    {
+        return ENOMEM;
+    }
+
+    void* ptr = __libc_memalign(alignment, size);
+    _cutest_alloc_on_alloc(ptr, size);
+    if (ptr == NULL)
+    {
+        return ENOMEM;
+    }
+    *memptr = ptr;
+    return 0;
+}
+
+CUTEST_ALLOC_API void* valloc(size_t size)
+{
+    if (_cutest_alloc_should_fail())
+    {
+        return NULL;
+    }
+    void* ptr = __libc_valloc(size);
+    _cutest_alloc_on_alloc(ptr, size);
+    return ptr;
+}
+
+CUTEST_ALLOC_API void* pvalloc(size_t size)
+{
+    if (_cutest_alloc_should_fail())
+    {
+        return NULL;
+    }
+    void* ptr = __libc_pvalloc(size);
+    _cutest_alloc_on_alloc(ptr, size);
+    return ptr;
+}
+
+/**
+ * @brief backtrace() loads unwinder on first call, and glibc loads timezone
+ *   on first use of localtime(), both keep the memory forever. Load them
+ *   before any measurement, so they are not seen as leaks of a test.
+ */
+static void _cutest_alloc_warm_up(void)
+{
+    static int s_warmed = 0;
+    if (!s_warmed)
+    {
+        void* frames[1];
+        backtrace(frames, 1);
+
+        time_t now = time(NULL);
+        struct tm tm;
+        localtime_r(&now, &tm);
+        s_warmed = 1;
+    }
+}
+
+/**
+ * @brief Take a snapshot of allocation counters, and restart peak from now.
+ * @return  0 if success, -1 if allocations are not tracked.
+ */
+static int cutest_alloc_begin(test_alloc_counter_t* snapshot)
+{
+    _cutest_alloc_warm_up();
+    /* Count allocations to fail in the same window as allocations of test. */
+    s_alloc_fail_seq = 0;
+    s_alloc.peak_bytes = s_alloc.live_bytes;
+    *snapshot = s_alloc;
+    return 0;
+}
+
+/**
+ * @brief Get allocations since \p snapshot.
+ */
+static void cutest_alloc_end(const test_alloc_counter_t* snapshot, cutest_alloc_stat_t* stat)
+{
+    test_alloc_counter_t now = s_alloc;
+    long leaks = (long)(now.live - snapshot->live);
+    long leak_bytes = (long)(now.live_bytes - snapshot->live_bytes);
+    long peak = (long)(now.peak_bytes - snapshot->live_bytes);
+
+    stat->allocs = now.allocs - snapshot->allocs;
+    stat->bytes = now.bytes - snapshot->bytes;
+    stat->peak = peak > 0 ? (unsigned long)peak : 0;
+    stat->leaks = leaks > 0 ? (unsigned long)leaks : 0;
+    stat->leak_bytes = leak_bytes > 0 ? (unsigned long)leak_bytes : 0;
+}
+
+/**
+ * @brief Enter no-allocation scope of current thread.
+ * @return  0 if success, -1 if allocations are not tracked.
+ */
+static int cutest_alloc_scope_enter(void)
+{
+    _cutest_alloc_warm_up();
+    if (s_alloc_scope.depth++ == 0)
+    {
+        s_alloc_scope.violations = 0;
+    }
+    return 0;
+}
+
+/**
+ * @brief Leave no-allocation scope of current thread.
+ * @param[out] scope - Allocations of the outermost scope.
+ * @return  1 if the outermost scope is left, 0 if still in scope.
+ */
+static int cutest_alloc_scope_leave(test_alloc_scope_t* scope)
+{
+    if (s_alloc_scope.depth == 0 || --s_alloc_scope.depth != 0)
+    {
+        return 0;
+    }
+    *scope = s_alloc_scope;
+    return 1;
+}
+
+/**
+ * @brief Drop no-allocation scope of current thread, which is left by longjmp.
+ */
+static void cutest_alloc_scope_reset(void)
+{
+    s_alloc_scope.depth = 0;
+    s_alloc_scope.ignore = 0;
+}
+
+/**
+ * @brief Enter or leave ignore scope of current thread.
+ * @param[in] enter - 1 to enter, 0 to leave.
+ * @return  0 if success, -1 if allocations are not tracked.
+ */
+static int cutest_alloc_ignore(int enter)
+{
+    if (enter)
+    {
+        s_alloc_scope.ignore++;
+    }
+    else if (s_alloc_scope.ignore > 0)
+    {
+        s_alloc_scope.ignore--;
+    }
+    return 0;
+}
+
+/**
+ * @brief Fail the \p n-th allocation of next test.
+ * @param[in] n - Sequence number starting from 1, 0 to stop failing.
+ */
+static void cutest_alloc_fail_at(unsigned long n)
+{
+    s_alloc_fail_at = n;
+}
+
+#else
+
+static int cutest_alloc_begin(test_alloc_counter_t* snapshot)
+{
+    (void)snapshot;
+    return -1;
+}
+
+static void cutest_alloc_end(const test_alloc_counter_t* snapshot, cutest_alloc_stat_t* stat)
+{
+    (void)snapshot;
+    cutest_porting_memset(stat, 0, sizeof(*stat));
+}
+
+static int cutest_alloc_scope_enter(void)
+{
+    return -1;
+}
+
+static int cutest_alloc_scope_leave(test_alloc_scope_t* scope)
+{
+    (void)scope;
+    return 0;
+}
+
+static void cutest_alloc_scope_reset(void)
+{
+}
+
+static int cutest_alloc_ignore(int enter)
+{
+    (void)enter;
+    return -1;
+}
+
+#endif
+
+///////////////////////////////////////////////////////////////////////////////
+// Guarded Allocation
+///////////////////////////////////////////////////////////////////////////////
+
+/**
+ * @brief Spin lock on `volatile long`, for short critical sections that must
+ *   not allocate.
+ */
+#if defined(_MSC_VER)
+#   define SPIN_LOCK(p)         while (InterlockedExchange((p), 1) != 0) {}
+#   define SPIN_UNLOCK(p)       InterlockedExchange((p), 0)
+#else
+#   define SPIN_LOCK(p)         while (__sync_lock_test_and_set((p), 1) != 0) {}
+#   define SPIN_UNLOCK(p)       __sync_lock_release(p)
+#endif
+
+typedef struct test_guarded_block
+{
+    void*                       ptr;            /**< Address for user, NULL if slot is free. */
+    void*                       base;           /**< Start of mapping. */
+    size_t                      length;         /**< Length of mapping. */
+} test_guarded_block_t;
+
+typedef struct test_guarded_ctx
+{
+    volatile long               lock;           /**< Spin lock of blocks. */
+    test_guarded_block_t        blocks[CUTEST_GUARDED_MAX]; /**< Live blocks. */
+} test_guarded_ctx_t;
+
+/**
+ * @brief Blocks of #cutest_guarded_alloc().
+ * The mapping cannot be found from user address, as it depends on the guard.
+ */
+static test_guarded_ctx_t s_guarded;
+
+static void* _cutest_guarded_alloc(size_t size, cutest_guard_t guard)
+{
+    size_t page = cutest_page_size();
+    if (page == 0 || size > (size_t)-1 - 2 * page)
+    {
+        return NULL;
+    }
+
+    size_t data_len = (size + page - 1) / page * page;
+    if (data_len == 0)
+    {
+        data_len = page;
+    }
+    size_t length = data_len + page;
+
+    size_t guard_off = guard == CUTEST_GUARD_START ? 0 : data_len;
+    char* base = cutest_page_map(length, guard_off);
+    if (base == NULL)
+    {
+        return NULL;
+    }
+    char* ptr = guard == CUTEST_GUARD_START ? base + page : base + data_len - size;
+
+    size_t i;
+    SPIN_LOCK(&s_guarded.lock);
+    for (i = 0; i < CUTEST_GUARDED_MAX; i++)
+    {
+        test_guarded_block_t* block = &s_guarded.blocks[i];
+        if (block->ptr == NULL)
+        {
+            block->ptr = ptr;
+            block->base = base;
+            block->length = length;
+            break;
+        }
+    }
+    SPIN_UNLOCK(&s_guarded.lock);
+
+    if (i == CUTEST_GUARDED_MAX)
+    {
+        cutest_page_unmap(base, length);
+        return NULL;
+    }
+    return ptr;
+}
+
+/**
+ * @return  0 if success, -1 if \p ptr is not from #_cutest_guarded_alloc().
+ */
+static int _cutest_guarded_free(void* ptr)
+{
+    test_guarded_block_t found = { NULL, NULL, 0 };
+
+    size_t i;
+    SPIN_LOCK(&s_guarded.lock);
+    for (i = 0; i < CUTEST_GUARDED_MAX; i++)
+    {
+        test_guarded_block_t* block = &s_guarded.blocks[i];
+        if (block->ptr == ptr)
+        {
+            found = *block;
+            block->ptr = NULL;
+            break;
+        }
+    }
+    SPIN_UNLOCK(&s_guarded.lock);
+
+    if (found.ptr == NULL)
+    {
+        return -1;
+    }
+    cutest_page_unmap(found.base, found.length);
+    return 0;
+}
+
+/**
+ * @brief Free blocks still alive, which a test may skip by a failed assertion.
+ * @return  The number of blocks freed.
+ */
+static unsigned long _cutest_guarded_release(void)
+{
+    unsigned long cnt = 0;
+
+    size_t i;
+    SPIN_LOCK(&s_guarded.lock);
+    for (i = 0; i < CUTEST_GUARDED_MAX; i++)
+    {
+        test_guarded_block_t* block = &s_guarded.blocks[i];
+        if (block->ptr != NULL)
+        {
+            cutest_page_unmap(block->base, block->length);
+            block->ptr = NULL;
+            cnt++;
+        }
+    }
+    SPIN_UNLOCK(&s_guarded.lock);
+
+    return cnt;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Arena
+///////////////////////////////////////////////////////////////////////////////
+
+/**
+ * @brief Alignment of #cutest_arena_alloc().
+ */
+#define ARENA_ALIGN             16
+
+typedef struct test_arena_ctx
+{
+    volatile long               lock;           /**< Spin lock. */
+    char*                       base;           /**< Start of mapping, NULL if not mapped. */
+    size_t                      length;         /**< Length of mapping. */
+    size_t                      used;           /**< Bytes allocated. */
+} test_arena_ctx_t;
+
+static test_arena_ctx_t s_arena;
+
+/**
+ * @brief Allocate from arena, map it on first use.
+ * @param[in] size - Size of memory.
+ * @param[in] length - Length of mapping.
+ * @param[in] huge - Ask for huge pages.
+ */
+static void* _cutest_arena_alloc(size_t size, size_t length, int huge)
+{
+    void* ptr = NULL;
+    if (size > (size_t)-1 - ARENA_ALIGN)
+    {
+        return NULL;
+    }
+    size = (size + ARENA_ALIGN - 1) / ARENA_ALIGN * ARENA_ALIGN;
+
+    SPIN_LOCK(&s_arena.lock);
+    if (s_arena.base == NULL)
+    {
+        s_arena.base = cutest_page_alloc(length, huge);
+        s_arena.length = s_arena.base != NULL ? length : 0;
+        s_arena.used = 0;
+    }
+    if (size <= s_arena.length - s_arena.used)
+    {
+        ptr = s_arena.base + s_arena.used;
+        s_arena.used += size;
+    }
+    SPIN_UNLOCK(&s_arena.lock);
+
+    return ptr;
+}
+
+/**
+ * @brief Free everything in arena, the memory is kept for next test.
+ * @return  Bytes allocated before reset.
+ */
+static size_t _cutest_arena_reset(void)
+{
+    SPIN_LOCK(&s_arena.lock);
+    size_t used = s_arena.used;
+    s_arena.used = 0;
+    SPIN_UNLOCK(&s_arena.lock);
+
+    return used;
+}
+
+/**
+ * @brief Unmap arena.
+ */
+static void _cutest_arena_release(void)
+{
+    if (s_arena.base != NULL)
+    {
+        cutest_page_unmap(s_arena.base, s_arena.length);
+    }
+    s_arena.base = NULL;
+    s_arena.length = 0;
+    s_arena.used = 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// I/O Fault
+///////////////////////////////////////////////////////////////////////////////
+
+typedef struct test_io_fault_stat
+{
+    unsigned long               delayed;        /**< The number of delayed operations. */
+    unsigned long               shorted;        /**< The number of short reads and writes. */
+    unsigned long               eintr;          /**< The number of operations failed with EINTR. */
+    unsigned long               eio;            /**< The number of operations failed with EIO. */
+} test_io_fault_stat_t;
+
+#if defined(CUTEST_IO_FAULT)
+
+#if !defined(__linux__)
+#   error "CUTEST_IO_FAULT requires Linux."
+#endif
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdarg.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+#define CUTEST_IO_API       __attribute__((visibility("default")))
+
+/**
+ * @brief File descriptors at or above this are never matched by
+ *   #cutest_io_fault_t::path.
+ */
+#define IO_FAULT_MAX_FDS    1024
+
+typedef struct test_io_fault_ctx
+{
+    volatile long               lock;           /**< Spin lock. */
+    volatile int                active;         /**< Whether faults are injected. */
+    int                         used;           /**< Whether faults are set in current test. */
+    cutest_io_fault_t           cfg;            /**< Configuration of current test. */
+    unsigned long               path_len;       /**< Length of #cutest_io_fault_t::path. */
+    unsigned long long          rand;           /**< State of random number generator. */
+    unsigned char               fds[IO_FAULT_MAX_FDS / 8]; /**< Descriptors opened under #cutest_io_fault_t::path. */
+    test_io_fault_stat_t        stat;           /**< Injected faults. */
+} test_io_fault_ctx_t;
+
+static test_io_fault_ctx_t s_io_fault;
+
+/**
+ * @brief xorshift64*, so faults only depend on #cutest_io_fault_t::seed.
+ * @note Must be called with #test_io_fault_ctx_t::lock held.
+ */
+static unsigned long long _cutest_io_fault_rand(void)
+{
+    unsigned long long x = s_io_fault.rand;
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    s_io_fault.rand = x;
+    return x * 2685821657736338717ULL;
+}
+
+/**
+ * @note Must be called with #test_io_fault_ctx_t::lock held.
+ */
+static int _cutest_io_fault_match_fd(int fd)
+{
+    if (s_io_fault.cfg.path == NULL)
+    {
+        return 1;
+    }
+    return fd >= 0 && fd < IO_FAULT_MAX_FDS && (s_io_fault.fds[fd / 8] & (1 << (fd % 8)));
+}
+
+static int _cutest_io_fault_match_path(const char* path)
+{
+    return s_io_fault.cfg.path == NULL || (path != NULL
+        && cutest_porting_strncmp(path, s_io_fault.cfg.path, s_io_fault.path_len) == 0);
+}
+
+static void _cutest_io_fault_mark_fd(int fd, int match)
+{
+    if (fd < 0 || fd >= IO_FAULT_MAX_FDS)
+    {
+        return;
+    }
+
+    SPIN_LOCK(&s_io_fault.lock);
+    if (match)
+    {
+        s_io_fault.fds[fd / 8] |= (unsigned char)(1 << (fd % 8));
+    }
+    else
+    {
+        s_io_fault.fds[fd / 8] &= (unsigned char)~(1 << (fd % 8));
+    }
+    SPIN_UNLOCK(&s_io_fault.lock);
+}
+
+/**
+ * @brief Decide faults of one operation and apply its latency.
+ * @param[in] op - #cutest_io_op_t.
+ * @param[in] match - Whether the file matches #cutest_io_fault_t::path.
+ * @param[in,out] count - Bytes to transfer, may be cut short. NULL if not
+ *   a read or write.
+ * @return  errno to fail with, or 0 to go on.
+ */
+static int _cutest_io_fault_inject(unsigned op, int match, size_t* count)
+{
+    if (!s_io_fault.active)
+    {
+        return 0;
+    }
+
+    int err = 0;
+    unsigned long long latency = 0;
+    SPIN_LOCK(&s_io_fault.lock);
+    if (!s_io_fault.active || !match || !(s_io_fault.cfg.ops & op))
+    {
+        SPIN_UNLOCK(&s_io_fault.lock);
+        return 0;
+    }
+
+    const cutest_io_fault_t* cfg = &s_io_fault.cfg;
+    latency = (unsigned long long)cfg->latency_us * 1000;
+    if (cfg->jitter_us != 0)
+    {
+        latency += _cutest_io_fault_rand() % ((unsigned long long)cfg->jitter_us * 1000 + 1);
+    }
+    if (cfg->tail_pct != 0 && _cutest_io_fault_rand() % 100 < cfg->tail_pct)
+    {
+        latency += (unsigned long long)cfg->tail_us * 1000;
+    }
+
+    unsigned long long roll = _cutest_io_fault_rand() % 100;
+    if (roll < cfg->eio_pct)
+    {
+        err = EIO;
+        s_io_fault.stat.eio++;
+    }
+    else if (roll < (unsigned long long)cfg->eio_pct + cfg->eintr_pct)
+    {
+        err = EINTR;
+        s_io_fault.stat.eintr++;
+    }
+    else if (count != NULL && *count > 1 && cfg->short_pct != 0
+        && _cutest_io_fault_rand() % 100 < cfg->short_pct)
+    {
+        *count = 1 + (size_t)(_cutest_io_fault_rand() % (*count - 1));
+        s_io_fault.stat.shorted++;
+    }
+    if (latency != 0)
+    {
+        s_io_fault.stat.delayed++;
+    }
+    SPIN_UNLOCK(&s_io_fault.lock);
+
+    if (latency != 0)
+    {
+        cutest_sleep(latency);
+    }
+    return err;
+}
+
+static int _cutest_io_fault_open(const char* path, int flags, mode_t mode)
+{
+    int match = _cutest_io_fault_match_path(path);
+    int err = _cutest_io_fault_inject(CUTEST_IO_OPEN, match, NULL);
+    if (err != 0)
+    {
+        errno = err;
+        return -1;
+    }
+
+    int fd = (int)syscall(SYS_openat, AT_FDCWD, path, flags, mode);
+    if (s_io_fault.active && s_io_fault.cfg.path != NULL)
+    {
+        _cutest_io_fault_mark_fd(fd, match);
+    }
+    return fd;
+}
+
+CUTEST_IO_API int open(const char* path, int flags, ...)
+{
+    mode_t mode = 0;
+    if (flags & (O_CREAT | O_TMPFILE))
+    {
+        va_list ap;
+        va_start(ap, flags);
+        mode = va_arg(ap, mode_t);
+        va_end(ap);
+    }
+    return _cutest_io_fault_open(path, flags, mode);
+}
+
+CUTEST_IO_API int open64(const char* path, int flags, ...)
+{
+    mode_t mode = 0;
+    if (flags & (O_CREAT | O_TMPFILE))
+    {
+        va_list ap;
+        va_start(ap, flags);
+        mode = va_arg(ap, mode_t);
+        va_end(ap);
+    }
+    return _cutest_io_fault_open(path, flags | O_LARGEFILE, mode);
+}
+
+CUTEST_IO_API int close(int fd)
+{
+    if (s_io_fault.active && s_io_fault.cfg.path != NULL)
+    {
+        _cutest_io_fault_mark_fd(fd, 0);
+    }
+    return (int)syscall(SYS_close, fd);
+}
+
+CUTEST_IO_API ssize_t read(int fd, void* buf, size_t count)
+{
+    int err = _cutest_io_fault_inject(CUTEST_IO_READ, _cutest_io_fault_match_fd(fd), &count);
+    if (err != 0)
+    {
+        errno = err;
+        return -1;
+    }
+    return (ssize_t)syscall(SYS_read, fd, buf, count);
+}
+
+CUTEST_IO_API ssize_t write(int fd, const void* buf, size_t count)
+{
+    int err = _cutest_io_fault_inject(CUTEST_IO_WRITE, _cutest_io_fault_match_fd(fd), &count);
+    if (err != 0)
+    {
+        errno = err;
+        return -1;
+    }
+    return (ssize_t)syscall(SYS_write, fd, buf, count);
+}
+
+CUTEST_IO_API int fsync(int fd)
+{
+    int err = _cutest_io_fault_inject(CUTEST_IO_FSYNC, _cutest_io_fault_match_fd(fd), NULL);
+    if (err != 0)
+    {
+        errno = err;
+        return -1;
+    }
+    return (int)syscall(SYS_fsync, fd);
+}
+
+static int cutest_io_fault_begin(const cutest_io_fault_t* fault)
+{
+    if (fault != NULL && (fault->eio_pct + fault->eintr_pct > 100
+        || fault->short_pct > 100 || fault->tail_pct > 100))
+    {
+        return -1;
+    }
+
+    SPIN_LOCK(&s_io_fault.lock);
+    s_io_fault.active = 0;
+    cutest_porting_memset(s_io_fault.fds, 0, sizeof(s_io_fault.fds));
+    if (fault != NULL)
+    {
+        s_io_fault.cfg = *fault;
+        s_io_fault.path_len = fault->path != NULL ? cutest_porting_strlen(fault->path) : 0;
+        s_io_fault.rand = (unsigned long long)fault->seed ^ 0x9E3779B97F4A7C15ULL;
+        s_io_fault.active = 1;
+        s_io_fault.used = 1;
+    }
+    SPIN_UNLOCK(&s_io_fault.lock);
+    return 0;
+}
+
+/**
+ * @brief Stop injecting faults of current test.
+ * @param[out] stat - Faults injected in current test.
+ * @return  Whether faults were configured in current test.
+ */
+static int cutest_io_fault_end(test_io_fault_stat_t* stat)
+{
+    SPIN_LOCK(&s_io_fault.lock);
+    int used = s_io_fault.used;
+    *stat = s_io_fault.stat;
+    s_io_fault.active = 0;
+    s_io_fault.used = 0;
+    cutest_porting_memset(&s_io_fault.cfg, 0, sizeof(s_io_fault.cfg));
+    cutest_porting_memset(&s_io_fault.stat, 0, sizeof(s_io_fault.stat));
+    SPIN_UNLOCK(&s_io_fault.lock);
+    return used;
+}
+
+#else
+
+static int cutest_io_fault_begin(const cutest_io_fault_t* fault)
+{
+    (void)fault;
+    return -1;
+}
+
+static int cutest_io_fault_end(test_io_fault_stat_t* stat)
+{
+    (void)stat;
+    return 0;
+}
+
+#endif
+
+/************************************************************************/
+/* test                                                                 */
+/************************************************************************/
+
+#define COLOR_GREEN(str)                    "@G" str "@D"
+#define COLOR_RED(str)                      "@R" str "@D"
+#define COLOR_YELLO(str)                    "@Y" str "@D"
+
+#define MASK_FAILURE                        (0x01 << 0x00)
+#define MASK_SKIPPED                        (0x01 << 0x01)
+#define SET_MASK(val, mask)                 do { (val) |= (mask); } while (0)
+#define HAS_MASK(val, mask)                 ((val) & (mask))
+
+#define MAX_RAND                            99999
+
+/**
+ * @brief microseconds in one second
+ */
+#define USEC_IN_SEC                         (1 * 1000 * 1000)
+
+/**
+ * @brief The default value of `--test_bench_min_time`, in milliseconds.
+ */
+#define BENCH_DEFAULT_MIN_TIME              100
+
+/**
+ * @brief The maximum number of iterations in one benchmark measurement.
+ */
+#define BENCH_MAX_ITERATIONS                1000000000UL
+
+/**
+ * @brief A load test sleeps until this many nanoseconds before the intended
+ *   start time of a call, and spins for the rest, as sleep is not precise.
+ */
+#if defined(_WIN32)
+#   define BENCH_LOAD_SPIN_NS                2000000
+#else
+#   define BENCH_LOAD_SPIN_NS                200000
+#endif
+
+/**
+ * @brief The maximum number of threads a multi-threaded benchmark can use.
+ */
+#if !defined(CUTEST_BENCH_MAX_THREADS)
+#   define CUTEST_BENCH_MAX_THREADS         256
+#endif
+
+/**
+ * @brief Latency histogram: each power of two range is split into this many
+ *   linear sub-buckets (as bits), so the relative error is less than 1%.
+ */
+#define BENCH_HIST_SUB_BITS                 8
+
+/**
+ * @brief Latency histogram: values equal or larger than `2^N` nanoseconds
+ *   (about 18 minutes) are counted as the largest value.
+ */
+#define BENCH_HIST_MAX_BITS                 40
+
+#define BENCH_HIST_SUB_COUNT                (1UL << BENCH_HIST_SUB_BITS)
+#define BENCH_HIST_SUB_HALF                 (1UL << (BENCH_HIST_SUB_BITS - 1))
+#define BENCH_HIST_BUCKETS                  (BENCH_HIST_MAX_BITS - BENCH_HIST_SUB_BITS + 1)
+#define BENCH_HIST_SIZE                     ((BENCH_HIST_BUCKETS + 1) * BENCH_HIST_SUB_HALF)
+
+/**
+ * @brief The number of empty iterations to measure timestamp overhead.
+ */
+#define BENCH_HIST_CALIBRATION              1000
+
+/**
+ * @brief The maximum number of entries of `--test_report_slowest`.
+ */
+#if !defined(CUTEST_REPORT_SLOWEST_MAX)
+#   define CUTEST_REPORT_SLOWEST_MAX        256
+#endif
+
+/**
+ * @brief Tests faster than this (in milliseconds) are never flagged as waiting.
+ */
+#define REPORT_WAITING_MIN_MS               10
+
+/**
+ * @brief The default value of `--test_budget_tolerance`.
+ */
+#define BUDGET_DEFAULT_TOLERANCE            10
+
+/**
+ * @brief The default value of `--test_budget_retry`.
+ */
+#define BUDGET_DEFAULT_RETRY                2
+
+/**
+ * @brief The default value of `--test_alloc_leaks`.
+ */
+#define ALLOC_DEFAULT_LEAKS                 2
+
+/**
+ * @brief The default value of `--test_arena_size`.
+ */
+#define ARENA_DEFAULT_SIZE                  256
+
+/**
+ * @brief The maximum value of `--test_arena_size`, so its bytes fit in size_t.
+ */
+#define ARENA_MAX_SIZE                      ((unsigned long)((size_t)-1 / (1024 * 1024) / 2))
+
+/**
+ * @brief The maximum number of names tried by #cutest_tmpdir() if they exist.
+ */
+#define TMPDIR_MAX_TRIES                    64
+
+/**
+ * @brief The maximum number of threads sleeping in #cutest_sleep() at the same
+ *   time with `--test_virtual_time`.
+ */
+#if !defined(CUTEST_VTIME_MAX_SLEEPERS)
+#   define CUTEST_VTIME_MAX_SLEEPERS        64
+#endif
+
+/**
+ * @brief The default value of `--test_profile_hz`.
+ */
+#define PROFILE_DEFAULT_HZ                  1000
+
+/**
+ * @brief The maximum number of distinct stacks recorded by `--test_profile`.
+ */
+#if !defined(CUTEST_PROFILE_MAX_STACKS)
+#   define CUTEST_PROFILE_MAX_STACKS        4096
+#endif
+
+/**
+ * @brief The maximum depth of stacks recorded by `--test_profile`.
+ */
+#if !defined(CUTEST_PROFILE_MAX_DEPTH)
+#   define CUTEST_PROFILE_MAX_DEPTH         32
+#endif
+
+/**
+ * @brief The maximum length of a path built by cutest.
+ */
+#define CUTEST_PATH_MAX                     4096
+
+#define CONTAINER_OF(ptr, TYPE, member) \
+    ((TYPE*)((char*)(ptr) - (char*)&((TYPE*)0)->member))
+
+/**
+ * @brief Create compare context for \p TYPE.
+ * @param[in] TYPE  Data type.
+ */
+#define TEST_GENERATE_NATIVE_COMPARE(NAME, TYPE)  \
+    TEST_GENERATE_TEMPLATE_COMPARE(NAME, TYPE, _cutest_smart_print_int)
+
+#define TEST_GENERATE_TEMPLATE_COMPARE(NAME, TYPE, PRINT)   \
+    static int _test_cmp_##NAME(TYPE* addr1, TYPE* addr2) {\
+        TYPE v1 = *addr1;\
+        TYPE v2 = *addr2;\
+        if (v1 == v2) {\
+            return 0;\
+        }\
+        return v1 < v2 ? -1 : 1;\
+    }\
+    static int _test_print_##NAME(FILE* file, TYPE* addr) {\
+        int is_signed = ((TYPE)(-1)) < ((TYPE)1);\
+        return PRINT(file, addr, sizeof(TYPE), is_signed);\
+    }\
+    static cutest_type_info_t NAME = {\
+        { NULL, NULL, NULL }, #TYPE,\
+        (cutest_custom_type_cmp_fn)_test_cmp_##NAME,\
+        (cutest_custom_type_dump_fn)_test_print_##NAME,\
+    }
+
+typedef struct test_case_info
+{
+    char                        fmt_name[256];  /**< Formatted name. */
+    unsigned long               fmt_name_sz;    /**< The length of formatted name, not include NULL termainator. */
+
+    cutest_case_t*              test_case;      /**< Test case. */
+
+    cutest_porting_timespec_t   tv_case_beg;    /**< Start time. */
+    cutest_porting_timespec_t   tv_case_end;    /**< End time. */
+
+    double                      ns_setup;       /**< Nanoseconds of setup stage, including hooks. */
+    double                      ns_body;        /**< Nanoseconds of body stage, including hooks. */
+    double                      ns_teardown;    /**< Nanoseconds of teardown stage, including hooks. */
+
+    int                         has_cpu;        /**< Whether #test_case_info_t::cpu_beg is valid. */
+    cutest_cputime_t            cpu_beg;        /**< CPU time at start. */
+
+    int                         has_alloc;      /**< Whether allocations are tracked. */
+    test_alloc_counter_t        alloc_beg;      /**< Allocation counters at start. */
+    cutest_alloc_stat_t         alloc;          /**< Allocations of this run. */
+
+    int                         has_sweep;      /**< Whether `--test_fail_alloc_sweep` is done. */
+    unsigned long               sweep_crashed;  /**< The number of failure points that crash. */
+    unsigned long               sweep_leaked;   /**< The number of failure points that leak. */
+
+    size_t                      arena_used;     /**< Bytes of #cutest_arena_alloc(). */
+
+    int                         has_io_fault;   /**< Whether #cutest_io_fault_set() is called. */
+    test_io_fault_stat_t        io_fault;       /**< Injected I/O faults. */
+} test_case_info_t;
+
+typedef struct fixture_run_helper
+{
+    test_case_info_t*           info;
+    int                         ret;
+} fixture_run_helper_t;
+
+typedef struct test_case_helper
+{
+    test_case_info_t*           info;
+    int                         ret;
+} test_case_helper_t;
+
+typedef struct test_run_parameterized_helper
+{
+    test_case_info_t*           info;
+} test_run_parameterized_helper_t;
+
+typedef struct test_ctx
+{
+    cutest_map_t                    case_table;                     /**< Cases in map */
+    cutest_map_t                    type_table;                     /**< Type table. */
+
+    struct
+    {
+        void*                       tid;                            /**< Thread ID */
+        cutest_case_t*              cur_node;                       /**< Current running test case node. */
+        int                         has_usage;                      /**< Whether #test_ctx_t::runtime::usage_beg is valid. */
+        cutest_usage_t              usage_beg;                      /**< Resource usage at start of current case. */
+        int                         has_io;                         /**< Whether #test_ctx_t::runtime::io_beg is valid. */
+        cutest_io_t                 io_beg;                         /**< I/O counters at start of current case. */
+        cutest_io_t                 io_probe;                       /**< I/O cost of reading the counters once. */
+        unsigned long               assertions;                     /**< The number of assertions of current case. */
+        const char*                 failure_file;                   /**< Source file of failed assertion. */
+        int                         failure_line;                   /**< Source line of failed assertion. */
+    } runtime;
+
+    struct
+    {
+        struct
+        {
+            unsigned                total;                          /**< The number of total running cases */
+            unsigned                disabled;                       /**< The number of disabled cases */
+            unsigned                success;                        /**< The number of success cases */
+            unsigned                skipped;                        /**< The number of skipped cases */
+            unsigned                failed;                         /**< The number of failed cases */
+        } result;
+
+        struct
+        {
+            unsigned long           repeat;                         /**< How many times need to repeat */
+            unsigned long           repeated;                       /**< How many times already repeated */
+        } repeat;
+    } counter;
+
+    struct
+    {
+        test_str_t                  pattern;                         /**< `--test_filter` */
+    } filter;
+
+    struct
+    {
+        unsigned long               min_time;                       /**< `--test_bench_min_time` */
+        unsigned long               max_threads;                    /**< `--test_bench_threads` */
+        const char*                 hgrm;                           /**< `--test_bench_hgrm` */
+        unsigned long               warmup;                         /**< `--test_bench_warmup` */
+        unsigned long               cpu;                            /**< `--test_bench_cpu` */
+        int                         pin;                            /**< Whether `--test_bench_cpu` is set. */
+        int                         env_shown;                      /**< Whether environment is printed. */
+        unsigned long               bytes;                          /**< Bytes processed per iteration. */
+        unsigned long               items;                          /**< Items processed per iteration. */
+    } bench;
+
+    struct
+    {
+        const char*                 path;                           /**< `--test_profile` */
+        unsigned long               hz;                             /**< `--test_profile_hz` */
+    } profile;
+
+    struct
+    {
+        const char*                 path;                           /**< `--test_trace` */
+        FILE*                       file;                           /**< Trace file. */
+        cutest_porting_timespec_t   tv_start;                       /**< Time of trace start. */
+        unsigned long               lanes;                          /**< The number of named lanes. */
+    } trace;
+
+    struct
+    {
+        unsigned long               slowest;                        /**< `--test_report_slowest` */
+        unsigned long               variance;                       /**< `--test_report_variance` */
+        unsigned long               waiting;                        /**< `--test_report_waiting` */
+    } report;
+
+    struct
+    {
+        unsigned long               tolerance;                      /**< `--test_budget_tolerance` */
+        unsigned long               retry;                          /**< `--test_budget_retry` */
+        unsigned long               max_io_bytes;                   /**< `--test_max_io_bytes` */
+    } budget;
+
+    struct
+    {
+        unsigned long               size;                           /**< `--test_arena_size` */
+        int                         huge_pages;                     /**< `--test_arena_huge_pages` */
+    } arena;
+
+    struct
+    {
+        const char*                 root;                           /**< `--test_tmpdir_root` */
+    } tmpdir;
+
+    struct
+    {
+        unsigned                    break_on_failure : 1;           /**< DebugBreak when failure */
+        unsigned                    no_print_time : 1;              /**< Whether to print execution cost time */
+        unsigned                    print_stage_time : 1;           /**< Whether to print cost time of each stage */
+        unsigned                    also_run_disabled_tests : 1;    /**< Also run disabled tests */
+        unsigned                    shuffle : 1;                    /**< Randomize running cases */
+        unsigned                    print_usage : 1;                /**< Whether to print resource usage */
+        unsigned                    fail_alloc_sweep : 1;           /**< `--test_fail_alloc_sweep` */
+        unsigned                    sweep_child : 1;                /**< Running in child of `--test_fail_alloc_sweep` */
+        unsigned                    check_leaks : 2;                /**< `--test_check_leaks` */
+        unsigned                    alloc_leaks : 2;                /**< `--test_alloc_leaks` */
+        unsigned                    virtual_time : 1;               /**< `--test_virtual_time` */
+    } mask;
+
+    struct
+    {
+        cutest_porting_jmpbuf_t*    addr;                           /**< Jump address. */
+        cutest_porting_longjmp_fn   func;                           /**< Long jump function. */
+    } jmp;
+
+    FILE*                           out;
+    const cutest_hook_t*            hook;
+    const cutest_hook_ex_t*         hook_ex;
+} test_ctx_t;
+
+static int _cutest_on_cmp_case(const cutest_map_node_t* key1, const cutest_map_node_t* key2, void* arg)
+{
+    (void)arg;
+    int ret;
+
+    cutest_case_t* t1 = CONTAINER_OF(key1, cutest_case_t, node);
+    cutest_case_t* t2 = CONTAINER_OF(key2, cutest_case_t, node);
+
+    /* randkey always go first. */
+    if (t1->data.randkey < t2->data.randkey)
+    {
+        return -1;
+    }
+    if (t1->data.randkey > t2->data.randkey)
+    {
+        return 1;
+    }
+
+    if ((ret = cutest_porting_strcmp(t1->info.fixture_name, t2->info.fixture_name)) != 0)
+    {
+        return ret;
+    }
+
+    if ((ret = cutest_porting_strcmp(t1->info.case_name, t2->info.case_name)) != 0)
+    {
+        return ret;
+    }
+
+    if (t1->parameterized.param_idx == t2->parameterized.param_idx)
+    {
+        return 0;
+    }
+    return t1->parameterized.param_idx < t2->parameterized.param_idx ? -1 : 1;
+}
+
+static int _cutest_on_cmp_type(const cutest_map_node_t* key1, const cutest_map_node_t* key2, void* arg)
+{
+    (void)arg;
+    cutest_type_info_t* t1 = CONTAINER_OF(key1, cutest_type_info_t, node);
+    cutest_type_info_t* t2 = CONTAINER_OF(key2, cutest_type_info_t, node);
+
+    return cutest_porting_strcmp(t1->type_name, t2->type_name);
+}
+
+static test_ctx_t g_test_ctx = {
+    CUTEST_MAP_INIT(_cutest_on_cmp_case, NULL),                         /* .case_table */
+    CUTEST_MAP_INIT(_cutest_on_cmp_type, NULL),                         /* .type_table */
+    { NULL, NULL, 0, { 0, 0, 0, 0, 0, 0, 0 }, 0, { 0, 0, 0, 0, 0, 0 }, { 0, 0, 0, 0, 0, 0 }, 0, NULL, 0 }, /* .runtime */
+    { { 0, 0, 0, 0, 0 }, { 0, 0 } },                                    /* .counter */
+    { { NULL, 0 } },                                                    /* .filter */
+    { 0, 0, NULL, 0, 0, 0, 0, 0, 0 },                                   /* .bench */
+    { NULL, 0 },                                                        /* .profile */
+    { NULL, NULL, { 0, 0 }, 0 },                                        /* .trace */
+    { 0, 0, 0 },                                                        /* .report */
+    { 0, 0, 0 },                                                        /* .budget */
+    { 0, 0 },                                                           /* .arena */
+    { NULL },                                                           /* .tmpdir */
+    { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 },                                /* .mask */
+    { NULL, NULL },                                                     /* .jmp */
+    NULL,                                                               /* .out */
+    NULL,                                                               /* .hook */
+    NULL,                                                               /* .hook_ex */
+};
+
+static const char* s_test_help_encoded =
+"This program contains tests written using cutest. You can use the\n"
+"following command line flags to control its behavior:\n"
+"\n"
+"Test Selection:\n"
+"  " COLOR_GREEN("--test_list_tests") "\n"
+"      List the names of all tests instead of running them. The name of\n"
+"      TEST(Foo, Bar) is \"Foo.Bar\".\n"
+"  " COLOR_GREEN("--test_list_types") "\n"
+"      List the names of all support types.\n"
+"  " COLOR_GREEN("--test_filter=") COLOR_YELLO("POSTIVE_PATTERNS[") COLOR_GREEN("-") COLOR_YELLO("NEGATIVE_PATTERNS]") "\n"
+"      Run only the tests whose name matches one of the positive patterns but\n"
+"      none of the negative patterns. '?' matches any single character; '*'\n"
+"      matches any substring; ':' separates two patterns.\n"
+"  " COLOR_GREEN("--test_also_run_disabled_tests") "\n"
+"      Run all disabled tests too.\n"
+"\n"
+"Test Execution:\n"
+"  " COLOR_GREEN("--test_repeat=") COLOR_YELLO("[COUNT]") "\n"
+"      Run the tests repeatedly; use a negative count to repeat forever.\n"
+"  " COLOR_GREEN("--test_shuffle") "\n"
+"      Randomize tests' orders on every iteration.\n"
+"  " COLOR_GREEN("--test_random_seed=") COLOR_YELLO("[NUMBER]") "\n"
+"      Random number seed to use for shuffling test orders (between 0 and\n"
+"      " TEST_STRINGIFY(MAX_RAND) ". By default a seed based on the current time is used for shuffle).\n"
+"  " COLOR_GREEN("--test_fail_alloc_sweep") "\n"
+"      Re-run each passing test in a child process once for each of its K\n"
+"      allocations, failing the Nth allocation for N = 1..K, and fail the test if\n"
+"      any of the runs crashes or leaks. Requires CUTEST_ALLOC_TRACKER.\n"
+"  " COLOR_GREEN("--test_arena_size=") COLOR_YELLO("[MB]") "\n"
+"      Address space reserved for cutest_arena_alloc(). By default it is " TEST_STRINGIFY(ARENA_DEFAULT_SIZE) " MB,\n"
+"      at most half of the address space.\n"
+"  " COLOR_GREEN("--test_arena_huge_pages") "\n"
+"      Back cutest_arena_alloc() with transparent huge pages where supported.\n"
+"  " COLOR_GREEN("--test_tmpdir_root=") COLOR_YELLO("[DIR]") "\n"
+"      Create directories of cutest_tmpdir() in the given directory. By default\n"
+"      /dev/shm is used, or /tmp if it is not available.\n"
+"  " COLOR_GREEN("--test_virtual_time") "\n"
+"      Run cutest_now() and cutest_sleep() on a simulated clock, which jumps to\n"
+"      the earliest wake up time once every attached thread is in cutest_sleep().\n"
+"  " COLOR_GREEN("--test_budget_tolerance=") COLOR_YELLO("[PERCENT]") "\n"
+"      Allow time budgets to be exceeded by the given percent. By default it is\n"
+"      " TEST_STRINGIFY(BUDGET_DEFAULT_TOLERANCE) ".\n"
+"  " COLOR_GREEN("--test_budget_retry=") COLOR_YELLO("[COUNT]") "\n"
+"      Repeat code over its time budget up to the given times to confirm before\n"
+"      failure. By default it is " TEST_STRINGIFY(BUDGET_DEFAULT_RETRY) ".\n"
+"\n"
+"Benchmark:\n"
+"  " COLOR_GREEN("--test_bench_min_time=") COLOR_YELLO("[MS]") "\n"
+"      Minimum time of one benchmark measurement in milliseconds. By default\n"
+"      " TEST_STRINGIFY(BENCH_DEFAULT_MIN_TIME) " ms is used.\n"
+"  " COLOR_GREEN("--test_bench_threads=") COLOR_YELLO("[NUMBER]") "\n"
+"      Maximum number of threads used by multi-threaded benchmarks. By default\n"
+"      the number of online processors is used.\n"
+"  " COLOR_GREEN("--test_bench_hgrm=") COLOR_YELLO("[DIR]") "\n"
+"      Write latency histogram of each benchmark and load test into\n"
+"      `DIR/fixture.test.hgrm`, in HdrHistogram percentile distribution format.\n"
+"  " COLOR_GREEN("--test_bench_warmup=") COLOR_YELLO("[MS]") "\n"
+"      Run each benchmark for the given milliseconds before measurement.\n"
+"  " COLOR_GREEN("--test_bench_cpu=") COLOR_YELLO("[NUMBER]") "\n"
+"      Pin single-threaded benchmarks and load tests to the given CPU.\n"
+"\n"
+"Test Output:\n"
+"  " COLOR_GREEN("--test_print_time=") COLOR_YELLO("(") COLOR_GREEN("0") COLOR_YELLO("|") COLOR_GREEN("1") COLOR_YELLO("|") COLOR_GREEN("2") COLOR_YELLO(")") "\n"
+"      Don't print the elapsed time of each test (0), print it (1), or also print\n"
+"      nanoseconds of setup, body and teardown (2).\n"
+"  " COLOR_GREEN("--test_print_usage") "\n"
+"      Print resource usage of each test: growth of maximum resident set size,\n"
+"      page faults, context switches and block I/O operations, and I/O volume\n"
+"      and system calls where supported.\n"
+"  " COLOR_GREEN("--test_check_leaks=") COLOR_YELLO("(") COLOR_GREEN("0") COLOR_YELLO("|") COLOR_GREEN("1") COLOR_YELLO("|") COLOR_GREEN("2") COLOR_YELLO(")") "\n"
+"      Don't check (0), warn (1), or fail the test (2) if file descriptors or\n"
+"      threads opened by a test are still open after its teardown (Linux only).\n"
+"  " COLOR_GREEN("--test_max_io_bytes=") COLOR_YELLO("[BYTES]") "\n"
+"      Fail tests that read and write more than the given bytes through I/O\n"
+"      system calls. Not supported on all platforms.\n"
+"  " COLOR_GREEN("--test_alloc_leaks=") COLOR_YELLO("(") COLOR_GREEN("0") COLOR_YELLO("|") COLOR_GREEN("1") COLOR_YELLO("|") COLOR_GREEN("2") COLOR_YELLO(")") "\n"
+"      Don't check (0), only warn (1), or fail the test (2) if a passing test does\n"
+"      not free all memory it allocates. By default it is " TEST_STRINGIFY(ALLOC_DEFAULT_LEAKS) ". Requires CUTEST_ALLOC_TRACKER.\n"
+"  " COLOR_GREEN("--test_report_slowest=") COLOR_YELLO("[NUMBER]") "\n"
+"      Print the given number of slowest tests and fixtures at the end, at most\n"
+"      " TEST_STRINGIFY(CUTEST_REPORT_SLOWEST_MAX) ". With --test_repeat, the mean time across iterations is used.\n"
+"  " COLOR_GREEN("--test_report_variance=") COLOR_YELLO("[NUMBER]") "\n"
+"      With --test_repeat, print the given number of tests whose elapsed time\n"
+"      varies most across iterations, at most " TEST_STRINGIFY(CUTEST_REPORT_SLOWEST_MAX) ".\n"
+"  " COLOR_GREEN("--test_report_waiting=") COLOR_YELLO("[PERCENT]") "\n"
+"      Flag tests that take at least " TEST_STRINGIFY(REPORT_WAITING_MIN_MS) " ms but are on CPU for less than the\n"
+"      given percent of their wall time, such as 50. Disabled by default.\n"
+"  " COLOR_GREEN("--test_profile=") COLOR_YELLO("[FILE]") "\n"
+"      Sample call stacks of tests with SIGPROF and write them into FILE as folded\n"
+"      stacks for flamegraph.pl. Link with -rdynamic to see names of functions.\n"
+"  " COLOR_GREEN("--test_profile_hz=") COLOR_YELLO("[NUMBER]") "\n"
+"      Sampling frequency of --test_profile. By default it is " TEST_STRINGIFY(PROFILE_DEFAULT_HZ) ".\n"
+"  " COLOR_GREEN("--test_trace=") COLOR_YELLO("[FILE]") "\n"
+"      Write a Chrome trace event JSON file, which can be loaded by Perfetto or\n"
+"      chrome://tracing, covering tests, their stages, hooks and benchmark workers.\n"
+"\n"
+"Assertion Behavior:\n"
+"  " COLOR_GREEN("--test_break_on_failure") "\n"
+"      Turn assertion failures into debugger break-points.\n"
+;
+
+/**
+ * @brief Check if `str` match `pat`
+ * @return bool
+ */
+static int _cutest_pattern_match(const char* pat, unsigned long pat_sz,
+    const char* str, unsigned long str_sz)
+{
+    const char* name = str;
+    const char* const name_begin = name;
+    const char* const name_end = name + str_sz;
+
+    const char* pattern = pat;
+    const char* pattern_end = pat + pat_sz;
+    const char* pattern_next = pattern;
+    const char* name_next = name;
+
+    while (pattern < pattern_end || name < name_end)
+    {
+        if (pattern < pattern_end)
+        {
+            switch (*pattern)
+            {
+            default:  // Match an ordinary character.
+                if (name < name_end && *name == *pattern)
+                {
+                    ++pattern;
+                    ++name;
+                    continue;
+                }
+                break;
+            case '?':  // Match any single character.
+                if (name < name_end)
+                {
+                    ++pattern;
+                    ++name;
+                    continue;
+                }
+                break;
+            case '*':
+                // Match zero or more characters. Start by skipping over the wildcard
+                // and matching zero characters from name. If that fails, restart and
+                // match one more character than the last attempt.
+                pattern_next = pattern;
+                name_next = name + 1;
+                ++pattern;
+                continue;
+            }
+        }
+        // Failed to match a character. Restart if possible.
+        if (name_begin < name_next && name_next <= name_end)
+        {
+            pattern = pattern_next;
+            name = name_next;
+            continue;
+        }
+        return 0;
+    }
+    return 1;
+}
+
+/**
+ * @return true if this test will run, false if not.
+ */
+static int _cutest_check_pattern(const char* str, unsigned long str_sz)
+{
+    test_str_t k, v = g_test_ctx.filter.pattern;
+
+    /* If no pattern, run this test. */
+    if (v.ptr == NULL)
+    {
+        return 1;
+    }
+
+    unsigned long cnt_positive_patterns = 0;
+    int flag_match_positive_pattern = 0;
+
+    /* Split patterns by `:` */
+    while (_cutest_str_split(&v, &k, &v, ":", 0) == 0)
+    {
+        /* If it is a positive pattern. */
+        if (k.ptr[0] != '-')
+        {
+            cnt_positive_patterns++;
+
+            /* Record if it match any of positive pattern */
+            if (_cutest_pattern_match(k.ptr, k.len, str, str_sz))
+            {
+                flag_match_positive_pattern = 1;
+            }
+        }
+        else if (_cutest_pattern_match(k.ptr + 1, k.len - 1, str, str_sz))
+        {/* If match negative pattern, don't run. */
+            return 0;
+        }
+    }
+    if (v.ptr[0] != '-')
+    {
+        cnt_positive_patterns++;
+        if (_cutest_pattern_match(v.ptr, v.len, str, str_sz))
+        {
+            flag_match_positive_pattern = 1;
+        }
+    }
+    else if (_cutest_pattern_match(v.ptr + 1, v.len - 1, str, str_sz))
+    {
+        return 0;
+    }
+
+    return cnt_positive_patterns ? flag_match_positive_pattern : 1;
+}
+
+/**
+ * @return bool
+ */
+static int _cutest_check_disable(const char* name)
+{
+    return !g_test_ctx.mask.also_run_disabled_tests &&
+        (cutest_porting_strncmp("DISABLED_", name, 9) == 0);
+}
+
+static int _cutest_print_encoded(const char* str)
+{
+    int ret = 0;
+    cutest_porting_color_t color = CUTEST_COLOR_DEFAULT;
+
+    for (;;)
+    {
+        const char* p = cutest_porting_strchr(str, '@');
+        if (p == NULL)
+        {
+            ret += cutest_porting_cfprintf(g_test_ctx.out, color, "%s", str);
+            return ret;
+        }
+
+        ret += cutest_porting_cfprintf(g_test_ctx.out, color, "%.*s",
+            (int)(p - str), str);
+
+        const char ch = p[1];
+        str = p + 2;
+
+        switch (ch)
+        {
+        case '@':
+            ret += cutest_porting_cfprintf(g_test_ctx.out, color, "@");
+            break;
+        case 'D':
+            color = 0;
+            break;
+        case 'R':
+            color = CUTEST_COLOR_RED;
+            break;
+        case 'G':
+            color = CUTEST_COLOR_GREEN;
+            break;
+        case 'Y':
+            color = CUTEST_COLOR_YELLOW;
+            break;
+        default:
+            --str;
+            break;
+        }
+    }
+}
+
+static FILE* _cutest_fopen(const char* path, const char* mode)
+{
+#if defined(_MSC_VER)
+    FILE* file = NULL;
+    return fopen_s(&file, path, mode) == 0 ? file : NULL;
+#else
+    return fopen(path, mode);
+#endif
+}
+
+static void _cutest_warning(const char* fmt, ...)
+{
+    va_list ap;
+    va_start(ap, fmt);
+    cutest_porting_cfprintf(g_test_ctx.out, CUTEST_COLOR_YELLOW, "[ WARNING  ]");
+    cutest_porting_fprintf(g_test_ctx.out, " ");
+    cutest_porting_vfprintf(g_test_ctx.out, fmt, ap);
+    cutest_porting_fprintf(g_test_ctx.out, "\n");
+    va_end(ap);
+}
+
+/**
+ * @brief Write \p str into trace file as JSON string content.
+ */
+static void _cutest_trace_write_str(const char* str)
+{
+    for (; *str != '\0'; str++)
+    {
+        unsigned char c = (unsigned char)*str;
+        if (c == '"' || c == '\\')
+        {
+            cutest_porting_fprintf(g_test_ctx.trace.file, "\\%c", c);
+        }
+        else if (c < 0x20)
+        {
+            cutest_porting_fprintf(g_test_ctx.trace.file, "\\u%04x", (unsigned)c);
+        }
+        else
+        {
+            fputc(c, g_test_ctx.trace.file);
+        }
+    }
+}
+
+/**
+ * @brief Convert \p ts into microseconds since trace start.
+ */
+static double _cutest_trace_us(const cutest_porting_timespec_t* ts)
+{
+    cutest_porting_timespec_t tv_diff;
+    cutest_timestamp_dif(&g_test_ctx.trace.tv_start, ts, &tv_diff);
+    return cutest_timestamp_ns(&tv_diff) / 1000.0;
+}
+
+static void _cutest_trace_name_thread(unsigned long tid)
+{
+    cutest_porting_fprintf(g_test_ctx.trace.file,
+        ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%lu,"
+        "\"args\":{\"name\":\"", tid);
+    if (tid == 0)
+    {
+        cutest_porting_fprintf(g_test_ctx.trace.file, "main");
+    }
+    else
+    {
+        cutest_porting_fprintf(g_test_ctx.trace.file, "worker %lu", tid);
+    }
+    cutest_porting_fprintf(g_test_ctx.trace.file, "\"}}");
+}
+
+/**
+ * @brief Write a complete event into trace file.
+ * @param[in] name      Event name.
+ * @param[in] cat       Event category.
+ * @param[in] tid       Lane. 0 is the main thread, workers start from 1.
+ * @param[in] tv_beg    Begin time.
+ * @param[in] tv_end    End time.
+ */
+static void _cutest_trace_span(const char* name, const char* cat,
+    unsigned long tid, const cutest_porting_timespec_t* tv_beg, const cutest_porting_timespec_t* tv_end)
+{
+    if (g_test_ctx.trace.file == NULL)
+    {
+        return;
+    }
+
+    for (; g_test_ctx.trace.lanes <= tid; g_test_ctx.trace.lanes++)
+    {
+        _cutest_trace_name_thread(g_test_ctx.trace.lanes);
+    }
+
+    double ts = _cutest_trace_us(tv_beg);
+    double dur = _cutest_trace_us(tv_end) - ts;
+
+    cutest_porting_fprintf(g_test_ctx.trace.file, ",\n{\"name\":\"");
+    _cutest_trace_write_str(name);
+    cutest_porting_fprintf(g_test_ctx.trace.file,
+        "\",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%lu}",
+        cat, ts, dur > 0 ? dur : 0, tid);
+}
+
+/**
+ * @brief Write a complete event on main thread that ends now.
+ */
+static void _cutest_trace_end(const char* name, const char* cat, const cutest_porting_timespec_t* tv_beg)
+{
+    cutest_porting_timespec_t tv_end;
+    if (g_test_ctx.trace.file == NULL)
+    {
+        return;
+    }
+
+    cutest_porting_clock_gettime(&tv_end);
+    _cutest_trace_span(name, cat, 0, tv_beg, &tv_end);
+}
+
+static void _cutest_trace_open(void)
+{
+    if (g_test_ctx.trace.path == NULL)
+    {
+        return;
+    }
+
+    if ((g_test_ctx.trace.file = _cutest_fopen(g_test_ctx.trace.path, "w")) == NULL)
+    {
+        _cutest_warning("cannot open trace file `%s`.", g_test_ctx.trace.path);
+        return;
+    }
+
+    cutest_porting_clock_gettime(&g_test_ctx.trace.tv_start);
+    g_test_ctx.trace.lanes = 0;
+
+    /* The first event has no leading comma. */
+    cutest_porting_fprintf(g_test_ctx.trace.file,
+        "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n"
+        "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"cutest\"}}");
+}
+
+static void _cutest_trace_close(void)
+{
+    if (g_test_ctx.trace.file == NULL)
+    {
+        return;
+    }
+
+    cutest_porting_fprintf(g_test_ctx.trace.file, "\n]}\n");
+    fclose(g_test_ctx.trace.file);
+    g_test_ctx.trace.file = NULL;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Profiler
+///////////////////////////////////////////////////////////////////////////////
+
+#if defined(__linux__) && defined(__GLIBC__)
+
+#include <dlfcn.h>
+#include <errno.h>
+#include <execinfo.h>
+#include <signal.h>
+#include <sys/time.h>
+
+/**
+ * @brief Frames of signal handler and signal trampoline.
+ */
+#define PROFILE_SKIP_FRAMES     2
+
+typedef struct test_profile_stack
+{
+    const cutest_case_t*        test_case;      /**< Sampled case, NULL if not in a case. */
+    unsigned long               count;          /**< The number of samples, 0 if empty. */
+    int                         depth;          /**< The number of frames. */
+    void*                       frames[CUTEST_PROFILE_MAX_DEPTH];   /**< Innermost first. */
+} test_profile_stack_t;
+
+typedef struct test_profile_ctx
+{
+    test_profile_stack_t        stacks[CUTEST_PROFILE_MAX_STACKS];  /**< Hash table of stacks. */
+    unsigned long               samples;        /**< The number of recorded samples. */
+    unsigned long               dropped;        /**< The number of samples dropped as the table is full. */
+    volatile unsigned long      busy_dropped;   /**< The number of samples dropped as the handler is busy. */
+    volatile int                busy;           /**< Signal handler is running. */
+    struct sigaction            old_action;     /**< SIGPROF action before start. */
+} test_profile_ctx_t;
+
+/**
+ * @brief Samples of `--test_profile`.
+ * Keep it out of #g_test_ctx as it is large and written by signal handler.
+ */
+static test_profile_ctx_t s_profile;
+
+static int _cutest_profile_same_stack(const test_profile_stack_t* stack,
+    const cutest_case_t* test_case, void** frames, int depth)
+{
+    int i;
+    if (stack->test_case != test_case || stack->depth != depth)
+    {
+        return 0;
+    }
+    for (i = 0; i < depth; i++)
+    {
+        if (stack->frames[i] != frames[i])
+        {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static void _cutest_profile_record(const cutest_case_t* test_case, void** frames, int depth)
+{
+    unsigned long hash = (unsigned long)(uintptr_t)test_case;
+    unsigned long i;
+    int j;
+
+    for (j = 0; j < depth; j++)
+    {
+        hash = hash * 31 + (unsigned long)(uintptr_t)frames[j];
+    }
+
+    for (i = 0; i < CUTEST_PROFILE_MAX_STACKS; i++)
+    {
+        test_profile_stack_t* stack = &s_profile.stacks[(hash + i) % CUTEST_PROFILE_MAX_STACKS];
+        if (stack->count == 0)
+        {
+            stack->test_case = test_case;
+            stack->depth = depth;
+            cutest_porting_memcpy(stack->frames, frames, sizeof(void*) * depth);
+            stack->count = 1;
+            s_profile.samples++;
+            return;
+        }
+        if (_cutest_profile_same_stack(stack, test_case, frames, depth))
+        {
+            stack->count++;
+            s_profile.samples++;
+            return;
+        }
+    }
+
+    s_profile.dropped++;
+}
+
+static void _cutest_profile_on_signal(int sig)
+{
+    void* frames[CUTEST_PROFILE_MAX_DEPTH + PROFILE_SKIP_FRAMES];
+    int saved_errno = errno;
+    (void)sig;
+
+    /* SIGPROF can hit several threads at the same time. */
+    if (__sync_lock_test_and_set(&s_profile.busy, 1))
+    {
+        __sync_fetch_and_add(&s_profile.busy_dropped, 1);
+        errno = saved_errno;
+        return;
+    }
+
+    /*
+     * backtrace() is not async-signal-safe in general, it is fine here only
+     * because _cutest_profile_start() has called it once to load the unwinder.
+     */
+    int depth = backtrace(frames, TEST_ARRAY_SIZE(frames));
+    if (depth > PROFILE_SKIP_FRAMES)
+    {
+        _cutest_profile_record(g_test_ctx.runtime.cur_node,
+            frames + PROFILE_SKIP_FRAMES, depth - PROFILE_SKIP_FRAMES);
+    }
+
+    __sync_lock_release(&s_profile.busy);
+    errno = saved_errno;
+}
+
+/**
+ * @brief Write symbol name of \p addr.
+ */
+static void _cutest_write_symbol(FILE* file, void* addr)
+{
+    Dl_info info;
+    if (dladdr(addr, &info) == 0 || info.dli_fname == NULL)
+    {
+        cutest_porting_fprintf(file, "0x%lx", (unsigned long)(uintptr_t)addr);
+        return;
+    }
+    if (info.dli_sname != NULL)
+    {
+        cutest_porting_fprintf(file, "%s", info.dli_sname);
+        return;
+    }
+
+    /* Static functions have no dynamic symbol, use module offset instead. */
+    const char* name = info.dli_fname;
+    const char* pos;
+    for (pos = info.dli_fname; *pos != '\0'; pos++)
+    {
+        if (*pos == '/')
+        {
+            name = pos + 1;
+        }
+    }
+    cutest_porting_fprintf(file, "%s+0x%lx", name,
+        (unsigned long)((uintptr_t)addr - (uintptr_t)info.dli_fbase));
+}
+
+static int _cutest_profile_write(const char* path)
+{
+    FILE* file = _cutest_fopen(path, "w");
+    unsigned long i;
+    int j;
+
+    if (file == NULL)
+    {
+        return -1;
+    }
+
+    for (i = 0; i < CUTEST_PROFILE_MAX_STACKS; i++)
+    {
+        test_profile_stack_t* stack = &s_profile.stacks[i];
+        if (stack->count == 0)
+        {
+            continue;
+        }
+
+        if (stack->test_case == NULL)
+        {
+            cutest_porting_fprintf(file, "[cutest]");
+        }
+        else
+        {
+            cutest_porting_fprintf(file, "%s.%s",
+                stack->test_case->info.fixture_name, stack->test_case->info.case_name);
+        }
+        for (j = stack->depth - 1; j >= 0; j--)
+        {
+            cutest_porting_fprintf(file, ";");
+            _cutest_write_symbol(file, stack->frames[j]);
+        }
+        cutest_porting_fprintf(file, " %lu\n", stack->count);
+    }
+
+    fclose(file);
+    return 0;
+}
+
+static void _cutest_profile_start(void)
+{
+    struct sigaction action;
+    struct itimerval timer;
+    void* frames[1];
+
+    if (g_test_ctx.profile.path == NULL)
+    {
+        return;
+    }
+
+    /* backtrace() loads unwinder on first call, which is not signal safe. */
+    backtrace(frames, 1);
+    cutest_porting_memset(&s_profile, 0, sizeof(s_profile));
+
+    cutest_porting_memset(&action, 0, sizeof(action));
+    action.sa_handler = _cutest_profile_on_signal;
+    action.sa_flags = SA_RESTART;
+    sigemptyset(&action.sa_mask);
+    if (sigaction(SIGPROF, &action, &s_profile.old_action) != 0)
+    {
+        _cutest_warning("cannot install SIGPROF handler, profiling is disabled.");
+        g_test_ctx.profile.path = NULL;
+        return;
+    }
+
+    unsigned long interval = 1000000 / g_test_ctx.profile.hz;
+    timer.it_interval.tv_sec = interval / 1000000;
+    timer.it_interval.tv_usec = interval % 1000000;
+    timer.it_value = timer.it_interval;
+    setitimer(ITIMER_PROF, &timer, NULL);
+}
+
+static void _cutest_profile_stop(void)
+{
+    struct itimerval timer;
+    if (g_test_ctx.profile.path == NULL)
+    {
+        return;
+    }
+
+    cutest_porting_memset(&timer, 0, sizeof(timer));
+    setitimer(ITIMER_PROF, &timer, NULL);
+    sigaction(SIGPROF, &s_profile.old_action, NULL);
+
+    if (_cutest_profile_write(g_test_ctx.profile.path) != 0)
+    {
+        _cutest_warning("cannot open profile file `%s`.", g_test_ctx.profile.path);
+        return;
+    }
+
+    cutest_porting_cfprintf(g_test_ctx.out, CUTEST_COLOR_DEFAULT, "[ PROFILE  ]");
+    cutest_porting_cfprintf(g_test_ctx.out, CUTEST_COLOR_DEFAULT,
+        " %lu samples (%lu dropped, %lu busy) written to `%s`.\n",
+        s_profile.samples, s_profile.dropped, s_profile.busy_dropped, g_test_ctx.profile.path);
+}
+
+#else
+
+static void _cutest_profile_start(void)
+{
+    if (g_test_ctx.profile.path != NULL)
+    {
+        _cutest_warning("--test_profile is not supported on this platform.");
+    }
+}
+
+static void _cutest_profile_stop(void)
+{
+}
+
+#endif
+
+/**
+ * @brief Finish a stage that started at \p tv_beg.
+ * @return  Nanoseconds of the stage.
+ */
+static double _cutest_stage_finish(const char* name, const cutest_porting_timespec_t* tv_beg)
+{
+    cutest_porting_timespec_t tv_end, tv_diff;
+    cutest_porting_clock_gettime(&tv_end);
+    _cutest_trace_span(name, "stage", 0, tv_beg, &tv_end);
+
+    cutest_timestamp_dif(tv_beg, &tv_end, &tv_diff);
+    return cutest_timestamp_ns(&tv_diff);
+}
+
+static void _cutest_hook_before_fixture_setup(cutest_case_t* test_case)
+{
+    if (g_test_ctx.hook == NULL || g_test_ctx.hook->before_setup == NULL)
+    {
+        return;
+    }
+    cutest_porting_timespec_t tv_beg;
+    cutest_porting_clock_gettime(&tv_beg);
+    g_test_ctx.hook->before_setup(test_case->info.fixture_name);
+    _cutest_trace_end("before_setup", "hook", &tv_beg);
+}
+
+static void _cutest_hook_after_fixture_setup(cutest_case_t* test_case, int ret)
+{
+    if (g_test_ctx.hook == NULL || g_test_ctx.hook->after_setup == NULL)
+    {
+        return;
+    }
+    cutest_porting_timespec_t tv_beg;
+    cutest_porting_clock_gettime(&tv_beg);
+    g_test_ctx.hook->after_setup(test_case->info.fixture_name, ret);
+    _cutest_trace_end("after_setup", "hook", &tv_beg);
+}
+
+static void _cutest_run_case_set_jmp(cutest_porting_jmpbuf_t* buf,
+                                     cutest_porting_longjmp_fn fn_longjmp)
+{
+    g_test_ctx.jmp.addr = buf;
+    g_test_ctx.jmp.func = fn_longjmp;
+}
+
+static void _cutest_fixture_run_setup_jmp(cutest_porting_jmpbuf_t* buf,
+    cutest_porting_longjmp_fn fn_longjmp, int val, void* data)
+{
+    fixture_run_helper_t* helper = data;
+    test_case_info_t* info = helper->info;
+
+    _cutest_run_case_set_jmp(buf, fn_longjmp);
+
+    if (val != 0)
+    {
+        SET_MASK(info->test_case->data.mask, val);
+        goto after_setup;
+    }
+
+    _cutest_hook_before_fixture_setup(info->test_case);
+    info->test_case->stage.setup();
+
+after_setup:
+    _cutest_hook_after_fixture_setup(info->test_case, val);
+    helper->ret = val;
+}
+
+/**
+ * @brief Run setup stage.
+ * @param[in] test_case The test case to run.
+ * @return              0 if success, otherwise failure.
+ */
+static int _cutest_fixture_run_setup(test_case_info_t* info)
+{
+    if (info->test_case->stage.setup == NULL)
+    {
+        return 0;
+    }
+
+    cutest_porting_timespec_t tv_beg;
+    cutest_porting_clock_gettime(&tv_beg);
+
+    fixture_run_helper_t helper = { info, 0 };
+    cutest_porting_setjmp(_cutest_fixture_run_setup_jmp, &helper);
+
+    info->ns_setup = _cutest_stage_finish("setup", &tv_beg);
+    return helper.ret;
+}
+
+static void _cutest_hook_before_test(test_case_info_t* info)
+{
+    cutest_case_t* test_case = info->test_case;
+    if (g_test_ctx.hook == NULL || g_test_ctx.hook->before_test == NULL)
+    {
+        return;
+    }
+
+    unsigned long fixture_sz = cutest_porting_strlen(test_case->info.fixture_name);
+    cutest_porting_timespec_t tv_beg;
+    cutest_porting_clock_gettime(&tv_beg);
+    g_test_ctx.hook->before_test(test_case->info.fixture_name, info->fmt_name + fixture_sz);
+    _cutest_trace_end("before_test", "hook", &tv_beg);
+}
+
+static void _cutest_hook_after_test(test_case_info_t* info, int ret)
+{
+    cutest_case_t* test_case = info->test_case;
+    if (g_test_ctx.hook == NULL || g_test_ctx.hook->after_test == NULL)
+    {
+        return;
+    }
+
+    unsigned long fixture_sz = cutest_porting_strlen(test_case->info.fixture_name);
+    cutest_porting_timespec_t tv_beg;
+    cutest_porting_clock_gettime(&tv_beg);
+    g_test_ctx.hook->after_test(test_case->info.fixture_name, info->fmt_name + fixture_sz, ret);
+    _cutest_trace_end("after_test", "hook", &tv_beg);
+}
+
+static void _cutest_hook_before_teardown(cutest_case_t* test_case)
+{
+    if (g_test_ctx.hook == NULL || g_test_ctx.hook->before_teardown == NULL)
+    {
+        return;
+    }
+
+    cutest_porting_timespec_t tv_beg;
+    cutest_porting_clock_gettime(&tv_beg);
+    g_test_ctx.hook->before_teardown(test_case->info.fixture_name);
+    _cutest_trace_end("before_teardown", "hook", &tv_beg);
+}
+
+static void _cutest_hook_after_teardown(cutest_case_t* test_case, int ret)
+{
+    if (g_test_ctx.hook == NULL || g_test_ctx.hook->after_teardown == NULL)
+    {
+        return;
+    }
+    cutest_porting_timespec_t tv_beg;
+    cutest_porting_clock_gettime(&tv_beg);
+    g_test_ctx.hook->after_teardown(test_case->info.fixture_name, ret);
+    _cutest_trace_end("after_teardown", "hook", &tv_beg);
+}
+
+static void _cutest_hook_before_all_test(int argc, char* argv[])
+{
+    if (g_test_ctx.hook == NULL || g_test_ctx.hook->before_all_test == NULL)
+    {
+        return;
+    }
+    cutest_porting_timespec_t tv_beg;
+    cutest_porting_clock_gettime(&tv_beg);
+    g_test_ctx.hook->before_all_test(argc, argv);
+    _cutest_trace_end("before_all_test", "hook", &tv_beg);
+}
+
+static void _cutest_hook_after_all_test(void)
+{
+    if (g_test_ctx.hook == NULL || g_test_ctx.hook->after_all_test == NULL)
+    {
+        return;
+    }
+    cutest_porting_timespec_t tv_beg;
+    cutest_porting_clock_gettime(&tv_beg);
+    g_test_ctx.hook->after_all_test();
+    _cutest_trace_end("after_all_test", "hook", &tv_beg);
+}
+
+static void _cutest_fixture_run_teardown_jmp(cutest_porting_jmpbuf_t* buf,
+    cutest_porting_longjmp_fn fn_longjmp, int val, void* data)
+{
+    test_case_info_t* info = data;
+
+    _cutest_run_case_set_jmp(buf, fn_longjmp);
+
+    if (val != 0)
+    {
+        SET_MASK(info->test_case->data.mask, val);
+        goto after_teardown;
+    }
+
+    _cutest_hook_before_teardown(info->test_case);
+    info->test_case->stage.teardown();
+
+after_teardown:
+    _cutest_hook_after_teardown(info->test_case, val);
+}
+
+static void _cutest_fixture_run_teardown(test_case_info_t* info)
+{
+    if (info->test_case->stage.teardown == NULL)
+    {
+        return;
+    }
+
+    cutest_porting_timespec_t tv_beg;
+    cutest_porting_clock_gettime(&tv_beg);
+
+    cutest_porting_setjmp(_cutest_fixture_run_teardown_jmp, info);
+
+    info->ns_teardown = _cutest_stage_finish("teardown", &tv_beg);
+}
+
+/**
+ * @brief Update elapsed time statistics of \p test_case by Welford's method,
+ *   so no sample need to be stored.
+ */
+static void _cutest_stat_update(cutest_case_t* test_case, double elapsed)
+{
+    test_case->data.stat.count++;
+    if (test_case->data.stat.count == 1 || elapsed < test_case->data.stat.min)
+    {
+        test_case->data.stat.min = elapsed;
+    }
+    if (test_case->data.stat.count == 1 || elapsed > test_case->data.stat.max)
+    {
+        test_case->data.stat.max = elapsed;
+    }
+
+    double delta = elapsed - test_case->data.stat.mean;
+    test_case->data.stat.mean += delta / (double)test_case->data.stat.count;
+    test_case->data.stat.m2 += delta * (elapsed - test_case->data.stat.mean);
+}
+
+static double _cutest_stat_stddev(const cutest_case_t* test_case)
+{
+    if (test_case->data.stat.count < 2)
+    {
+        return 0;
+    }
+    return _cutest_sqrt(test_case->data.stat.m2 / (double)(test_case->data.stat.count - 1));
+}
+
+/**
+ * @brief Get resource usage since current case started.
+ * @return  0 if success, -1 if not available.
+ */
+static int _cutest_usage_since_start(cutest_usage_t* usage)
+{
+    const cutest_usage_t* beg = &g_test_ctx.runtime.usage_beg;
+    if (!g_test_ctx.runtime.has_usage || cutest_rusage_get(usage) != 0)
+    {
+        return -1;
+    }
+
+    usage->maxrss = usage->maxrss - beg->maxrss;
+    usage->minflt = usage->minflt - beg->minflt;
+    usage->majflt = usage->majflt - beg->majflt;
+    usage->nvcsw = usage->nvcsw - beg->nvcsw;
+    usage->nivcsw = usage->nivcsw - beg->nivcsw;
+    usage->inblock = usage->inblock - beg->inblock;
+    usage->oublock = usage->oublock - beg->oublock;
+    return 0;
+}
+
+static unsigned long _cutest_io_sub(unsigned long a, unsigned long b)
+{
+    return a > b ? a - b : 0;
+}
+
+/**
+ * @brief Move the start of current case forward by the cost of one read of
+ *   the I/O counters.
+ */
+static void _cutest_io_skip_probe(void)
+{
+    cutest_io_t* beg = &g_test_ctx.runtime.io_beg;
+    const cutest_io_t* cost = &g_test_ctx.runtime.io_probe;
+    beg->rchar += cost->rchar;
+    beg->wchar += cost->wchar;
+    beg->syscr += cost->syscr;
+    beg->syscw += cost->syscw;
+    beg->read_bytes += cost->read_bytes;
+    beg->write_bytes += cost->write_bytes;
+}
+
+/**
+ * @brief Take the I/O counters at start of current case.
+ *
+ * Reading the counters may be I/O itself (e.g. /proc/self/io), and it is
+ * accounted after the snapshot is taken, so it would land in the window of
+ * the case. Read them twice to measure the cost of one read, and skip it so
+ * that an empty case reports no I/O.
+ *
+ * @return  0 if success, -1 if not available.
+ */
+static int _cutest_io_begin(void)
+{
+    cutest_io_t probe;
+    cutest_io_t* beg = &g_test_ctx.runtime.io_beg;
+    cutest_io_t* cost = &g_test_ctx.runtime.io_probe;
+    if (cutest_io_get(&probe) != 0 || cutest_io_get(beg) != 0)
+    {
+        return -1;
+    }
+
+    cost->rchar = beg->rchar - probe.rchar;
+    cost->wchar = beg->wchar - probe.wchar;
+    cost->syscr = beg->syscr - probe.syscr;
+    cost->syscw = beg->syscw - probe.syscw;
+    cost->read_bytes = beg->read_bytes - probe.read_bytes;
+    cost->write_bytes = beg->write_bytes - probe.write_bytes;
+    _cutest_io_skip_probe();
+    return 0;
+}
+
+/**
+ * @brief Get I/O counters since current case started.
+ * @return  0 if success, -1 if not available.
+ */
+static int _cutest_io_since_start(cutest_io_t* io)
+{
+    const cutest_io_t* beg = &g_test_ctx.runtime.io_beg;
+    if (!g_test_ctx.runtime.has_io || cutest_io_get(io) != 0)
+    {
+        return -1;
+    }
+
+    /* The start is an estimate, so never go below zero. */
+    io->rchar = _cutest_io_sub(io->rchar, beg->rchar);
+    io->wchar = _cutest_io_sub(io->wchar, beg->wchar);
+    io->syscr = _cutest_io_sub(io->syscr, beg->syscr);
+    io->syscw = _cutest_io_sub(io->syscw, beg->syscw);
+    io->read_bytes = _cutest_io_sub(io->read_bytes, beg->read_bytes);
+    io->write_bytes = _cutest_io_sub(io->write_bytes, beg->write_bytes);
+    return 0;
+}
+
+/**
+ * @brief Append \p str to \p buf.
+ * @return The position after appended string, or NULL if \p buf is full.
+ */
+static char* _cutest_path_append(char* buf, char* pos, const char* str)
+{
+    unsigned long len = cutest_porting_strlen(str);
+    if (pos == NULL || (unsigned long)(pos - buf) + len >= CUTEST_PATH_MAX)
+    {
+        return NULL;
+    }
+
+    cutest_porting_memcpy(pos, str, len);
+    pos[len] = '\0';
+    return pos + len;
+}
+
+typedef struct test_tmpdir
+{
+    volatile long               lock;           /**< Spin lock. */
+    unsigned long               seq;            /**< The number of directories tried. */
+    int                         created;        /**< Whether #test_tmpdir_t::path exists. */
+    char                        path[CUTEST_PATH_MAX]; /**< Directory of current test. */
+} test_tmpdir_t;
+
+static test_tmpdir_t s_tmpdir;
+
+/**
+ * @brief Create `root/cutest-PID-SEQ` as #test_tmpdir_t::path.
+ *
+ * A directory left by a crashed process with the same ID, or created by
+ * anyone else, is never reused: the next sequence number is tried instead.
+ *
+ * @return  0 if success, -1 if failure.
+ */
+static int _cutest_tmpdir_create(const char* root)
+{
+    int i, ret = -1;
+    char num[20];
+    for (i = 0; i < TMPDIR_MAX_TRIES; i++)
+    {
+        s_tmpdir.seq++;
+        char* pos = _cutest_path_append(s_tmpdir.path, s_tmpdir.path, root);
+        pos = _cutest_path_append(s_tmpdir.path, pos, "/cutest-");
+        pos = _cutest_path_append(s_tmpdir.path, pos, cutest_porting_ultoa(num, cutest_process_id()));
+        pos = _cutest_path_append(s_tmpdir.path, pos, "-");
+        pos = _cutest_path_append(s_tmpdir.path, pos, cutest_porting_ultoa(num, s_tmpdir.seq));
+        if (pos == NULL || (ret = cutest_dir_create(s_tmpdir.path)) != 1)
+        {
+            break;
+        }
+    }
+    return ret == 0 ? 0 : -1;
+}
+
+/**
+ * @brief Remove directory of current test if it was created.
+ */
+static void _cutest_tmpdir_remove(test_case_info_t* info)
+{
+    SPIN_LOCK(&s_tmpdir.lock);
+    if (s_tmpdir.created && cutest_dir_remove(s_tmpdir.path) != 0)
+    {
+        _cutest_warning("%s cannot remove `%s`.", info->fmt_name, s_tmpdir.path);
+    }
+    s_tmpdir.created = 0;
+    SPIN_UNLOCK(&s_tmpdir.lock);
+}
+
+typedef struct test_vtime
+{
+    volatile long               lock;           /**< Spin lock. */
+    cutest_cond_t               moved;          /**< Broadcast when #test_vtime_t::now moves. */
+    unsigned long long          now;            /**< Virtual nanoseconds. */
+    unsigned long               threads;        /**< Threads added by #cutest_time_attach(), main thread is not counted. */
+    unsigned long               sleepers;       /**< Threads in #cutest_sleep(). */
+    unsigned long long          wake[CUTEST_VTIME_MAX_SLEEPERS]; /**< Wake up time of sleepers, 0 if slot is free. */
+} test_vtime_t;
+
+static test_vtime_t s_vtime;
+
+static unsigned long long _cutest_real_now(void)
+{
+    cutest_porting_timespec_t tv;
+    cutest_porting_clock_gettime(&tv);
+    return (unsigned long long)tv.tv_sec * 1000000000 + (unsigned long long)tv.tv_nsec;
+}
+
+static void _cutest_real_sleep(unsigned long long ns)
+{
+    if (cutest_nanosleep(ns) == 0)
+    {
+        return;
+    }
+
+    unsigned long long end = _cutest_real_now() + ns;
+    while (_cutest_real_now() < end)
+    {
+        cutest_thread_yield();
+    }
+}
+
+/**
+ * @brief Move virtual clock to the earliest wake up time if every attached
+ *   thread is sleeping and none of them is due.
+ * @note Must be called with #test_vtime_t::lock held.
+ */
+static void _cutest_vtime_advance(void)
+{
+    size_t i;
+    unsigned long long earliest = 0;
+    if (s_vtime.sleepers < s_vtime.threads + 1)
+    {
+        return;
+    }
+
+    for (i = 0; i < CUTEST_VTIME_MAX_SLEEPERS; i++)
+    {
+        if (s_vtime.wake[i] != 0 && (earliest == 0 || s_vtime.wake[i] < earliest))
+        {
+            earliest = s_vtime.wake[i];
+        }
+    }
+    if (earliest > s_vtime.now)
+    {
+        s_vtime.now = earliest;
+        cutest_cond_broadcast(&s_vtime.moved);
+    }
+}
+
+static void _cutest_vtime_sleep(unsigned long long ns)
+{
+    size_t i;
+    SPIN_LOCK(&s_vtime.lock);
+    for (i = 0; i < CUTEST_VTIME_MAX_SLEEPERS && s_vtime.wake[i] != 0; i++)
+    {
+    }
+    if (i == CUTEST_VTIME_MAX_SLEEPERS)
+    {
+        SPIN_UNLOCK(&s_vtime.lock);
+        _cutest_warning("more than " TEST_STRINGIFY(CUTEST_VTIME_MAX_SLEEPERS)
+            " threads in cutest_sleep(), fall back to real time.");
+        _cutest_real_sleep(ns);
+        return;
+    }
+
+    s_vtime.wake[i] = s_vtime.now + ns;
+    s_vtime.sleepers++;
+    for (;;)
+    {
+        _cutest_vtime_advance();
+        if (s_vtime.now >= s_vtime.wake[i])
+        {
+            break;
+        }
+
+        /* Taken under the lock, so a move after it is never missed. */
+        unsigned long seq = cutest_cond_seq(&s_vtime.moved);
+        SPIN_UNLOCK(&s_vtime.lock);
+        cutest_cond_wait(&s_vtime.moved, seq);
+        SPIN_LOCK(&s_vtime.lock);
+    }
+    s_vtime.wake[i] = 0;
+    s_vtime.sleepers--;
+    SPIN_UNLOCK(&s_vtime.lock);
+}
+
+typedef struct test_timer_region
+{
+    const char*                 name;           /**< Region name. */
+    unsigned long               count;          /**< The number of finished calls. */
+    double                      total;          /**< Total nanoseconds of finished calls. */
+    int                         running;        /**< Whether the region is started. */
+    cutest_porting_timespec_t   tv_beg;         /**< Start time of current call. */
+} test_timer_region_t;
+
+typedef struct test_timer_table
+{
+    test_timer_region_t         regions[CUTEST_TIMER_MAX];
+    unsigned long               size;           /**< The number of regions. */
+} test_timer_table_t;
+
+/**
+ * @brief Timing regions of current case.
+ */
+static test_timer_table_t s_timer_table;
+
+static test_timer_region_t* _cutest_timer_find(const char* name)
+{
+    unsigned long i;
+    for (i = 0; i < s_timer_table.size; i++)
+    {
+        if (cutest_porting_strcmp(s_timer_table.regions[i].name, name) == 0)
+        {
+            return &s_timer_table.regions[i];
+        }
+    }
+    return NULL;
+}
+
+static void _cutest_show_timer(void)
+{
+    unsigned long i;
+    for (i = 0; i < s_timer_table.size; i++)
+    {
+        test_timer_region_t* region = &s_timer_table.regions[i];
+        if (region->count == 0)
+        {
+            continue;
+        }
+
+        cutest_porting_cfprintf(g_test_ctx.out, CUTEST_COLOR_DEFAULT, "[ TIMER    ]");
+        cutest_porting_cfprintf(g_test_ctx.out, CUTEST_COLOR_DEFAULT,
+            " %s: %lu calls, %.3f ms total, %.3f ms avg\n",
+            region->name, region->count, region->total / 1000000.0,
+            region->total / (double)region->count / 1000000.0);
+    }
+}
+
+#if defined(CUTEST_ALLOC_TRACKER)
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+static void _cutest_run_case(cutest_case_t* test_case);
+
+/**
+ * @brief Exit code of sweep child whose test leaks.
+ */
+#define SWEEP_EXIT_LEAKED   1
+
+/**
+ * @brief Finish the test in sweep child.
+ */
+static void _cutest_alloc_sweep_exit(test_case_info_t* info)
+{
+    /* Failed tests may skip cleanup, only a passing test can leak. */
+    int leaked = info->alloc.leaks != 0
+        && !HAS_MASK(info->test_case->data.mask, MASK_FAILURE);
+    _exit(leaked ? SWEEP_EXIT_LEAKED : 0);
+}
+
+/**
+ * @brief Run test in a child process, and fail its \p n-th allocation.
+ * @return  The status of waitpid(), or -1 if failed to fork.
+ */
+static int _cutest_alloc_sweep_fork(cutest_case_t* test_case, unsigned long n)
+{
+    fflush(g_test_ctx.out);
+
+    pid_t pid = fork();
+    if (pid < 0)
+    {
+        return -1;
+    }
+    if (pid == 0)
+    {
+        FILE* out = _cutest_fopen("/dev/null", "w");
+        if (out == NULL)
+        {
+            _exit(0);
+        }
+        g_test_ctx.out = out;
+        g_test_ctx.hook = NULL;
+        g_test_ctx.hook_ex = NULL;
+        g_test_ctx.trace.file = NULL;
+        g_test_ctx.mask.break_on_failure = 0;
+        g_test_ctx.mask.sweep_child = 1;
+
+        cutest_alloc_fail_at(n);
+        _cutest_run_case(test_case);
+        _exit(0);
+    }
+
+    int status = 0;
+    while (waitpid(pid, &status, 0) < 0)
+    {
+        if (errno != EINTR)
+        {
+            return -1;
+        }
+    }
+    return status;
+}
+
+/**
+ * @brief Run `--test_fail_alloc_sweep` for a passing test.
+ */
+static void _cutest_alloc_sweep(test_case_info_t* info)
+{
+    unsigned long n, points = info->alloc.allocs;
+
+    info->has_sweep = 1;
+    info->sweep_crashed = 0;
+    info->sweep_leaked = 0;
+
+    for (n = 1; n <= points; n++)
+    {
+        int status = _cutest_alloc_sweep_fork(info->test_case, n);
+        if (status == -1)
+        {
+            _cutest_warning("cannot fork, --test_fail_alloc_sweep of %s stopped.", info->fmt_name);
+            break;
+        }
+
+        if (WIFSIGNALED(status))
+        {
+            info->sweep_crashed++;
+            cutest_porting_fprintf(g_test_ctx.out,
+                "%s:failure:\n"
+                "            expected: survive failure of allocation #%lu of %lu\n"
+                "              actual: crashed by signal %d\n",
+                info->fmt_name, n, points, WTERMSIG(status));
+        }
+        else if (WIFEXITED(status) && WEXITSTATUS(status) == SWEEP_EXIT_LEAKED)
+        {
+            info->sweep_leaked++;
+            cutest_porting_fprintf(g_test_ctx.out,
+                "%s:failure:\n"
+                "            expected: survive failure of allocation #%lu of %lu\n"
+                "              actual: memory leak\n",
+                info->fmt_name, n, points);
+        }
+    }
+
+    if (info->sweep_crashed != 0 || info->sweep_leaked != 0)
+    {
+        SET_MASK(info->test_case->data.mask, MASK_FAILURE);
+    }
+}
+
+#endif
+
+/**
+ * @brief Maximum number of file descriptors or threads checked by
+ *   `--test_check_leaks`.
+ */
+#define LEAK_CHECK_MAX_ENTRIES      1024
+
+typedef struct test_proc_list
+{
+    long                        size;           /**< The number of entries, -1 if not available. */
+    unsigned long               entries[LEAK_CHECK_MAX_ENTRIES];    /**< The lowest entries, sorted. */
+} test_proc_list_t;
+
+typedef struct test_proc_snapshot
+{
+    test_proc_list_t            fds;            /**< Open file descriptors. */
+    test_proc_list_t            tasks;          /**< Threads. */
+} test_proc_snapshot_t;
+
+/**
+ * @brief File descriptors and threads before setup of current test.
+ * Keep it out of #test_case_info_t as it is large.
+ */
+static test_proc_snapshot_t s_proc_snapshot;
+
+static void _cutest_proc_snapshot(test_proc_snapshot_t* snapshot)
+{
+    snapshot->fds.size = cutest_proc_list("/proc/self/fd",
+        snapshot->fds.entries, LEAK_CHECK_MAX_ENTRIES);
+    snapshot->tasks.size = cutest_proc_list("/proc/self/task",
+        snapshot->tasks.entries, LEAK_CHECK_MAX_ENTRIES);
+}
+
+/**
+ * @brief Report entries of \p dir in \p after but not in \p before.
+ * @return The number of leaked entries.
+ */
+static unsigned long _cutest_proc_compare(test_case_info_t* info, const char* dir,
+    const char* what, const test_proc_list_t* before, const test_proc_list_t* after)
+{
+    unsigned long leaked = 0;
+    long i = 0, j;
+    if (before->size < 0 || after->size < 0)
+    {
+        return 0;
+    }
+
+    /* Only the lowest entries are kept, anything above what both lists cover is unknown. */
+    long before_size = before->size < LEAK_CHECK_MAX_ENTRIES ? before->size : LEAK_CHECK_MAX_ENTRIES;
+    long after_size = after->size < LEAK_CHECK_MAX_ENTRIES ? after->size : LEAK_CHECK_MAX_ENTRIES;
+    if (before_size != before->size || after_size != after->size)
+    {
+        _cutest_warning("%s has more than " TEST_STRINGIFY(LEAK_CHECK_MAX_ENTRIES)
+            " entries in %s, only the lowest are checked.", info->fmt_name, dir);
+    }
+
+    for (j = 0; j < after_size; j++)
+    {
+        if (before_size != before->size && after->entries[j] > before->entries[before_size - 1])
+        {
+            break;
+        }
+        while (i < before_size && before->entries[i] < after->entries[j])
+        {
+            i++;
+        }
+        if (i < before_size && before->entries[i] == after->entries[j])
+        {
+            continue;
+        }
+
+        char desc[256];
+        if (cutest_proc_describe(dir, after->entries[j], desc, sizeof(desc)) != 0)
+        {
+            /* Already gone. */
+            continue;
+        }
+        leaked++;
+
+        if (g_test_ctx.mask.check_leaks == 1)
+        {
+            _cutest_warning("%s leaks %s %lu (%s).", info->fmt_name, what, after->entries[j], desc);
+            continue;
+        }
+        if (leaked == 1)
+        {
+            cutest_porting_fprintf(g_test_ctx.out,
+                "%s:failure:\n"
+                "            expected: no leaked %s\n",
+                info->fmt_name, what);
+        }
+        cutest_porting_fprintf(g_test_ctx.out,
+            "              actual: %s %lu (%s)\n", what, after->entries[j], desc);
+    }
+
+    return leaked;
+}
+
+/**
+ * @brief Check file descriptors and threads left by test.
+ */
+static void _cutest_check_proc_leak(test_case_info_t* info)
+{
+    static test_proc_snapshot_t s_after;
+    _cutest_proc_snapshot(&s_after);
+
+    unsigned long leaked = _cutest_proc_compare(info, "/proc/self/fd", "fd",
+        &s_proc_snapshot.fds, &s_after.fds);
+    leaked += _cutest_proc_compare(info, "/proc/self/task", "thread",
+        &s_proc_snapshot.tasks, &s_after.tasks);
+
+    if (leaked != 0 && g_test_ctx.mask.check_leaks == 2)
+    {
+        SET_MASK(info->test_case->data.mask, MASK_FAILURE);
+    }
+}
+
+static void _cutest_show_leak(test_case_info_t* info)
+{
+    if (g_test_ctx.mask.alloc_leaks == 1)
+    {
+        _cutest_warning("%s leaks %lu allocation%s (%lu bytes).", info->fmt_name,
+            info->alloc.leaks, info->alloc.leaks > 1 ? "s" : "", info->alloc.leak_bytes);
+        return;
+    }
+
+    cutest_porting_fprintf(g_test_ctx.out,
+        "%s:failure:\n"
+        "            expected: no memory leak\n"
+        "              actual: %lu allocation%s (%lu bytes) not freed\n",
+        info->fmt_name, info->alloc.leaks, info->alloc.leaks > 1 ? "s" : "",
+        info->alloc.leak_bytes);
+    SET_MASK(info->test_case->data.mask, MASK_FAILURE);
+}
+
+static void _cutest_check_io_budget(test_case_info_t* info)
+{
+    const cutest_io_t* io = &info->test_case->data.io;
+    unsigned long total = io->rchar + io->wchar;
+    if (total <= g_test_ctx.budget.max_io_bytes)
+    {
+        return;
+    }
+
+    cutest_porting_fprintf(g_test_ctx.out,
+        "%s:failure:\n"
+        "            expected: I/O <= %lu bytes\n"
+        "              actual: %lu bytes (read %lu, written %lu)\n",
+        info->fmt_name, g_test_ctx.budget.max_io_bytes, total, io->rchar, io->wchar);
+    SET_MASK(info->test_case->data.mask, MASK_FAILURE);
+}
+
+static void _cutest_show_io(test_case_info_t* info)
+{
+    const cutest_io_t* io = &info->test_case->data.io;
+    cutest_porting_cfprintf(g_test_ctx.out, CUTEST_COLOR_DEFAULT, "[ IO       ]");
+    cutest_porting_cfprintf(g_test_ctx.out, CUTEST_COLOR_DEFAULT,
+        " %s rchar %lu, wchar %lu, syscr %lu, syscw %lu, read_bytes %lu, write_bytes %lu\n",
+        info->fmt_name, io->rchar, io->wchar, io->syscr, io->syscw,
+        io->read_bytes, io->write_bytes);
+}
+
+static void _cutest_show_usage(test_case_info_t* info)
+{
+    const cutest_usage_t* usage = &info->test_case->data.usage;
+    cutest_porting_cfprintf(g_test_ctx.out, CUTEST_COLOR_DEFAULT, "[ USAGE    ]");
+    cutest_porting_cfprintf(g_test_ctx.out, CUTEST_COLOR_DEFAULT,
+        " %s maxrss +%lu KiB, minflt %lu, majflt %lu, nvcsw %lu, nivcsw %lu, inblock %lu, oublock %lu\n",
+        info->fmt_name, usage->maxrss, usage->minflt, usage->majflt,
+        usage->nvcsw, usage->nivcsw, usage->inblock, usage->oublock);
+
+    if (info->has_alloc)
+    {
+        cutest_porting_cfprintf(g_test_ctx.out, CUTEST_COLOR_DEFAULT, "[ ALLOC    ]");
+        cutest_porting_cfprintf(g_test_ctx.out, CUTEST_COLOR_DEFAULT,
+            " %s %lu allocs, %lu bytes, peak +%lu bytes\n",
+            info->fmt_name, info->alloc.allocs, info->alloc.bytes, info->alloc.peak);
+    }
+    if (info->arena_used != 0)
+    {
+        cutest_porting_cfprintf(g_test_ctx.out, CUTEST_COLOR_DEFAULT, "[ ARENA    ]");
+        cutest_porting_cfprintf(g_test_ctx.out, CUTEST_COLOR_DEFAULT,
+            " %s %lu bytes\n", info->fmt_name, (unsigned long)info->arena_used);
+    }
+}
+
+/**
+ * @brief Flag \p info if most of its wall time is spent off CPU, which usually
+ *   means it sleeps or waits for I/O.
+ */
+static void _cutest_show_waiting(test_case_info_t* info, const cutest_cputime_t* cpu)
+{
+    double wall_ns = info->test_case->data.elapsed;
+    if (g_test_ctx.report.waiting == 0 || wall_ns < REPORT_WAITING_MIN_MS * 1000000.0)
+    {
+        return;
+    }
+
+    /* Process CPU time also covers threads started by the test. */
+    double ratio = cpu->process_ns / wall_ns * 100.0;
+    if (ratio >= (double)g_test_ctx.report.waiting)
+    {
+        return;
+    }
+
+    cutest_porting_cfprintf(g_test_ctx.out, CUTEST_COLOR_YELLOW, "[ WAITING  ]");
+    cutest_porting_cfprintf(g_test_ctx.out, CUTEST_COLOR_DEFAULT,
+        " %s was on CPU for %.0f%% of %.0f ms.\n",
+        info->fmt_name, ratio, wall_ns / 1000000.0);
+}
+
+/**
+ * @brief Fill names, location and parameter of \p result.
+ */
+static void _cutest_result_init(cutest_result_t* result, test_case_info_t* info)
+{
+    cutest_case_t* test_case = info->test_case;
+    cutest_porting_memset(result, 0, sizeof(*result));
+
+    result->version = CUTEST_HOOK_EX_VERSION;
+    result->test_case = test_case;
+    result->fixture_name = test_case->info.fixture_name;
+    result->case_name = test_case->info.case_name;
+    result->full_name = info->fmt_name;
+    result->file = test_case->info.file;
+    result->line = test_case->info.line;
+    result->param_type = test_case->parameterized.type_name;
+    result->param_idx = test_case->parameterized.param_idx;
+}
+
+/**
+ * @brief Get the extended hook if it is at least \p version.
+ *
+ * A hook built against an older header is smaller, so callbacks appended
+ * later must not be read from it.
+ *
+ * @param[in] version   The version that introduced the callback.
+ * @return              The extended hook, or NULL.
+ */
+static const cutest_hook_ex_t* _cutest_hook_ex_get(unsigned version)
+{
+    const cutest_hook_ex_t* hook_ex = g_test_ctx.hook_ex;
+    return (hook_ex != NULL && hook_ex->version >= version) ? hook_ex : NULL;
+}
+
+static void _cutest_hook_ex_before_test(test_case_info_t* info)
+{
+    cutest_result_t result;
+    const cutest_hook_ex_t* hook_ex = _cutest_hook_ex_get(1);
+    if (hook_ex == NULL || hook_ex->before_test == NULL)
+    {
+        return;
+    }
+
+    _cutest_result_init(&result, info);
+    hook_ex->before_test(&result);
+}
+
+static void _cutest_hook_ex_after_test(test_case_info_t* info, const cutest_cputime_t* cpu)
+{
+    cutest_result_t result;
+    cutest_case_t* test_case = info->test_case;
+    const cutest_hook_ex_t* hook_ex = _cutest_hook_ex_get(1);
+    if (hook_ex == NULL || hook_ex->after_test == NULL)
+    {
+        return;
+    }
+
+    _cutest_result_init(&result, info);
+    if (HAS_MASK(test_case->data.mask, MASK_FAILURE))
+    {
+        result.status |= CUTEST_RESULT_FAILURE;
+    }
+    if (HAS_MASK(test_case->data.mask, MASK_SKIPPED))
+    {
+        result.status |= CUTEST_RESULT_SKIPPED;
+    }
+    result.assertions = g_test_ctx.runtime.assertions;
+    result.failure_file = g_test_ctx.runtime.failure_file;
+    result.failure_line = g_test_ctx.runtime.failure_line;
+    result.elapsed_ns = test_case->data.elapsed;
+    result.setup_ns = info->ns_setup;
+    result.body_ns = info->ns_body;
+    result.teardown_ns = info->ns_teardown;
+    if (info->has_cpu)
+    {
+        result.cpu_ns = cpu->process_ns;
+        result.thread_cpu_ns = cpu->thread_ns;
+    }
+    result.usage = test_case->data.usage;
+    result.io = test_case->data.io;
+    result.alloc = info->alloc;
+
+    hook_ex->after_test(&result);
+}
+
+static void _cutest_finishlize(test_case_info_t* info)
+{
+    cutest_cputime_t cpu = { 0, 0 };
+    cutest_porting_clock_gettime(&info->tv_case_end);
+    /* Stop faults before cutest does its own I/O. */
+    info->has_io_fault = cutest_io_fault_end(&info->io_fault);
+    if (info->has_cpu && cutest_cputime_get(&cpu) == 0)
+    {
+        cpu.process_ns -= info->cpu_beg.process_ns;
+        cpu.thread_ns -= info->cpu_beg.thread_ns;
+    }
+    else
+    {
+        info->has_cpu = 0;
+    }
+    int has_usage = _cutest_usage_since_start(&info->test_case->data.usage) == 0;
+    g_test_ctx.runtime.has_usage = 0;
+    int has_io = _cutest_io_since_start(&info->test_case->data.io) == 0;
+    g_test_ctx.runtime.has_io = 0;
+    cutest_alloc_end(&info->alloc_beg, &info->alloc);
+    info->arena_used = _cutest_arena_reset();
+    unsigned long guarded = _cutest_guarded_release();
+    if (guarded != 0 && !HAS_MASK(info->test_case->data.mask, MASK_FAILURE))
+    {
+        _cutest_warning("%s leaks %lu guarded buffer%s.", info->fmt_name,
+            guarded, guarded > 1 ? "s" : "");
+    }
+    _cutest_tmpdir_remove(info);
+#if defined(CUTEST_ALLOC_TRACKER)
+    if (g_test_ctx.mask.sweep_child)
+    {
+        _cutest_alloc_sweep_exit(info);
+    }
+#endif
+    /* A failed test may skip its cleanup, so only check leaks of a passing test. */
+    if (info->has_alloc && info->alloc.leaks != 0 && g_test_ctx.mask.alloc_leaks != 0
+        && !HAS_MASK(info->test_case->data.mask, MASK_FAILURE))
+    {
+        _cutest_show_leak(info);
+    }
+    if (g_test_ctx.mask.check_leaks != 0
+        && !HAS_MASK(info->test_case->data.mask, MASK_FAILURE))
+    {
+        _cutest_check_proc_leak(info);
+    }
+    if (has_io && g_test_ctx.budget.max_io_bytes != 0
+        && !HAS_MASK(info->test_case->data.mask, MASK_FAILURE | MASK_SKIPPED))
+    {
+        _cutest_check_io_budget(info);
+    }
+#if defined(CUTEST_ALLOC_TRACKER)
+    if (g_test_ctx.mask.fail_alloc_sweep && info->alloc.allocs != 0
+        && info->test_case->bench.type == CUTEST_BENCH_NONE
+        && !HAS_MASK(info->test_case->data.mask, MASK_FAILURE | MASK_SKIPPED))
+    {
+        _cutest_alloc_sweep(info);
+    }
+#endif
+
+    cutest_porting_timespec_t tv_diff;
+    cutest_timestamp_dif(&info->tv_case_beg, &info->tv_case_end, &tv_diff);
+    info->test_case->data.elapsed = cutest_timestamp_ns(&tv_diff);
+    _cutest_trace_span(info->fmt_name, "case", 0, &info->tv_case_beg, &info->tv_case_end);
+    _cutest_stat_update(info->test_case, info->test_case->data.elapsed);
+
+    if (HAS_MASK(info->test_case->data.mask, MASK_FAILURE))
+    {
+        g_test_ctx.counter.result.failed++;
+        cutest_porting_cfprintf(g_test_ctx.out, CUTEST_COLOR_RED, "[  FAILED  ]");
+    }
+    else if (HAS_MASK(info->test_case->data.mask, MASK_SKIPPED))
+    {
+        g_test_ctx.counter.result.skipped++;
+        cutest_porting_cfprintf(g_test_ctx.out, CUTEST_COLOR_YELLOW, "[   SKIP   ]");
+    }
+    else
+    {
+        g_test_ctx.counter.result.success++;
+        cutest_porting_cfprintf(g_test_ctx.out, CUTEST_COLOR_GREEN, "[       OK ]");
+    }
+
+    cutest_porting_cfprintf(g_test_ctx.out, CUTEST_COLOR_DEFAULT, " %s", info->fmt_name);
+    if (!g_test_ctx.mask.no_print_time)
+    {
+        unsigned long take_time = (unsigned long)(tv_diff.tv_sec * 1000 + tv_diff.tv_nsec / 1000000);
+        cutest_porting_cfprintf(g_test_ctx.out, CUTEST_COLOR_DEFAULT, " (%lu ms", take_time);
+        if (g_test_ctx.mask.print_stage_time)
+        {
+            cutest_porting_cfprintf(g_test_ctx.out, CUTEST_COLOR_DEFAULT,
+                ", setup %.0f ns, body %.0f ns, teardown %.0f ns",
+                info->ns_setup, info->ns_body, info->ns_teardown);
+            if (info->has_cpu)
+            {
+                cutest_porting_cfprintf(g_test_ctx.out, CUTEST_COLOR_DEFAULT,
+                    ", cpu %.0f ns, thread cpu %.0f ns", cpu.process_ns, cpu.thread_ns);
+            }
+        }
+        cutest_porting_cfprintf(g_test_ctx.out, CUTEST_COLOR_DEFAULT, ")");
+    }
+    cutest_porting_cfprintf(g_test_ctx.out, CUTEST_COLOR_DEFAULT, "\n");
+
+    if (info->has_cpu)
+    {
+        _cutest_show_waiting(info, &cpu);
+    }
+    if (g_test_ctx.mask.print_usage && has_usage)
+    {
+        _cutest_show_usage(info);
+    }
+    if (g_test_ctx.mask.print_usage && has_io)
+    {
+        _cutest_show_io(info);
+    }
+    if (info->has_io_fault)
+    {
+        cutest_porting_cfprintf(g_test_ctx.out, CUTEST_COLOR_DEFAULT, "[ IO FAULT ]");
+        cutest_porting_cfprintf(g_test_ctx.out, CUTEST_COLOR_DEFAULT,
+            " %s %lu delayed, %lu short, %lu eintr, %lu eio\n",
+            info->fmt_name, info->io_fault.delayed, info->io_fault.shorted,
+            info->io_fault.eintr, info->io_fault.eio);
+    }
+    if (info->has_sweep)
+    {
+        cutest_porting_cfprintf(g_test_ctx.out, CUTEST_COLOR_DEFAULT, "[ SWEEP    ]");
+        cutest_porting_cfprintf(g_test_ctx.out, CUTEST_COLOR_DEFAULT,
+            " %s %lu allocation points, %lu crashed, %lu leaked\n",
+            info->fmt_name, info->alloc.allocs, info->sweep_crashed, info->sweep_leaked);
+    }
+    _cutest_show_timer();
+    _cutest_hook_ex_after_test(info, &cpu);
+}
+
+#if CUTEST_HAVE_THREADS
+
+typedef struct test_bench_worker
+{
+    cutest_thread_t             thread;         /**< Worker thread. */
+    cutest_case_t*              test_case;      /**< Benchmark to run. */
+    unsigned long               iterations;     /**< The number of iterations to run. */
+    cutest_porting_timespec_t   tv_beg;         /**< Start time. */
+    cutest_porting_timespec_t   tv_end;         /**< End time. */
+} test_bench_worker_t;
+
+typedef struct test_bench_ctx
+{
+    cutest_event_t              start;          /**< Start gate of workers. */
+    volatile long               hist_lock;      /**< Guard of merging latency histograms. */
+    test_bench_worker_t         workers[CUTEST_BENCH_MAX_THREADS];
+} test_bench_ctx_t;
+
+/**
+ * @brief Benchmark workers.
+ * Keep it out of #g_test_ctx so it is not cleared for every run.
+ */
+static test_bench_ctx_t s_bench_ctx;
+
+#endif
+
+static void _cutest_bench_loop(cutest_case_t* test_case, unsigned long iterations)
+{
+    unsigned long i;
+    for (i = 0; i < iterations; i++)
+    {
+        test_case->stage.body(NULL, 0);
+    }
+}
+
+#if CUTEST_HAVE_THREADS
+
+static void _cutest_bench_worker(void* arg)
+{
+    test_bench_worker_t* worker = arg;
+
+    cutest_event_wait(&s_bench_ctx.start);
+    cutest_porting_clock_gettime(&worker->tv_beg);
+    _cutest_bench_loop(worker->test_case, worker->iterations);
+    cutest_porting_clock_gettime(&worker->tv_end);
+}
+
+/**
+ * @brief Run benchmark in \p threads worker threads.
+ */
+static void _cutest_bench_run_threads(cutest_case_t* test_case, unsigned long threads,
+    unsigned long iterations, cutest_porting_timespec_t* tv_beg, cutest_porting_timespec_t* tv_end)
+{
+    unsigned long i;
+    cutest_event_init(&s_bench_ctx.start);
+
+    for (i = 0; i < threads; i++)
+    {
+        test_bench_worker_t* worker = &s_bench_ctx.workers[i];
+        worker->test_case = test_case;
+        worker->iterations = iterations;
+        CUTEST_PORTING_ASSERT(cutest_thread_create(&worker->thread, _cutest_bench_worker, worker) == 0);
+    }
+
+    /* All workers are waiting for the gate, open it. */
+    cutest_porting_clock_gettime(tv_beg);
+    cutest_event_set(&s_bench_ctx.start);
+
+    for (i = 0; i < threads; i++)
+    {
+        cutest_thread_join(&s_bench_ctx.workers[i].thread);
+    }
+    cutest_porting_clock_gettime(tv_end);
+
+    /* Workers are joined, so it is safe to write their spans now. */
+    for (i = 0; i < threads; i++)
+    {
+        test_bench_worker_t* worker = &s_bench_ctx.workers[i];
+        _cutest_trace_span(test_case->info.case_name, "worker", i + 1, &worker->tv_beg, &worker->tv_end);
+    }
+
+    cutest_event_exit(&s_bench_ctx.start);
+}
+
+#endif
+
+/**
+ * @brief Run \p iterations of benchmark body in each of \p threads threads.
+ * @return  The elapsed wall time in nanoseconds.
+ */
+static double _cutest_bench_run_once(cutest_case_t* test_case, unsigned long threads,
+    unsigned long iterations)
+{
+    cutest_porting_timespec_t tv_beg, tv_end, tv_diff;
+
+#if CUTEST_HAVE_THREADS
+    if (threads > 1)
+    {
+        _cutest_bench_run_threads(test_case, threads, iterations, &tv_beg, &tv_end);
+        goto finish;
+    }
+#endif
+
+    (void)threads;
+    cutest_porting_clock_gettime(&tv_beg);
+    _cutest_bench_loop(test_case, iterations);
+    cutest_porting_clock_gettime(&tv_end);
+
+#if CUTEST_HAVE_THREADS
+finish:
+#endif
+    cutest_timestamp_dif(&tv_beg, &tv_end, &tv_diff);
+    return cutest_timestamp_ns(&tv_diff);
+}
+
+/**
+ * @brief Calibrate the number of iterations until the measurement takes at
+ *   least `--test_bench_min_time`.
+ * @param[in] test_case     Benchmark.
+ * @param[in] threads       The number of threads.
+ * @param[out] iterations   The number of iterations of each thread.
+ * @return                  The elapsed wall time in nanoseconds.
+ */
+static double _cutest_bench_measure(cutest_case_t* test_case, unsigned long threads,
+    unsigned long* iterations)
+{
+    double min_time = (double)g_test_ctx.bench.min_time * 1000000.0;
+    unsigned long n = 1;
+
+    for (;;)
+    {
+        double elapsed = _cutest_bench_run_once(test_case, threads, n);
+        if (elapsed >= min_time || n >= BENCH_MAX_ITERATIONS)
         {
-            switch (*pattern)
+            *iterations = n;
+            return elapsed;
+        }
+
+        /* Predict the iterations we need, but grow at least 2x and at most 100x. */
+        double multiplier = elapsed > 0 ? min_time * 1.4 / elapsed : 100.0;
+        multiplier = multiplier < 2.0 ? 2.0 : (multiplier > 100.0 ? 100.0 : multiplier);
+
+        double next = (double)n * multiplier;
+        n = next < (double)BENCH_MAX_ITERATIONS ? (unsigned long)next : BENCH_MAX_ITERATIONS;
+    }
+}
+
+typedef struct test_bench_hist
+{
+    unsigned long               counts[BENCH_HIST_SIZE];    /**< Counts of each value range. */
+    unsigned long               total;                      /**< Total count. */
+    cutest_uint64_t             max;                        /**< Maximum recorded value. */
+    double                      overhead;                   /**< Timestamp overhead in nanoseconds. */
+} test_bench_hist_t;
+
+/**
+ * @brief Latency histogram of current benchmark.
+ */
+static test_bench_hist_t s_bench_hist;
+
+static unsigned _cutest_bench_hist_bitlen(cutest_uint64_t v)
+{
+    unsigned n = 0;
+    while (v != 0)
+    {
+        v >>= 1;
+        n++;
+    }
+    return n;
+}
+
+static void _cutest_bench_hist_record(test_bench_hist_t* hist, cutest_uint64_t v)
+{
+    const cutest_uint64_t limit = ((cutest_uint64_t)1 << BENCH_HIST_MAX_BITS) - 1;
+
+    if (v > hist->max)
+    {
+        hist->max = v;
+    }
+    if (v > limit)
+    {
+        v = limit;
+    }
+
+    unsigned bucket = _cutest_bench_hist_bitlen(v | (BENCH_HIST_SUB_COUNT - 1)) - BENCH_HIST_SUB_BITS;
+    unsigned long sub = (unsigned long)(v >> bucket);
+
+    hist->counts[((bucket + 1) << (BENCH_HIST_SUB_BITS - 1)) + (sub - BENCH_HIST_SUB_HALF)]++;
+    hist->total++;
+}
+
+/**
+ * @brief Get the value range of histogram slot \p idx.
+ * @param[in] idx       Slot index.
+ * @param[out] lowest   Lowest value that counts into this slot.
+ * @return              Highest value that counts into this slot.
+ */
+static cutest_uint64_t _cutest_bench_hist_value(unsigned long idx, cutest_uint64_t* lowest)
+{
+    long bucket = (long)(idx >> (BENCH_HIST_SUB_BITS - 1)) - 1;
+    unsigned long sub = (idx & (BENCH_HIST_SUB_HALF - 1)) + BENCH_HIST_SUB_HALF;
+    if (bucket < 0)
+    {
+        sub -= BENCH_HIST_SUB_HALF;
+        bucket = 0;
+    }
+
+    cutest_uint64_t low = (cutest_uint64_t)sub << bucket;
+    if (lowest != NULL)
+    {
+        *lowest = low;
+    }
+    return low + ((cutest_uint64_t)1 << bucket) - 1;
+}
+
+/**
+ * @brief Get value at percentile \p p.
+ * @param[in] hist  Histogram.
+ * @param[in] p     Percentile in range [0, 100].
+ * @return          The highest value equivalent to the value at \p p, but not
+ *   larger than the maximum recorded value.
+ */
+static cutest_uint64_t _cutest_bench_hist_percentile(const test_bench_hist_t* hist, double p)
+{
+    unsigned long target = (unsigned long)(p / 100.0 * (double)hist->total + 0.5);
+    unsigned long cum = 0;
+    unsigned long i;
+
+    target = target == 0 ? 1 : target;
+    for (i = 0; i < BENCH_HIST_SIZE; i++)
+    {
+        cum += hist->counts[i];
+        if (cum >= target)
+        {
+            cutest_uint64_t v = _cutest_bench_hist_value(i, NULL);
+            return v < hist->max ? v : hist->max;
+        }
+    }
+
+    return hist->max;
+}
+
+/**
+ * @brief Measure the overhead of one timestamp and one record, so it can be
+ *   subtracted from every iteration.
+ */
+static double _cutest_bench_hist_calibrate(void)
+{
+    cutest_porting_timespec_t tv_beg, tv_end, tv_diff;
+    double overhead = -1;
+    unsigned long i;
+
+    cutest_porting_clock_gettime(&tv_beg);
+    for (i = 0; i < BENCH_HIST_CALIBRATION; i++)
+    {
+        cutest_porting_clock_gettime(&tv_end);
+        cutest_timestamp_dif(&tv_beg, &tv_end, &tv_diff);
+        tv_beg = tv_end;
+
+        double ns = cutest_timestamp_ns(&tv_diff);
+        if (overhead < 0 || ns < overhead)
+        {
+            overhead = ns;
+        }
+    }
+
+    return overhead;
+}
+
+/**
+ * @brief Record latency of every iteration of benchmark, until it takes at
+ *   least `--test_bench_min_time`.
+ *
+ * The timestamp taken at the end of one iteration is the beginning of the
+ * next one, so only one timestamp is taken per iteration.
+ */
+static void _cutest_bench_hist_run(cutest_case_t* test_case, test_bench_hist_t* hist)
+{
+    cutest_porting_timespec_t tv_start, tv_beg, tv_end, tv_diff;
+    double min_time = (double)g_test_ctx.bench.min_time * 1000000.0;
+
+    cutest_porting_memset(hist, 0, sizeof(*hist));
+    hist->overhead = _cutest_bench_hist_calibrate();
+
+    cutest_porting_clock_gettime(&tv_start);
+    tv_beg = tv_start;
+    do
+    {
+        test_case->stage.body(NULL, 0);
+        cutest_porting_clock_gettime(&tv_end);
+
+        cutest_timestamp_dif(&tv_beg, &tv_end, &tv_diff);
+        double ns = cutest_timestamp_ns(&tv_diff) - hist->overhead;
+        _cutest_bench_hist_record(hist, ns > 0 ? (cutest_uint64_t)ns : 0);
+        tv_beg = tv_end;
+
+        cutest_timestamp_dif(&tv_start, &tv_end, &tv_diff);
+    } while (cutest_timestamp_ns(&tv_diff) < min_time);
+}
+
+/**
+ * @brief Write \p hist into \p file in HdrHistogram percentile distribution
+ *   format. Values are in nanoseconds.
+ */
+static void _cutest_bench_hist_write_hgrm(FILE* file, const test_bench_hist_t* hist)
+{
+    double percentile_to = 0;
+    double sum = 0, sum_sq = 0;
+    unsigned long cum = 0;
+    unsigned long i;
+
+    cutest_porting_fprintf(file, "%12s %14s %10s %14s\n\n",
+        "Value", "Percentile", "TotalCount", "1/(1-Percentile)");
+
+    for (i = 0; i < BENCH_HIST_SIZE; i++)
+    {
+        if (hist->counts[i] == 0)
+        {
+            continue;
+        }
+
+        cutest_uint64_t lowest;
+        cutest_uint64_t highest = _cutest_bench_hist_value(i, &lowest);
+        double median = (double)lowest + (double)(highest - lowest) / 2.0;
+        sum += median * (double)hist->counts[i];
+        sum_sq += median * median * (double)hist->counts[i];
+
+        cum += hist->counts[i];
+        double percentile = 100.0 * (double)cum / (double)hist->total;
+
+        /* Report finer as the percentile gets closer to 100, 5 ticks per half distance. */
+        while (cum < hist->total && percentile >= percentile_to)
+        {
+            cutest_porting_fprintf(file, "%12.3f %2.12f %10lu %14.2f\n",
+                (double)highest, percentile_to / 100.0, cum, 1.0 / (1.0 - percentile_to / 100.0));
+
+            double half_distance = 1;
+            double ratio = 100.0 / (100.0 - percentile_to);
+            while (ratio >= 2)
             {
-            default:  // Match an ordinary character.
-                if (name < name_end && *name == *pattern)
-                {
-                    ++pattern;
-                    ++name;
-                    continue;
-                }
-                break;
-            case '?':  // Match any single character.
-                if (name < name_end)
-                {
-                    ++pattern;
-                    ++name;
-                    continue;
-                }
-                break;
-            case '*':
-                // Match zero or more characters. Start by skipping over the wildcard
-                // and matching zero characters from name. If that fails, restart and
-                // match one more character than the last attempt.
-                pattern_next = pattern;
-                name_next = name + 1;
-                ++pattern;
-                continue;
+                ratio /= 2;
+                half_distance *= 2;
             }
+            percentile_to += 100.0 / (5 * half_distance * 2);
         }
-        // Failed to match a character. Restart if possible.
-        if (name_begin < name_next && name_next <= name_end)
+    }
+
+    cutest_porting_fprintf(file, "%12.3f %2.12f %10lu\n", (double)hist->max, 1.0, cum);
+
+    double mean = sum / (double)hist->total;
+    double variance = sum_sq / (double)hist->total - mean * mean;
+    cutest_porting_fprintf(file, "#[Mean    = %12.3f, StdDeviation   = %12.3f]\n",
+        mean, _cutest_sqrt(variance > 0 ? variance : 0));
+    cutest_porting_fprintf(file, "#[Max     = %12.3f, Total count    = %12lu]\n",
+        (double)hist->max, hist->total);
+    cutest_porting_fprintf(file, "#[Buckets = %12lu, SubBuckets     = %12lu]\n",
+        (unsigned long)BENCH_HIST_BUCKETS, (unsigned long)BENCH_HIST_SUB_COUNT);
+}
+
+static void _cutest_bench_hist_export(test_case_info_t* info, const test_bench_hist_t* hist)
+{
+    static char path[CUTEST_PATH_MAX];
+
+    char* pos = _cutest_path_append(path, path, g_test_ctx.bench.hgrm);
+    pos = _cutest_path_append(path, pos, "/");
+    pos = _cutest_path_append(path, pos, info->test_case->info.fixture_name);
+    pos = _cutest_path_append(path, pos, ".");
+    pos = _cutest_path_append(path, pos, info->test_case->info.case_name);
+    pos = _cutest_path_append(path, pos, ".hgrm");
+
+    FILE* file = pos != NULL ? _cutest_fopen(path, "w") : NULL;
+    if (file == NULL)
+    {
+        _cutest_warning("cannot write histogram into `%s`.",
+            pos != NULL ? path : g_test_ctx.bench.hgrm);
+        return;
+    }
+
+    _cutest_bench_hist_write_hgrm(file, hist);
+    fclose(file);
+}
+
+static void _cutest_bench_print_latency(test_case_info_t* info, const test_bench_hist_t* hist)
+{
+    cutest_porting_cfprintf(g_test_ctx.out, CUTEST_COLOR_DEFAULT, "[ LATENCY  ]");
+    cutest_porting_cfprintf(g_test_ctx.out, CUTEST_COLOR_DEFAULT,
+        " p50 %.0f ns, p90 %.0f ns, p99 %.0f ns, p99.9 %.0f ns, max %.0f ns\n",
+        (double)_cutest_bench_hist_percentile(hist, 50),
+        (double)_cutest_bench_hist_percentile(hist, 90),
+        (double)_cutest_bench_hist_percentile(hist, 99),
+        (double)_cutest_bench_hist_percentile(hist, 99.9),
+        (double)hist->max);
+
+    if (g_test_ctx.bench.hgrm != NULL)
+    {
+        _cutest_bench_hist_export(info, hist);
+    }
+}
+
+static void _cutest_bench_run_latency(test_case_info_t* info)
+{
+    test_bench_hist_t* hist = &s_bench_hist;
+    _cutest_bench_hist_run(info->test_case, hist);
+    _cutest_bench_print_latency(info, hist);
+}
+
+#if CUTEST_HAVE_THREADS
+
+static void _cutest_bench_hist_merge(test_bench_hist_t* dst, const test_bench_hist_t* src)
+{
+    unsigned long i;
+    for (i = 0; i < BENCH_HIST_SIZE; i++)
+    {
+        dst->counts[i] += src->counts[i];
+    }
+
+    dst->total += src->total;
+    if (src->max > dst->max)
+    {
+        dst->max = src->max;
+    }
+}
+
+static void _cutest_bench_latency_worker(void* arg)
+{
+    test_bench_worker_t* worker = arg;
+    test_bench_hist_t hist;
+
+    cutest_event_wait(&s_bench_ctx.start);
+    _cutest_bench_hist_run(worker->test_case, &hist);
+
+    SPIN_LOCK(&s_bench_ctx.hist_lock);
+    _cutest_bench_hist_merge(&s_bench_hist, &hist);
+    SPIN_UNLOCK(&s_bench_ctx.hist_lock);
+}
+
+/**
+ * @brief Record latency of every iteration in each of \p threads threads.
+ *
+ * Each worker records into its own histogram, so recording does not contend,
+ * and merges it into #s_bench_hist when done.
+ */
+static void _cutest_bench_run_latency_threads(test_case_info_t* info, unsigned long threads)
+{
+    unsigned long i;
+    cutest_porting_memset(&s_bench_hist, 0, sizeof(s_bench_hist));
+    cutest_event_init(&s_bench_ctx.start);
+
+    for (i = 0; i < threads; i++)
+    {
+        test_bench_worker_t* worker = &s_bench_ctx.workers[i];
+        worker->test_case = info->test_case;
+        CUTEST_PORTING_ASSERT(cutest_thread_create(&worker->thread, _cutest_bench_latency_worker, worker) == 0);
+    }
+
+    cutest_event_set(&s_bench_ctx.start);
+
+    for (i = 0; i < threads; i++)
+    {
+        cutest_thread_join(&s_bench_ctx.workers[i].thread);
+    }
+
+    cutest_event_exit(&s_bench_ctx.start);
+    _cutest_bench_print_latency(info, &s_bench_hist);
+}
+
+#endif
+
+/**
+ * @brief Run open-loop load test.
+ *
+ * Call `i` is intended to start at `i / rate` seconds. If we are late, it
+ * starts immediately, but its latency is still measured from the intended
+ * start time. Calls not issued when the duration is over are backlog, and
+ * recorded with the time they have waited.
+ */
+/**
+ * @brief Wait until \p until nanoseconds after \p tv_start.
+ * @return  The elapsed nanoseconds since \p tv_start.
+ */
+static double _cutest_bench_load_wait(const cutest_porting_timespec_t* tv_start, double until)
+{
+    cutest_porting_timespec_t tv_now, tv_diff;
+    double now;
+
+    for (;;)
+    {
+        cutest_porting_clock_gettime(&tv_now);
+        cutest_timestamp_dif(tv_start, &tv_now, &tv_diff);
+        now = cutest_timestamp_ns(&tv_diff);
+        if (now >= until)
         {
-            pattern = pattern_next;
-            name = name_next;
-            continue;
+            return now;
+        }
+
+        /* Sleep for most of the wait, so a slow rate does not occupy a CPU. */
+        if (until - now > BENCH_LOAD_SPIN_NS)
+        {
+            cutest_nanosleep((unsigned long long)(until - now - BENCH_LOAD_SPIN_NS));
         }
-        return 0;
     }
-    return 1;
 }
 
-/**
- * @return true if this test will run, false if not.
- */
-static int _cutest_check_pattern(const char* str, unsigned long str_sz)
+static void _cutest_bench_run_load(test_case_info_t* info)
 {
-    test_str_t k, v = g_test_ctx.filter.pattern;
+    cutest_case_t* test_case = info->test_case;
+    test_bench_hist_t* hist = &s_bench_hist;
+    cutest_porting_timespec_t tv_start, tv_now, tv_diff;
 
-    /* If no pattern, run this test. */
-    if (v.ptr == NULL)
-    {
-        return 1;
-    }
+    const double interval = 1000000000.0 / (double)test_case->bench.rate;
+    const double duration = (double)test_case->bench.duration * 1000000.0;
+    double now = 0, max_lag = 0;
+    unsigned long calls = 0, backlog = 0;
 
-    unsigned long cnt_positive_patterns = 0;
-    int flag_match_positive_pattern = 0;
+    cutest_porting_memset(hist, 0, sizeof(*hist));
 
-    /* Split patterns by `:` */
-    while (_cutest_str_split(&v, &k, &v, ":", 0) == 0)
+    cutest_porting_clock_gettime(&tv_start);
+    for (;;)
     {
-        /* If it is a positive pattern. */
-        if (k.ptr[0] != '-')
+        double intended = (double)calls * interval;
+        if (intended >= duration)
         {
-            cnt_positive_patterns++;
+            break;
+        }
 
-            /* Record if it match any of positive pattern */
-            if (_cutest_pattern_match(k.ptr, k.len, str, str_sz))
-            {
-                flag_match_positive_pattern = 1;
-            }
+        now = _cutest_bench_load_wait(&tv_start, intended);
+
+        if (now >= duration)
+        {
+            break;
         }
-        else if (_cutest_pattern_match(k.ptr + 1, k.len - 1, str, str_sz))
-        {/* If match negative pattern, don't run. */
-            return 0;
+
+        if (now - intended > max_lag)
+        {
+            max_lag = now - intended;
         }
+
+        test_case->stage.body(NULL, 0);
+        calls++;
+
+        cutest_porting_clock_gettime(&tv_now);
+        cutest_timestamp_dif(&tv_start, &tv_now, &tv_diff);
+        now = cutest_timestamp_ns(&tv_diff);
+        _cutest_bench_hist_record(hist, (cutest_uint64_t)(now - intended));
     }
-    if (v.ptr[0] != '-')
+
+    /* Calls that should have started, but never got the chance. */
+    for (;; backlog++)
     {
-        cnt_positive_patterns++;
-        if (_cutest_pattern_match(v.ptr, v.len, str, str_sz))
+        double intended = (double)(calls + backlog) * interval;
+        if (intended >= duration || intended >= now)
         {
-            flag_match_positive_pattern = 1;
+            break;
         }
+        _cutest_bench_hist_record(hist, (cutest_uint64_t)(now - intended));
     }
-    else if (_cutest_pattern_match(v.ptr + 1, v.len - 1, str, str_sz))
+
+    /* The rate is measured over the whole window, even if the last call finished early. */
+    now = _cutest_bench_load_wait(&tv_start, duration);
+
+    cutest_porting_cfprintf(g_test_ctx.out, CUTEST_COLOR_DEFAULT, "[ LOAD     ]");
+    cutest_porting_cfprintf(g_test_ctx.out, CUTEST_COLOR_DEFAULT,
+        " target %lu/s, achieved %.2f/s, %lu calls, backlog %lu, max lag %.0f ns\n",
+        test_case->bench.rate, (double)calls * 1000000000.0 / now, calls, backlog, max_lag);
+
+    _cutest_bench_print_latency(info, hist);
+}
+
+/**
+ * @brief Print throughput set by #cutest_bench_set_bytes() and
+ *   #cutest_bench_set_items(), if any.
+ * @param[in] ops   Iterations per second.
+ */
+static void _cutest_bench_print_throughput(double ops)
+{
+    if (g_test_ctx.bench.bytes != 0)
     {
-        return 0;
+        cutest_porting_cfprintf(g_test_ctx.out, CUTEST_COLOR_DEFAULT,
+            ", %.3f GB/s", ops * (double)g_test_ctx.bench.bytes / 1000000000.0);
     }
+    if (g_test_ctx.bench.items != 0)
+    {
+        cutest_porting_cfprintf(g_test_ctx.out, CUTEST_COLOR_DEFAULT,
+            ", %.2f items/s", ops * (double)g_test_ctx.bench.items);
+    }
+}
 
-    return cnt_positive_patterns ? flag_match_positive_pattern : 1;
+static void _cutest_bench_run_single(test_case_info_t* info)
+{
+    unsigned long iterations;
+    double elapsed = _cutest_bench_measure(info->test_case, 1, &iterations);
+
+    cutest_porting_cfprintf(g_test_ctx.out, CUTEST_COLOR_DEFAULT, "[ BENCH    ]");
+    cutest_porting_cfprintf(g_test_ctx.out, CUTEST_COLOR_DEFAULT,
+        " %lu iterations, %.3f ns/op", iterations, elapsed / (double)iterations);
+    _cutest_bench_print_throughput((double)iterations * 1000000000.0 / elapsed);
+    cutest_porting_cfprintf(g_test_ctx.out, CUTEST_COLOR_DEFAULT, "\n");
+
+    _cutest_bench_run_latency(info);
 }
 
 /**
- * @return bool
+ * @brief Fit serial fraction `s` of Amdahl's law `1/S(p) = s + (1-s)/p`.
+ *
+ * Let `x = 1 - 1/p` and `y = 1/S(p) - 1/p`, the law becomes `y = s * x`, so
+ * the least squares solution is `s = sum(x*y) / sum(x*x)`.
+ *
+ * @param[in] threads   Thread counts.
+ * @param[in] speedup   Speedup of each thread count.
+ * @param[in] num       The number of samples.
+ * @return              Serial fraction in range [0, 1].
  */
-static int _cutest_check_disable(const char* name)
+static double _cutest_bench_fit_amdahl(const unsigned long* threads,
+    const double* speedup, unsigned long num)
 {
-    return !g_test_ctx.mask.also_run_disabled_tests &&
-        (cutest_porting_strncmp("DISABLED_", name, 9) == 0);
+    double sum_xy = 0, sum_xx = 0;
+
+    unsigned long i;
+    for (i = 0; i < num; i++)
+    {
+        double p = (double)threads[i];
+        double x = 1.0 - 1.0 / p;
+        double y = 1.0 / speedup[i] - 1.0 / p;
+        sum_xy += x * y;
+        sum_xx += x * x;
+    }
+
+    if (sum_xx == 0)
+    {
+        return 0;
+    }
+
+    double s = sum_xy / sum_xx;
+    return s < 0 ? 0 : (s > 1 ? 1 : s);
 }
 
-static int _cutest_print_encoded(const char* str)
+static void _cutest_bench_run_scaling(test_case_info_t* info)
 {
-    int ret = 0;
-    cutest_porting_color_t color = CUTEST_COLOR_DEFAULT;
+    /* Enough to hold powers of two plus the maximum. */
+    unsigned long threads[sizeof(unsigned long) * 8 + 1];
+    double speedup[TEST_ARRAY_SIZE(threads)];
+    unsigned long num = 0;
+    double base_throughput = 0;
+
+    unsigned long max_threads = g_test_ctx.bench.max_threads;
+    if (max_threads == 0)
+    {
+        max_threads = cutest_cpu_count();
+    }
+    if (!CUTEST_HAVE_THREADS)
+    {
+        max_threads = 1;
+    }
+    if (max_threads > CUTEST_BENCH_MAX_THREADS)
+    {
+        max_threads = CUTEST_BENCH_MAX_THREADS;
+    }
 
+    cutest_porting_cfprintf(g_test_ctx.out, CUTEST_COLOR_DEFAULT, "[ SCALING  ]");
+    cutest_porting_cfprintf(g_test_ctx.out, CUTEST_COLOR_DEFAULT,
+        " %8s %15s %9s %11s\n", "threads", "ops/s", "speedup", "efficiency");
+
+    unsigned long p = 1;
     for (;;)
     {
-        const char* p = cutest_porting_strchr(str, '@');
-        if (p == NULL)
+        unsigned long iterations;
+        double elapsed = _cutest_bench_measure(info->test_case, p, &iterations);
+        double throughput = (double)p * (double)iterations * 1000000000.0 / elapsed;
+
+        if (num == 0)
         {
-            ret += cutest_porting_cfprintf(g_test_ctx.out, color, "%s", str);
-            return ret;
+            base_throughput = throughput;
         }
 
-        ret += cutest_porting_cfprintf(g_test_ctx.out, color, "%.*s",
-            (int)(p - str), str);
+        threads[num] = p;
+        speedup[num] = throughput / base_throughput;
 
-        const char ch = p[1];
-        str = p + 2;
+        cutest_porting_cfprintf(g_test_ctx.out, CUTEST_COLOR_DEFAULT, "[ SCALING  ]");
+        cutest_porting_cfprintf(g_test_ctx.out, CUTEST_COLOR_DEFAULT,
+            " %8lu %15.2f %9.3f %10.1f%%",
+            p, throughput, speedup[num], speedup[num] * 100.0 / (double)p);
+        _cutest_bench_print_throughput(throughput);
+        cutest_porting_cfprintf(g_test_ctx.out, CUTEST_COLOR_DEFAULT, "\n");
+        num++;
 
-        switch (ch)
+        if (p >= max_threads)
         {
-        case '@':
-            ret += cutest_porting_cfprintf(g_test_ctx.out, color, "@");
-            break;
-        case 'D':
-            color = 0;
-            break;
-        case 'R':
-            color = CUTEST_COLOR_RED;
-            break;
-        case 'G':
-            color = CUTEST_COLOR_GREEN;
-            break;
-        case 'Y':
-            color = CUTEST_COLOR_YELLOW;
-            break;
-        default:
-            --str;
             break;
         }
+        p = p * 2 < max_threads ? p * 2 : max_threads;
     }
-}
 
-static void _cutest_hook_before_fixture_setup(cutest_case_t* test_case)
-{
-    if (g_test_ctx.hook == NULL || g_test_ctx.hook->before_setup == NULL)
+    cutest_porting_cfprintf(g_test_ctx.out, CUTEST_COLOR_DEFAULT, "[ SCALING  ]");
+    cutest_porting_cfprintf(g_test_ctx.out, CUTEST_COLOR_DEFAULT,
+        " amdahl serial fraction: %.4f\n", _cutest_bench_fit_amdahl(threads, speedup, num));
+
+    /* Latency is recorded at the largest thread count, where contention shows most. */
+#if CUTEST_HAVE_THREADS
+    if (max_threads > 1)
     {
+        _cutest_bench_run_latency_threads(info, max_threads);
         return;
     }
-    g_test_ctx.hook->before_setup(test_case->info.fixture_name);
+#endif
+    _cutest_bench_run_latency(info);
 }
 
-static void _cutest_hook_after_fixture_setup(cutest_case_t* test_case, int ret)
+/**
+ * @brief Find the line starts with \p key in \p buf, and get its value.
+ * @param[in] buf   Content like `key : value\n`, will be modified.
+ * @param[in] key   Key.
+ * @return          Value, or NULL if not found.
+ */
+static const char* _cutest_bench_env_find(char* buf, const char* key)
 {
-    if (g_test_ctx.hook == NULL || g_test_ctx.hook->after_setup == NULL)
+    unsigned long key_len = cutest_porting_strlen(key);
+    char* line = buf;
+
+    while (*line != '\0')
     {
-        return;
+        char* end = cutest_porting_strchrnul(line, '\n');
+        if (cutest_porting_strncmp(line, key, key_len) == 0)
+        {
+            char* val = cutest_porting_strchr(line, ':');
+            if (val == NULL || val > end)
+            {
+                return NULL;
+            }
+            for (val++; *val == ' ' || *val == '\t'; val++)
+            {
+            }
+            *end = '\0';
+            return val;
+        }
+        line = *end == '\0' ? end : end + 1;
     }
-    g_test_ctx.hook->after_setup(test_case->info.fixture_name, ret);
+
+    return NULL;
 }
 
-static void _cutest_run_case_set_jmp(cutest_porting_jmpbuf_t* buf,
-                                     cutest_porting_longjmp_fn fn_longjmp)
+/**
+ * @brief Read first line of file \p path.
+ * @return The line, or NULL if failure.
+ */
+static const char* _cutest_bench_env_read_line(const char* path, char* buf, unsigned long size)
 {
-    g_test_ctx.jmp.addr = buf;
-    g_test_ctx.jmp.func = fn_longjmp;
+    if (cutest_read_file(path, buf, size) <= 0)
+    {
+        return NULL;
+    }
+    *cutest_porting_strchrnul(buf, '\n') = '\0';
+    return buf;
 }
 
-static void _cutest_fixture_run_setup_jmp(cutest_porting_jmpbuf_t* buf,
-    cutest_porting_longjmp_fn fn_longjmp, int val, void* data)
+/**
+ * @brief Parse decimal like `1.25`.
+ */
+static double _cutest_bench_env_parse_double(const char* str)
 {
-    fixture_run_helper_t* helper = data;
-    test_case_info_t* info = helper->info;
-
-    _cutest_run_case_set_jmp(buf, fn_longjmp);
-
-    if (val != 0)
+    double val = 0, scale = 1;
+    for (; cutest_porting_isdigit(*str); str++)
     {
-        SET_MASK(info->test_case->data.mask, val);
-        goto after_setup;
+        val = val * 10 + (*str - '0');
     }
-
-    _cutest_hook_before_fixture_setup(info->test_case);
-    info->test_case->stage.setup();
-
-after_setup:
-    _cutest_hook_after_fixture_setup(info->test_case, val);
-    helper->ret = val;
+    if (*str == '.')
+    {
+        for (str++; cutest_porting_isdigit(*str); str++)
+        {
+            scale /= 10;
+            val += (*str - '0') * scale;
+        }
+    }
+    return val;
 }
 
 /**
- * @brief Run setup stage.
- * @param[in] test_case The test case to run.
- * @return              0 if success, otherwise failure.
+ * @brief Print CPU model, scaling governor, turbo and load average, and warn
+ *   if any of them may make benchmark results noisy.
  */
-static int _cutest_fixture_run_setup(test_case_info_t* info)
+static void _cutest_bench_show_env(void)
 {
-    if (info->test_case->stage.setup == NULL)
+    static char buf[4096];
+    static char path[CUTEST_PATH_MAX];
+    char cpu_str[20];
+    const char* val;
+
+    unsigned long ncpu = cutest_cpu_count();
+    unsigned long cpu = g_test_ctx.bench.pin ? g_test_ctx.bench.cpu : 0;
+
+    if (cutest_read_file("/proc/cpuinfo", buf, sizeof(buf)) > 0
+        && (val = _cutest_bench_env_find(buf, "model name")) != NULL)
     {
-        return 0;
+        cutest_porting_fprintf(g_test_ctx.out, "[ ENV      ] cpu: %s, %lu online\n", val, ncpu);
     }
 
-    fixture_run_helper_t helper = { info, 0 };
-    cutest_porting_setjmp(_cutest_fixture_run_setup_jmp, &helper);
-    return helper.ret;
-}
+    char* pos = _cutest_path_append(path, path, "/sys/devices/system/cpu/cpu");
+    pos = _cutest_path_append(path, pos, cutest_porting_ultoa(cpu_str, cpu));
+    pos = _cutest_path_append(path, pos, "/cpufreq/scaling_governor");
+    if (pos != NULL && (val = _cutest_bench_env_read_line(path, buf, sizeof(buf))) != NULL)
+    {
+        cutest_porting_fprintf(g_test_ctx.out, "[ ENV      ] scaling governor: %s\n", val);
+        if (cutest_porting_strcmp(val, "performance") != 0)
+        {
+            _cutest_warning("scaling governor of cpu%lu is `%s`, not `performance`.", cpu, val);
+        }
+    }
 
-static void _cutest_hook_before_test(test_case_info_t* info)
-{
-    cutest_case_t* test_case = info->test_case;
-    if (g_test_ctx.hook == NULL || g_test_ctx.hook->before_test == NULL)
+    int turbo = -1;
+    if ((val = _cutest_bench_env_read_line("/sys/devices/system/cpu/intel_pstate/no_turbo", buf, sizeof(buf))) != NULL)
     {
-        return;
+        turbo = cutest_porting_strcmp(val, "0") == 0;
+    }
+    else if ((val = _cutest_bench_env_read_line("/sys/devices/system/cpu/cpufreq/boost", buf, sizeof(buf))) != NULL)
+    {
+        turbo = cutest_porting_strcmp(val, "1") == 0;
+    }
+    if (turbo >= 0)
+    {
+        cutest_porting_fprintf(g_test_ctx.out, "[ ENV      ] turbo: %s\n", turbo ? "on" : "off");
+        if (turbo)
+        {
+            _cutest_warning("turbo is enabled, CPU frequency may vary between runs.");
+        }
     }
 
-    unsigned long fixture_sz = cutest_porting_strlen(test_case->info.fixture_name);
-    g_test_ctx.hook->before_test(test_case->info.fixture_name, info->fmt_name + fixture_sz);
+    if ((val = _cutest_bench_env_read_line("/proc/loadavg", buf, sizeof(buf))) != NULL)
+    {
+        double load = _cutest_bench_env_parse_double(val);
+        cutest_porting_fprintf(g_test_ctx.out, "[ ENV      ] load average: %.2f\n", load);
+        if (load > (double)ncpu / 2)
+        {
+            _cutest_warning("load average %.2f is high for %lu CPUs, system is busy.", load, ncpu);
+        }
+    }
 }
 
-static void _cutest_hook_after_test(test_case_info_t* info, int ret)
+/**
+ * @brief Run benchmark body for `--test_bench_warmup` milliseconds.
+ */
+static void _cutest_bench_warmup(cutest_case_t* test_case)
 {
-    cutest_case_t* test_case = info->test_case;
-    if (g_test_ctx.hook == NULL || g_test_ctx.hook->after_test == NULL)
+    cutest_porting_timespec_t tv_beg, tv_end, tv_diff;
+    double warmup = (double)g_test_ctx.bench.warmup * 1000000.0;
+
+    if (warmup == 0)
     {
         return;
     }
 
-    unsigned long fixture_sz = cutest_porting_strlen(test_case->info.fixture_name);
-    g_test_ctx.hook->after_test(test_case->info.fixture_name, info->fmt_name + fixture_sz, ret);
+    cutest_porting_clock_gettime(&tv_beg);
+    do
+    {
+        test_case->stage.body(NULL, 0);
+        cutest_porting_clock_gettime(&tv_end);
+        cutest_timestamp_dif(&tv_beg, &tv_end, &tv_diff);
+    } while (cutest_timestamp_ns(&tv_diff) < warmup);
 }
 
-static void _cutest_hook_before_teardown(cutest_case_t* test_case)
+static void _cutest_bench_run(test_case_info_t* info)
 {
-    if (g_test_ctx.hook == NULL || g_test_ctx.hook->before_teardown == NULL)
+    cutest_affinity_t affinity;
+    int pinned = 0;
+
+    g_test_ctx.bench.bytes = 0;
+    g_test_ctx.bench.items = 0;
+
+    if (!g_test_ctx.bench.env_shown)
     {
-        return;
+        g_test_ctx.bench.env_shown = 1;
+        _cutest_bench_show_env();
     }
 
-    g_test_ctx.hook->before_teardown(test_case->info.fixture_name);
-}
+    /* Multi-threaded benchmarks need all CPUs. */
+    if (g_test_ctx.bench.pin && info->test_case->bench.type != CUTEST_BENCH_THREADED)
+    {
+        if (cutest_affinity_pin(&affinity, g_test_ctx.bench.cpu) == 0)
+        {
+            pinned = 1;
+        }
+        else
+        {
+            _cutest_warning("cannot pin to cpu%lu.", g_test_ctx.bench.cpu);
+        }
+    }
 
-static void _cutest_hook_after_teardown(cutest_case_t* test_case, int ret)
-{
-    if (g_test_ctx.hook == NULL || g_test_ctx.hook->after_teardown == NULL)
+    _cutest_bench_warmup(info->test_case);
+
+    switch (info->test_case->bench.type)
     {
-        return;
+    case CUTEST_BENCH_THREADED:
+        _cutest_bench_run_scaling(info);
+        break;
+
+    case CUTEST_BENCH_LOAD:
+        _cutest_bench_run_load(info);
+        break;
+
+    default:
+        _cutest_bench_run_single(info);
+        break;
     }
-    g_test_ctx.hook->after_teardown(test_case->info.fixture_name, ret);
-}
 
-static void _cutest_hook_before_all_test(int argc, char* argv[])
-{
-    if (g_test_ctx.hook == NULL || g_test_ctx.hook->before_all_test == NULL)
+    if (pinned)
     {
-        return;
+        cutest_affinity_restore(&affinity);
     }
-    g_test_ctx.hook->before_all_test(argc, argv);
 }
 
-static void _cutest_hook_after_all_test(void)
+/**
+ * @brief Record location of failed assertion for #cutest_result_t.
+ */
+static void _cutest_record_failure(const char* file, int line)
 {
-    if (g_test_ctx.hook == NULL || g_test_ctx.hook->after_all_test == NULL)
+    if (g_test_ctx.runtime.tid == cutest_porting_gettid())
     {
-        return;
+        g_test_ctx.runtime.failure_file = file;
+        g_test_ctx.runtime.failure_line = line;
     }
-    g_test_ctx.hook->after_all_test();
 }
 
-static void _cutest_fixture_run_teardown_jmp(cutest_porting_jmpbuf_t* buf,
-    cutest_porting_longjmp_fn fn_longjmp, int val, void* data)
+/**
+ * @brief Time budget with tolerance.
+ */
+static double _cutest_budget_limit(double budget_ns)
+{
+    return budget_ns * (100.0 + (double)g_test_ctx.budget.tolerance) / 100.0;
+}
+
+static void _cutest_raise_failure(void)
 {
-    test_case_info_t* info = data;
-
-    _cutest_run_case_set_jmp(buf, fn_longjmp);
-
-    if (val != 0)
+    if (g_test_ctx.mask.break_on_failure)
     {
-        SET_MASK(info->test_case->data.mask, val);
-        goto after_teardown;
+        TEST_DEBUGBREAK;
     }
-
-    _cutest_hook_before_teardown(info->test_case);
-    info->test_case->stage.teardown();
-
-after_teardown:
-    _cutest_hook_after_teardown(info->test_case, val);
+    cutest_internal_assert_failure();
 }
 
-static void _cutest_fixture_run_teardown(test_case_info_t* info)
+/**
+ * @brief Leave no-allocation scope, fail the test if anything is allocated in it.
+ */
+static void _cutest_alloc_scope_check(const char* file, int line)
 {
-    if (info->test_case->stage.teardown == NULL)
+    test_alloc_scope_t scope;
+    if (!cutest_alloc_scope_leave(&scope) || scope.violations == 0)
     {
         return;
     }
 
-    cutest_porting_setjmp(_cutest_fixture_run_teardown_jmp, info);
+    _cutest_record_failure(file, line);
+    cutest_porting_fprintf(g_test_ctx.out,
+        "%s:%d:failure:\n"
+        "            expected: no allocation\n"
+        "              actual: %lu allocation%s, first of %lu bytes at:\n",
+        file, line, scope.violations, scope.violations > 1 ? "s" : "",
+        (unsigned long)scope.size);
+#if defined(CUTEST_ALLOC_TRACKER)
+    int i;
+    for (i = ALLOC_SCOPE_SKIP_FRAMES; i < scope.depth_frames; i++)
+    {
+        cutest_porting_fprintf(g_test_ctx.out, "                #%d ", i - ALLOC_SCOPE_SKIP_FRAMES);
+        _cutest_write_symbol(g_test_ctx.out, scope.frames[i]);
+        cutest_porting_fprintf(g_test_ctx.out, "\n");
+    }
+#endif
+    _cutest_raise_failure();
 }
 
-static void _cutest_finishlize(test_case_info_t* info)
+/**
+ * @brief Run body of #TEST_NOALLOC().
+ */
+static void _cutest_noalloc_run(test_case_info_t* info)
 {
-    cutest_porting_clock_gettime(&info->tv_case_end);
+    cutest_case_t* test_case = info->test_case;
 
-    cutest_porting_timespec_t tv_diff;
-    cutest_timestamp_dif(&info->tv_case_beg, &info->tv_case_end, &tv_diff);
+    cutest_no_alloc_begin();
+    test_case->stage.body(NULL, 0);
+    _cutest_alloc_scope_check(test_case->info.file, test_case->info.line);
+}
 
-    if (HAS_MASK(info->test_case->data.mask, MASK_FAILURE))
-    {
-        g_test_ctx.counter.result.failed++;
-        cutest_porting_cfprintf(g_test_ctx.out, CUTEST_COLOR_RED, "[  FAILED  ]");
-    }
-    else if (HAS_MASK(info->test_case->data.mask, MASK_SKIPPED))
-    {
-        g_test_ctx.counter.result.skipped++;
-        cutest_porting_cfprintf(g_test_ctx.out, CUTEST_COLOR_YELLOW, "[   SKIP   ]");
-    }
-    else
-    {
-        g_test_ctx.counter.result.success++;
-        cutest_porting_cfprintf(g_test_ctx.out, CUTEST_COLOR_GREEN, "[       OK ]");
-    }
+/**
+ * @brief Run body of #TEST_BUDGET(), repeat to confirm if over budget.
+ */
+static void _cutest_budget_run(test_case_info_t* info)
+{
+    cutest_case_t* test_case = info->test_case;
+    double limit = _cutest_budget_limit(test_case->bench.budget * 1000000.0);
+    double best = 0;
+    unsigned long attempt;
 
-    cutest_porting_cfprintf(g_test_ctx.out, CUTEST_COLOR_DEFAULT, " %s", info->fmt_name);
-    if (!g_test_ctx.mask.no_print_time)
+    for (attempt = 1;; attempt++)
     {
-        unsigned long take_time = (unsigned long)(tv_diff.tv_sec * 1000 + tv_diff.tv_nsec / 1000000);
-        cutest_porting_cfprintf(g_test_ctx.out, CUTEST_COLOR_DEFAULT, " (%lu ms)", take_time);
+        cutest_porting_timespec_t tv_beg, tv_end, tv_diff;
+        cutest_porting_clock_gettime(&tv_beg);
+        test_case->stage.body(NULL, 0);
+        cutest_porting_clock_gettime(&tv_end);
+
+        cutest_timestamp_dif(&tv_beg, &tv_end, &tv_diff);
+        double elapsed = cutest_timestamp_ns(&tv_diff);
+        if (attempt == 1 || elapsed < best)
+        {
+            best = elapsed;
+        }
+        if (elapsed < limit)
+        {
+            return;
+        }
+        if (attempt > g_test_ctx.budget.retry)
+        {
+            break;
+        }
     }
-    cutest_porting_cfprintf(g_test_ctx.out, CUTEST_COLOR_DEFAULT, "\n");
+
+    cutest_porting_fprintf(g_test_ctx.out,
+        "%s:failure:\n"
+        "            expected: body < %lu ms (+%lu%%)\n"
+        "              actual: %.3f ms, best of %lu attempts\n",
+        info->fmt_name, test_case->bench.budget, g_test_ctx.budget.tolerance,
+        best / 1000000.0, attempt);
+    _cutest_raise_failure();
 }
 
 static void _cutest_run_case_normal_body_jmp(cutest_porting_jmpbuf_t* buf,
@@ -2348,7 +7060,22 @@ static void _cutest_run_case_normal_body_jmp(cutest_porting_jmpbuf_t* buf,
     }
 
     _cutest_hook_before_test(info);
-    info->test_case->stage.body(NULL, 0);
+    if (info->test_case->bench.type != CUTEST_BENCH_NONE)
+    {
+        _cutest_bench_run(info);
+    }
+    else if (info->test_case->bench.budget != 0)
+    {
+        _cutest_budget_run(info);
+    }
+    else if (info->test_case->bench.noalloc)
+    {
+        _cutest_noalloc_run(info);
+    }
+    else
+    {
+        info->test_case->stage.body(NULL, 0);
+    }
 
 after_body:
     _cutest_hook_after_test(info, val);
@@ -2357,8 +7084,13 @@ after_body:
 
 static int _cutest_run_case_normal_body(test_case_info_t* info)
 {
+    cutest_porting_timespec_t tv_beg;
+    cutest_porting_clock_gettime(&tv_beg);
+
     test_case_helper_t helper = { info, 0 };
     cutest_porting_setjmp(_cutest_run_case_normal_body_jmp, &helper);
+
+    info->ns_body = _cutest_stage_finish("body", &tv_beg);
     return helper.ret;
 }
 
@@ -2384,7 +7116,26 @@ static int _cutest_run_prepare(test_case_info_t* info)
     cutest_porting_cfprintf(g_test_ctx.out, CUTEST_COLOR_GREEN, "[ RUN      ]");
     cutest_porting_cfprintf(g_test_ctx.out, CUTEST_COLOR_DEFAULT, " %s\n", info->fmt_name);
 
+    g_test_ctx.runtime.assertions = 0;
+    g_test_ctx.runtime.failure_file = NULL;
+    g_test_ctx.runtime.failure_line = 0;
+    _cutest_hook_ex_before_test(info);
+
     /* record start time */
+    info->ns_setup = 0;
+    info->ns_body = 0;
+    info->ns_teardown = 0;
+    s_timer_table.size = 0;
+    info->has_cpu = cutest_cputime_get(&info->cpu_beg) == 0;
+    info->has_alloc = cutest_alloc_begin(&info->alloc_beg) == 0;
+    info->has_sweep = 0;
+    if (g_test_ctx.mask.check_leaks != 0)
+    {
+        _cutest_proc_snapshot(&s_proc_snapshot);
+    }
+    cutest_alloc_scope_reset();
+    g_test_ctx.runtime.has_usage = cutest_rusage_get(&g_test_ctx.runtime.usage_beg) == 0;
+    g_test_ctx.runtime.has_io = _cutest_io_begin() == 0;
     cutest_porting_clock_gettime(&info->tv_case_beg);
     return 0;
 }
@@ -2473,10 +7224,15 @@ after_body:
 
 static void _cutest_run_case_parameterized_body(test_case_info_t* info)
 {
+    cutest_porting_timespec_t tv_beg;
+    cutest_porting_clock_gettime(&tv_beg);
+
     _cutest_hook_before_test(info);
 
     test_run_parameterized_helper_t helper = { info };
     cutest_porting_setjmp(_cutest_run_case_parameterized_body_jmp, &helper);
+
+    info->ns_body = _cutest_stage_finish("body", &tv_beg);
 }
 
 static void _cutest_run_case_parameterized_idx(test_case_info_t* info)
@@ -2542,6 +7298,8 @@ static void _cutest_run_case_parameterized(cutest_case_t* test_case)
 static void _cutest_run_case(cutest_case_t* test_case)
 {
     test_case->data.mask = 0;
+    test_case->data.elapsed = 0;
+    cutest_porting_memset(&test_case->data.usage, 0, sizeof(test_case->data.usage));
 
     if (test_case->parameterized.type_name != NULL)
     {
@@ -2561,6 +7319,7 @@ static void _cutest_reset_all_test_mask(void)
     {
         cutest_case_t* test_case = CONTAINER_OF(it, cutest_case_t, node);
         test_case->data.mask = 0;
+        test_case->data.elapsed = 0;
     }
 }
 
@@ -2716,135 +7475,330 @@ static unsigned long _cutest_parameterized_parser_peek_struct(const char* str)
         }
     }
 
-    CUTEST_PORTING_ASSERT_P(str[pos] != '\0', "unbalanced struct: %s", str);
+    CUTEST_PORTING_ASSERT_P(str[pos] != '\0', "unbalanced struct: %s", str);
+    return 0;
+}
+
+/**
+ * @brief Parser static initialize code into sequence of tokens.
+ * @param[in] code  Initialize code.
+ * @param[in] idx   Index of element we want.
+ * @param[out] len  The length of element code in bytes.
+ * @return          The position of element code.
+ */
+static const char* _cutest_parameterized_parser(const char* code, unsigned long idx, int* len)
+{
+    const char* str = code;
+    unsigned long pos = 0;
+
+    for (; code[pos] != '\0'; pos++)
+    {
+        char c = code[pos];
+        switch (c)
+        {
+        case '"':
+            pos += _cutest_parameterized_parser_peek_string(code + pos) - 1;
+            break;
+
+        case ' ':
+            break;
+
+        case '{':
+            pos += _cutest_parameterized_parser_peek_struct(code + pos) - 1;
+            break;
+
+        case ',':
+            if (idx == 0)
+            {
+                goto finish;
+            }
+            else
+            {
+                idx--;
+                str = code + pos + 1;
+                while (*str == ' ')
+                {
+                    str++;
+                }
+            }
+            break;
+
+        default:
+            break;
+        }
+    }
+
+finish:
+    *len = (int)(code + pos - str);
+    return str;
+}
+
+static void _cutest_list_tests_print_name(const cutest_case_t* test_case)
+{
+    const char* case_name = test_case->info.case_name;
+
+    if (test_case->parameterized.type_name == NULL)
+    {
+        cutest_porting_fprintf(g_test_ctx.out, "  %s\n", case_name);
+        return;
+    }
+
+    const char* type_name = test_case->parameterized.type_name;
+    unsigned long parameterized_idx = test_case->parameterized.param_idx;
+
+    int len = 0;;
+    const char* str = _cutest_parameterized_parser(test_case->parameterized.test_data_cstr, parameterized_idx, &len);
+
+    cutest_porting_fprintf(g_test_ctx.out, "  %s/%u  # <%s> %.*s\n",
+        case_name, (unsigned)parameterized_idx, type_name, len, str);
+}
+
+static void _cutest_list_tests(void)
+{
+    const char* last_class_name = "";
+
+    cutest_map_node_t* it = cutest_map_begin(&g_test_ctx.case_table);
+    for (; it != NULL; it = cutest_map_next(it))
+    {
+        cutest_case_t* test_case = CONTAINER_OF(it, cutest_case_t, node);
+
+        /* some compiler will make same string with different address */
+        if (last_class_name != test_case->info.fixture_name
+            && cutest_porting_strcmp(last_class_name, test_case->info.fixture_name) != 0)
+        {
+            last_class_name = test_case->info.fixture_name;
+            cutest_porting_fprintf(g_test_ctx.out, "%s.\n", last_class_name);
+        }
+        _cutest_list_tests_print_name(test_case);
+    }
+}
+
+static void _cutest_list_types(void)
+{
+    cutest_map_node_t* it = cutest_map_begin(&g_test_ctx.type_table);
+    for (; it != NULL; it = cutest_map_next(it))
+    {
+        cutest_type_info_t* type_info = CONTAINER_OF(it, cutest_type_info_t, node);
+        cutest_porting_fprintf(g_test_ctx.out, "%s\n", type_info->type_name);
+    }
+}
+
+static int _cutest_setup_arg_repeat(const char* str)
+{
+    unsigned long repeat;
+    if (cutest_porting_atoul(str, &repeat) != 0)
+    {
+        return 1 << 8 | 1;
+    }
+
+    g_test_ctx.counter.repeat.repeat = repeat;
+    return 0;
+}
+
+static int _cutest_setup_arg_bench_min_time(const char* str)
+{
+    unsigned long val;
+    if (cutest_porting_atoul(str, &val) != 0)
+    {
+        return 1 << 8 | 1;
+    }
+
+    g_test_ctx.bench.min_time = val;
+    return 0;
+}
+
+static int _cutest_setup_arg_bench_threads(const char* str)
+{
+    unsigned long val;
+    if (cutest_porting_atoul(str, &val) != 0)
+    {
+        return 1 << 8 | 1;
+    }
+
+    g_test_ctx.bench.max_threads = val;
+    return 0;
+}
+
+static int _cutest_setup_arg_bench_hgrm(const char* str)
+{
+    g_test_ctx.bench.hgrm = str;
+    return 0;
+}
+
+static int _cutest_setup_arg_bench_warmup(const char* str)
+{
+    unsigned long val;
+    if (cutest_porting_atoul(str, &val) != 0)
+    {
+        return 1 << 8 | 1;
+    }
+
+    g_test_ctx.bench.warmup = val;
+    return 0;
+}
+
+static int _cutest_setup_arg_bench_cpu(const char* str)
+{
+    unsigned long val;
+    if (cutest_porting_atoul(str, &val) != 0)
+    {
+        return 1 << 8 | 1;
+    }
+
+    g_test_ctx.bench.cpu = val;
+    g_test_ctx.bench.pin = 1;
+    return 0;
+}
+
+static int _cutest_setup_arg_budget_tolerance(const char* str)
+{
+    unsigned long val;
+    if (cutest_porting_atoul(str, &val) != 0)
+    {
+        return 1 << 8 | 1;
+    }
+
+    g_test_ctx.budget.tolerance = val;
+    return 0;
+}
+
+static int _cutest_setup_arg_budget_retry(const char* str)
+{
+    unsigned long val;
+    if (cutest_porting_atoul(str, &val) != 0)
+    {
+        return 1 << 8 | 1;
+    }
+
+    g_test_ctx.budget.retry = val;
     return 0;
 }
 
-/**
- * @brief Parser static initialize code into sequence of tokens.
- * @param[in] code  Initialize code.
- * @param[in] idx   Index of element we want.
- * @param[out] len  The length of element code in bytes.
- * @return          The position of element code.
- */
-static const char* _cutest_parameterized_parser(const char* code, unsigned long idx, int* len)
+static int _cutest_setup_arg_max_io_bytes(const char* str)
 {
-    const char* str = code;
-    unsigned long pos = 0;
-
-    for (; code[pos] != '\0'; pos++)
+    unsigned long val;
+    if (cutest_porting_atoul(str, &val) != 0)
     {
-        char c = code[pos];
-        switch (c)
-        {
-        case '"':
-            pos += _cutest_parameterized_parser_peek_string(code + pos) - 1;
-            break;
+        return 1 << 8 | 1;
+    }
 
-        case ' ':
-            break;
+    g_test_ctx.budget.max_io_bytes = val;
+    return 0;
+}
 
-        case '{':
-            pos += _cutest_parameterized_parser_peek_struct(code + pos) - 1;
-            break;
+static int _cutest_setup_arg_arena_size(const char* str)
+{
+    unsigned long val;
+    if (cutest_porting_atoul(str, &val) != 0 || val == 0 || val > ARENA_MAX_SIZE)
+    {
+        return 1 << 8 | 1;
+    }
 
-        case ',':
-            if (idx == 0)
-            {
-                goto finish;
-            }
-            else
-            {
-                idx--;
-                str = code + pos + 1;
-                while (*str == ' ')
-                {
-                    str++;
-                }
-            }
-            break;
+    g_test_ctx.arena.size = val;
+    return 0;
+}
 
-        default:
-            break;
-        }
+static int _cutest_setup_arg_alloc_leaks(const char* str)
+{
+    unsigned long val;
+    if (cutest_porting_atoul(str, &val) != 0 || val > 2)
+    {
+        return 1 << 8 | 1;
     }
 
-finish:
-    *len = (int)(code + pos - str);
-    return str;
+    g_test_ctx.mask.alloc_leaks = val;
+    return 0;
 }
 
-static void _cutest_list_tests_print_name(const cutest_case_t* test_case)
+static int _cutest_setup_arg_check_leaks(const char* str)
 {
-    const char* case_name = test_case->info.case_name;
-
-    if (test_case->parameterized.type_name == NULL)
+    unsigned long val;
+    if (cutest_porting_atoul(str, &val) != 0 || val > 2)
     {
-        cutest_porting_fprintf(g_test_ctx.out, "  %s\n", case_name);
-        return;
+        return 1 << 8 | 1;
     }
 
-    const char* type_name = test_case->parameterized.type_name;
-    unsigned long parameterized_idx = test_case->parameterized.param_idx;
+#if defined(__linux__)
+    g_test_ctx.mask.check_leaks = val;
+#else
+    if (val != 0)
+    {
+        _cutest_warning("--test_check_leaks is only supported on Linux, ignored.");
+    }
+#endif
+    return 0;
+}
 
-    int len = 0;;
-    const char* str = _cutest_parameterized_parser(test_case->parameterized.test_data_cstr, parameterized_idx, &len);
+static int _cutest_setup_arg_print_time(const char* str)
+{
+    unsigned long val = 1;
+    if (cutest_porting_atoul(str, &val) != 0)
+    {
+        return 1 << 8 | 1;
+    }
 
-    cutest_porting_fprintf(g_test_ctx.out, "  %s/%u  # <%s> %.*s\n",
-        case_name, (unsigned)parameterized_idx, type_name, len, str);
+    g_test_ctx.mask.no_print_time = !val;
+    g_test_ctx.mask.print_stage_time = val >= 2;
+    return 0;
 }
 
-static void _cutest_list_tests(void)
+static int _cutest_setup_arg_report_slowest(const char* str)
 {
-    const char* last_class_name = "";
-
-    cutest_map_node_t* it = cutest_map_begin(&g_test_ctx.case_table);
-    for (; it != NULL; it = cutest_map_next(it))
+    unsigned long val;
+    if (cutest_porting_atoul(str, &val) != 0)
     {
-        cutest_case_t* test_case = CONTAINER_OF(it, cutest_case_t, node);
-
-        /* some compiler will make same string with different address */
-        if (last_class_name != test_case->info.fixture_name
-            && cutest_porting_strcmp(last_class_name, test_case->info.fixture_name) != 0)
-        {
-            last_class_name = test_case->info.fixture_name;
-            cutest_porting_fprintf(g_test_ctx.out, "%s.\n", last_class_name);
-        }
-        _cutest_list_tests_print_name(test_case);
+        return 1 << 8 | 1;
     }
+
+    g_test_ctx.report.slowest = val;
+    return 0;
 }
 
-static void _cutest_list_types(void)
+static int _cutest_setup_arg_report_variance(const char* str)
 {
-    cutest_map_node_t* it = cutest_map_begin(&g_test_ctx.type_table);
-    for (; it != NULL; it = cutest_map_next(it))
+    unsigned long val;
+    if (cutest_porting_atoul(str, &val) != 0)
     {
-        cutest_type_info_t* type_info = CONTAINER_OF(it, cutest_type_info_t, node);
-        cutest_porting_fprintf(g_test_ctx.out, "%s\n", type_info->type_name);
+        return 1 << 8 | 1;
     }
+
+    g_test_ctx.report.variance = val;
+    return 0;
 }
 
-static int _cutest_setup_arg_repeat(const char* str)
+static int _cutest_setup_arg_report_waiting(const char* str)
 {
-    unsigned long repeat;
-    if (cutest_porting_atoul(str, &repeat) != 0)
+    unsigned long val;
+    if (cutest_porting_atoul(str, &val) != 0 || val > 100)
     {
         return 1 << 8 | 1;
     }
 
-    g_test_ctx.counter.repeat.repeat = repeat;
+    g_test_ctx.report.waiting = val;
     return 0;
 }
 
-static int _cutest_setup_arg_print_time(const char* str)
+static int _cutest_setup_arg_profile(const char* str)
 {
-    unsigned long val = 1;
-    if (cutest_porting_atoul(str, &val) != 0)
+    g_test_ctx.profile.path = str;
+    return 0;
+}
+
+static int _cutest_setup_arg_profile_hz(const char* str)
+{
+    unsigned long val;
+    if (cutest_porting_atoul(str, &val) != 0 || val == 0 || val > 1000000)
     {
         return 1 << 8 | 1;
     }
 
-    g_test_ctx.mask.no_print_time = !val;
+    g_test_ctx.profile.hz = val;
+    return 0;
+}
+
+static int _cutest_setup_arg_trace(const char* str)
+{
+    g_test_ctx.trace.path = str;
     return 0;
 }
 
@@ -2897,12 +7851,255 @@ static void _cutest_undo_shuffle_cases(void)
         cutest_case_t* tc = CONTAINER_OF(it, cutest_case_t, node);
         if (tc->data.randkey == 0)
         {
-            break;
+            break;
+        }
+
+        cutest_map_erase(&g_test_ctx.case_table, it);
+        tc->data.randkey = 0;
+        cutest_map_insert(&g_test_ctx.case_table, it);
+    }
+}
+
+typedef struct test_slowest_item
+{
+    const cutest_case_t*        test_case;      /**< Test case, or the first case of fixture. */
+    unsigned long               num;            /**< The number of cases. */
+    double                      elapsed;        /**< Elapsed nanoseconds. */
+} test_slowest_item_t;
+
+typedef struct test_slowest_heap
+{
+    test_slowest_item_t         items[CUTEST_REPORT_SLOWEST_MAX];
+    unsigned long               size;           /**< The number of items. */
+    unsigned long               capacity;       /**< The maximum number of items. */
+} test_slowest_heap_t;
+
+/**
+ * @brief The slowest cases and fixtures. Min-heaps, so the fastest one is
+ *   replaced when a slower one comes.
+ */
+static test_slowest_heap_t s_slowest_cases;
+static test_slowest_heap_t s_slowest_fixtures;
+
+static void _cutest_slowest_swap(test_slowest_heap_t* heap, unsigned long i, unsigned long j)
+{
+    test_slowest_item_t tmp = heap->items[i];
+    heap->items[i] = heap->items[j];
+    heap->items[j] = tmp;
+}
+
+static void _cutest_slowest_sift_down(test_slowest_heap_t* heap, unsigned long i)
+{
+    for (;;)
+    {
+        unsigned long l = 2 * i + 1, r = l + 1, min = i;
+        if (l < heap->size && heap->items[l].elapsed < heap->items[min].elapsed)
+        {
+            min = l;
+        }
+        if (r < heap->size && heap->items[r].elapsed < heap->items[min].elapsed)
+        {
+            min = r;
+        }
+        if (min == i)
+        {
+            return;
+        }
+        _cutest_slowest_swap(heap, i, min);
+        i = min;
+    }
+}
+
+static void _cutest_slowest_push(test_slowest_heap_t* heap, const test_slowest_item_t* item)
+{
+    if (heap->size < heap->capacity)
+    {
+        unsigned long i = heap->size++;
+        heap->items[i] = *item;
+        while (i > 0 && heap->items[(i - 1) / 2].elapsed > heap->items[i].elapsed)
+        {
+            _cutest_slowest_swap(heap, i, (i - 1) / 2);
+            i = (i - 1) / 2;
+        }
+        return;
+    }
+
+    if (heap->capacity != 0 && item->elapsed > heap->items[0].elapsed)
+    {
+        heap->items[0] = *item;
+        _cutest_slowest_sift_down(heap, 0);
+    }
+}
+
+/**
+ * @brief Sort heap in descending order. The heap is not a heap anymore.
+ */
+static void _cutest_slowest_sort(test_slowest_heap_t* heap)
+{
+    unsigned long size = heap->size;
+    while (heap->size > 1)
+    {
+        _cutest_slowest_swap(heap, 0, heap->size - 1);
+        heap->size--;
+        _cutest_slowest_sift_down(heap, 0);
+    }
+    heap->size = size;
+}
+
+/**
+ * @brief Print the slowest cases and fixtures, by mean elapsed time across
+ *   iterations.
+ * @note Cases must not be shuffled, so cases of one fixture are adjacent.
+ */
+static void _cutest_show_report_slowest(void)
+{
+    char buffer[512];
+    double total = 0;
+    unsigned long i, num = 0;
+    test_slowest_item_t fixture = { NULL, 0, 0 };
+
+    s_slowest_cases.size = 0;
+    s_slowest_fixtures.size = 0;
+    s_slowest_cases.capacity = g_test_ctx.report.slowest < CUTEST_REPORT_SLOWEST_MAX ?
+        g_test_ctx.report.slowest : CUTEST_REPORT_SLOWEST_MAX;
+    s_slowest_fixtures.capacity = s_slowest_cases.capacity;
+
+    cutest_map_node_t* it = cutest_map_begin(&g_test_ctx.case_table);
+    for (; it != NULL; it = cutest_map_next(it))
+    {
+        cutest_case_t* test_case = CONTAINER_OF(it, cutest_case_t, node);
+        double elapsed = test_case->data.stat.count != 0 ? test_case->data.stat.mean : test_case->data.elapsed;
+        if (elapsed == 0)
+        {
+            continue;
+        }
+
+        test_slowest_item_t item = { test_case, 1, elapsed };
+        _cutest_slowest_push(&s_slowest_cases, &item);
+        total += item.elapsed;
+        num++;
+
+        if (fixture.test_case != NULL
+            && cutest_porting_strcmp(fixture.test_case->info.fixture_name, test_case->info.fixture_name) == 0)
+        {
+            fixture.num++;
+            fixture.elapsed += item.elapsed;
+            continue;
+        }
+        if (fixture.test_case != NULL)
+        {
+            _cutest_slowest_push(&s_slowest_fixtures, &fixture);
+        }
+        fixture = item;
+    }
+    if (fixture.test_case != NULL)
+    {
+        _cutest_slowest_push(&s_slowest_fixtures, &fixture);
+    }
+
+    if (num == 0)
+    {
+        return;
+    }
+
+    _cutest_slowest_sort(&s_slowest_cases);
+    _cutest_slowest_sort(&s_slowest_fixtures);
+
+    cutest_porting_cfprintf(g_test_ctx.out, CUTEST_COLOR_YELLOW, "[ SLOWEST  ]");
+    cutest_porting_cfprintf(g_test_ctx.out, CUTEST_COLOR_DEFAULT,
+        " %lu slowest of %lu test%s (%.3f ms total):\n",
+        s_slowest_cases.size, num, num > 1 ? "s" : "", total / 1000000.0);
+    for (i = 0; i < s_slowest_cases.size; i++)
+    {
+        const test_slowest_item_t* item = &s_slowest_cases.items[i];
+        if (item->test_case->parameterized.type_name == NULL)
+        {
+            _cutest_get_test_fmt_name_normal(buffer, sizeof(buffer), (cutest_case_t*)item->test_case);
+        }
+        else
+        {
+            _cutest_get_test_fmt_name_parameter(buffer, sizeof(buffer), (cutest_case_t*)item->test_case);
+        }
+
+        cutest_porting_cfprintf(g_test_ctx.out, CUTEST_COLOR_YELLOW, "[ SLOWEST  ]");
+        cutest_porting_cfprintf(g_test_ctx.out, CUTEST_COLOR_DEFAULT, " %12.3f ms %6.2f%%  %s\n",
+            item->elapsed / 1000000.0, item->elapsed * 100.0 / total, buffer);
+    }
+
+    cutest_porting_cfprintf(g_test_ctx.out, CUTEST_COLOR_YELLOW, "[ SLOWEST  ]");
+    cutest_porting_cfprintf(g_test_ctx.out, CUTEST_COLOR_DEFAULT, " %lu slowest fixture%s:\n",
+        s_slowest_fixtures.size, s_slowest_fixtures.size > 1 ? "s" : "");
+    for (i = 0; i < s_slowest_fixtures.size; i++)
+    {
+        const test_slowest_item_t* item = &s_slowest_fixtures.items[i];
+        cutest_porting_cfprintf(g_test_ctx.out, CUTEST_COLOR_YELLOW, "[ SLOWEST  ]");
+        cutest_porting_cfprintf(g_test_ctx.out, CUTEST_COLOR_DEFAULT, " %12.3f ms %6.2f%%  %s (%lu test%s)\n",
+            item->elapsed / 1000000.0, item->elapsed * 100.0 / total,
+            item->test_case->info.fixture_name, item->num, item->num > 1 ? "s" : "");
+    }
+}
+
+/**
+ * @brief Print tests whose elapsed time has the largest standard deviation
+ *   across iterations.
+ */
+static void _cutest_show_report_variance(void)
+{
+    char buffer[512];
+    unsigned long i, num = 0;
+
+    s_slowest_cases.size = 0;
+    s_slowest_cases.capacity = g_test_ctx.report.variance < CUTEST_REPORT_SLOWEST_MAX ?
+        g_test_ctx.report.variance : CUTEST_REPORT_SLOWEST_MAX;
+
+    cutest_map_node_t* it = cutest_map_begin(&g_test_ctx.case_table);
+    for (; it != NULL; it = cutest_map_next(it))
+    {
+        cutest_case_t* test_case = CONTAINER_OF(it, cutest_case_t, node);
+        if (test_case->data.stat.count < 2)
+        {
+            continue;
+        }
+
+        test_slowest_item_t item = { test_case, 1, _cutest_stat_stddev(test_case) };
+        _cutest_slowest_push(&s_slowest_cases, &item);
+        num++;
+    }
+
+    if (num == 0)
+    {
+        return;
+    }
+
+    _cutest_slowest_sort(&s_slowest_cases);
+
+    cutest_porting_cfprintf(g_test_ctx.out, CUTEST_COLOR_YELLOW, "[ VARIANCE ]");
+    cutest_porting_cfprintf(g_test_ctx.out, CUTEST_COLOR_DEFAULT,
+        " %lu highest-variance of %lu test%s (in milliseconds):\n",
+        s_slowest_cases.size, num, num > 1 ? "s" : "");
+    cutest_porting_cfprintf(g_test_ctx.out, CUTEST_COLOR_YELLOW, "[ VARIANCE ]");
+    cutest_porting_cfprintf(g_test_ctx.out, CUTEST_COLOR_DEFAULT,
+        " %12s %12s %12s %12s %6s  %s\n", "stddev", "mean", "min", "max", "runs", "name");
+    for (i = 0; i < s_slowest_cases.size; i++)
+    {
+        const cutest_case_t* test_case = s_slowest_cases.items[i].test_case;
+        if (test_case->parameterized.type_name == NULL)
+        {
+            _cutest_get_test_fmt_name_normal(buffer, sizeof(buffer), (cutest_case_t*)test_case);
+        }
+        else
+        {
+            _cutest_get_test_fmt_name_parameter(buffer, sizeof(buffer), (cutest_case_t*)test_case);
         }
 
-        cutest_map_erase(&g_test_ctx.case_table, it);
-        tc->data.randkey = 0;
-        cutest_map_insert(&g_test_ctx.case_table, it);
+        cutest_porting_cfprintf(g_test_ctx.out, CUTEST_COLOR_YELLOW, "[ VARIANCE ]");
+        cutest_porting_cfprintf(g_test_ctx.out, CUTEST_COLOR_DEFAULT,
+            " %12.3f %12.3f %12.3f %12.3f %6lu  %s\n",
+            s_slowest_cases.items[i].elapsed / 1000000.0,
+            test_case->data.stat.mean / 1000000.0,
+            test_case->data.stat.min / 1000000.0,
+            test_case->data.stat.max / 1000000.0,
+            test_case->data.stat.count, buffer);
     }
 }
 
@@ -3191,6 +8388,7 @@ static void _cutest_setup_once(void)
     {
         token = 1;
         _cutest_setup_type();
+        cutest_cond_init(&s_vtime.moved);
     }
 }
 
@@ -3202,6 +8400,14 @@ static void _cutest_prepare(void)
 
     g_test_ctx.runtime.tid = cutest_porting_gettid();
     g_test_ctx.counter.repeat.repeat = 1;
+    g_test_ctx.bench.min_time = BENCH_DEFAULT_MIN_TIME;
+    g_test_ctx.budget.tolerance = BUDGET_DEFAULT_TOLERANCE;
+    g_test_ctx.budget.retry = BUDGET_DEFAULT_RETRY;
+    g_test_ctx.arena.size = ARENA_DEFAULT_SIZE;
+    g_test_ctx.mask.alloc_leaks = ALLOC_DEFAULT_LEAKS;
+    g_test_ctx.profile.hz = PROFILE_DEFAULT_HZ;
+    s_vtime.now = _cutest_real_now();
+    s_vtime.threads = 0;
 }
 
 static int _cutest_setup_arg_help(void)
@@ -3240,6 +8446,40 @@ static int _cutest_setup_arg_break_on_failure(void)
     return 0;
 }
 
+static int _cutest_setup_arg_print_usage(void)
+{
+    g_test_ctx.mask.print_usage = 1;
+    return 0;
+}
+
+static int _cutest_setup_arg_virtual_time(void)
+{
+    g_test_ctx.mask.virtual_time = 1;
+    return 0;
+}
+
+static int _cutest_setup_arg_tmpdir_root(const char* str)
+{
+    g_test_ctx.tmpdir.root = str;
+    return 0;
+}
+
+static int _cutest_setup_arg_arena_huge_pages(void)
+{
+    g_test_ctx.arena.huge_pages = 1;
+    return 0;
+}
+
+static int _cutest_setup_arg_fail_alloc_sweep(void)
+{
+#if defined(CUTEST_ALLOC_TRACKER)
+    g_test_ctx.mask.fail_alloc_sweep = 1;
+#else
+    _cutest_warning("--test_fail_alloc_sweep requires CUTEST_ALLOC_TRACKER, ignored.");
+#endif
+    return 0;
+}
+
 static void _cutest_cleanup(void)
 {
     /* Reset all data. */
@@ -3257,16 +8497,19 @@ static void _cutest_cleanup(void)
  * @param[in] argc      The number of command line argument.
  * @param[in] argv      Command line argument list.
  * @param[in] hook      Global test hook.
+ * @param[in] hook_ex   Global extended test hook.
  * @param[out] b_exit   Whether need to exit.
  * @return              0 if success, otherwise failure. The lower 8 bit is the actual exit code.
  */
-static int _cutest_setup(int argc, char* argv[], FILE* out, const cutest_hook_t* hook)
+static int _cutest_setup(int argc, char* argv[], FILE* out, const cutest_hook_t* hook,
+    const cutest_hook_ex_t* hook_ex)
 {
 #define PARSER_LONGOPT_WITH_VALUE(OPT, FUNC)   \
     do {\
         int ret = -1; const char* opt = OPT;\
         unsigned optlen = cutest_porting_strlen(opt);\
-        if (cutest_porting_strncmp(argv[i], opt, optlen) == 0) {\
+        if (cutest_porting_strncmp(argv[i], opt, optlen) == 0\
+            && (argv[i][optlen] == '=' || argv[i][optlen] == '\0')) {\
             if (argv[i][optlen] == '=') {\
                 ret = FUNC(argv[i] + optlen + 1);\
             } else if (i < argc - 1) {\
@@ -3298,6 +8541,7 @@ static int _cutest_setup(int argc, char* argv[], FILE* out, const cutest_hook_t*
 
     g_test_ctx.out = out;
     g_test_ctx.hook = hook;
+    g_test_ctx.hook_ex = hook_ex;
 
     int i;
     for (i = 0; i < argc; i++)
@@ -3309,11 +8553,33 @@ static int _cutest_setup(int argc, char* argv[], FILE* out, const cutest_hook_t*
         PARSER_LONGOPT_NO_VALUE("--test_also_run_disabled_tests",   _cutest_setup_arg_also_run_disabled_tests);
         PARSER_LONGOPT_NO_VALUE("--test_shuffle",                   _cutest_setup_arg_shuffle);
         PARSER_LONGOPT_NO_VALUE("--test_break_on_failure",          _cutest_setup_arg_break_on_failure);
+        PARSER_LONGOPT_NO_VALUE("--test_print_usage",               _cutest_setup_arg_print_usage);
+        PARSER_LONGOPT_NO_VALUE("--test_fail_alloc_sweep",          _cutest_setup_arg_fail_alloc_sweep);
+        PARSER_LONGOPT_NO_VALUE("--test_arena_huge_pages",          _cutest_setup_arg_arena_huge_pages);
+        PARSER_LONGOPT_NO_VALUE("--test_virtual_time",              _cutest_setup_arg_virtual_time);
 
         PARSER_LONGOPT_WITH_VALUE("--test_filter",                  _cutest_setup_arg_pattern);
         PARSER_LONGOPT_WITH_VALUE("--test_repeat",                  _cutest_setup_arg_repeat);
         PARSER_LONGOPT_WITH_VALUE("--test_random_seed",             _cutest_setup_arg_random_seed);
         PARSER_LONGOPT_WITH_VALUE("--test_print_time",              _cutest_setup_arg_print_time);
+        PARSER_LONGOPT_WITH_VALUE("--test_report_slowest",          _cutest_setup_arg_report_slowest);
+        PARSER_LONGOPT_WITH_VALUE("--test_report_variance",         _cutest_setup_arg_report_variance);
+        PARSER_LONGOPT_WITH_VALUE("--test_report_waiting",          _cutest_setup_arg_report_waiting);
+        PARSER_LONGOPT_WITH_VALUE("--test_profile",                 _cutest_setup_arg_profile);
+        PARSER_LONGOPT_WITH_VALUE("--test_profile_hz",              _cutest_setup_arg_profile_hz);
+        PARSER_LONGOPT_WITH_VALUE("--test_trace",                   _cutest_setup_arg_trace);
+        PARSER_LONGOPT_WITH_VALUE("--test_bench_min_time",          _cutest_setup_arg_bench_min_time);
+        PARSER_LONGOPT_WITH_VALUE("--test_bench_threads",           _cutest_setup_arg_bench_threads);
+        PARSER_LONGOPT_WITH_VALUE("--test_bench_hgrm",              _cutest_setup_arg_bench_hgrm);
+        PARSER_LONGOPT_WITH_VALUE("--test_bench_warmup",            _cutest_setup_arg_bench_warmup);
+        PARSER_LONGOPT_WITH_VALUE("--test_bench_cpu",               _cutest_setup_arg_bench_cpu);
+        PARSER_LONGOPT_WITH_VALUE("--test_budget_tolerance",        _cutest_setup_arg_budget_tolerance);
+        PARSER_LONGOPT_WITH_VALUE("--test_budget_retry",            _cutest_setup_arg_budget_retry);
+        PARSER_LONGOPT_WITH_VALUE("--test_max_io_bytes",            _cutest_setup_arg_max_io_bytes);
+        PARSER_LONGOPT_WITH_VALUE("--test_arena_size",              _cutest_setup_arg_arena_size);
+        PARSER_LONGOPT_WITH_VALUE("--test_tmpdir_root",             _cutest_setup_arg_tmpdir_root);
+        PARSER_LONGOPT_WITH_VALUE("--test_check_leaks",             _cutest_setup_arg_check_leaks);
+        PARSER_LONGOPT_WITH_VALUE("--test_alloc_leaks",             _cutest_setup_arg_alloc_leaks);
     }
 
     return 0;
@@ -3363,16 +8629,134 @@ static void _cutest_show_information(void)
     cutest_porting_fprintf(g_test_ctx.out,
         "[ $PARAME. ] --test_break_on_failure=%d\n", (int)g_test_ctx.mask.break_on_failure);
     cutest_porting_fprintf(g_test_ctx.out,
-        "[ $PARAME. ] --test_print_time=%d\n", (int)!g_test_ctx.mask.no_print_time);
+        "[ $PARAME. ] --test_print_time=%d\n",
+        g_test_ctx.mask.print_stage_time ? 2 : (int)!g_test_ctx.mask.no_print_time);
+    if (g_test_ctx.mask.print_usage)
+    {
+        cutest_porting_fprintf(g_test_ctx.out, "[ $PARAME. ] --test_print_usage\n");
+    }
+    if (g_test_ctx.mask.fail_alloc_sweep)
+    {
+        cutest_porting_fprintf(g_test_ctx.out, "[ $PARAME. ] --test_fail_alloc_sweep\n");
+    }
+    if (g_test_ctx.mask.check_leaks != 0)
+    {
+        cutest_porting_fprintf(g_test_ctx.out,
+            "[ $PARAME. ] --test_check_leaks=%d\n", (int)g_test_ctx.mask.check_leaks);
+    }
+    if (g_test_ctx.mask.alloc_leaks != ALLOC_DEFAULT_LEAKS)
+    {
+        cutest_porting_fprintf(g_test_ctx.out,
+            "[ $PARAME. ] --test_alloc_leaks=%d\n", (int)g_test_ctx.mask.alloc_leaks);
+    }
+    if (g_test_ctx.arena.size != ARENA_DEFAULT_SIZE)
+    {
+        cutest_porting_fprintf(g_test_ctx.out,
+            "[ $PARAME. ] --test_arena_size=%lu\n", g_test_ctx.arena.size);
+    }
+    if (g_test_ctx.arena.huge_pages)
+    {
+        cutest_porting_fprintf(g_test_ctx.out, "[ $PARAME. ] --test_arena_huge_pages\n");
+    }
+    if (g_test_ctx.tmpdir.root != NULL)
+    {
+        cutest_porting_fprintf(g_test_ctx.out,
+            "[ $PARAME. ] --test_tmpdir_root=%s\n", g_test_ctx.tmpdir.root);
+    }
+    if (g_test_ctx.mask.virtual_time)
+    {
+        cutest_porting_fprintf(g_test_ctx.out, "[ $PARAME. ] --test_virtual_time\n");
+    }
+    if (g_test_ctx.report.slowest != 0)
+    {
+        cutest_porting_fprintf(g_test_ctx.out,
+            "[ $PARAME. ] --test_report_slowest=%lu\n", g_test_ctx.report.slowest);
+    }
+    if (g_test_ctx.report.variance != 0)
+    {
+        cutest_porting_fprintf(g_test_ctx.out,
+            "[ $PARAME. ] --test_report_variance=%lu\n", g_test_ctx.report.variance);
+    }
+    if (g_test_ctx.report.waiting != 0)
+    {
+        cutest_porting_fprintf(g_test_ctx.out,
+            "[ $PARAME. ] --test_report_waiting=%lu\n", g_test_ctx.report.waiting);
+    }
+    if (g_test_ctx.profile.path != NULL)
+    {
+        cutest_porting_fprintf(g_test_ctx.out,
+            "[ $PARAME. ] --test_profile=%s\n", g_test_ctx.profile.path);
+    }
+    if (g_test_ctx.profile.hz != PROFILE_DEFAULT_HZ)
+    {
+        cutest_porting_fprintf(g_test_ctx.out,
+            "[ $PARAME. ] --test_profile_hz=%lu\n", g_test_ctx.profile.hz);
+    }
+    if (g_test_ctx.trace.path != NULL)
+    {
+        cutest_porting_fprintf(g_test_ctx.out,
+            "[ $PARAME. ] --test_trace=%s\n", g_test_ctx.trace.path);
+    }
+    if (g_test_ctx.bench.min_time != BENCH_DEFAULT_MIN_TIME)
+    {
+        cutest_porting_fprintf(g_test_ctx.out,
+            "[ $PARAME. ] --test_bench_min_time=%lu\n", g_test_ctx.bench.min_time);
+    }
+    if (g_test_ctx.bench.max_threads != 0)
+    {
+        cutest_porting_fprintf(g_test_ctx.out,
+            "[ $PARAME. ] --test_bench_threads=%lu\n", g_test_ctx.bench.max_threads);
+    }
+    if (g_test_ctx.bench.hgrm != NULL)
+    {
+        cutest_porting_fprintf(g_test_ctx.out,
+            "[ $PARAME. ] --test_bench_hgrm=%s\n", g_test_ctx.bench.hgrm);
+    }
+    if (g_test_ctx.bench.warmup != 0)
+    {
+        cutest_porting_fprintf(g_test_ctx.out,
+            "[ $PARAME. ] --test_bench_warmup=%lu\n", g_test_ctx.bench.warmup);
+    }
+    if (g_test_ctx.bench.pin)
+    {
+        cutest_porting_fprintf(g_test_ctx.out,
+            "[ $PARAME. ] --test_bench_cpu=%lu\n", g_test_ctx.bench.cpu);
+    }
+    if (g_test_ctx.budget.tolerance != BUDGET_DEFAULT_TOLERANCE)
+    {
+        cutest_porting_fprintf(g_test_ctx.out,
+            "[ $PARAME. ] --test_budget_tolerance=%lu\n", g_test_ctx.budget.tolerance);
+    }
+    if (g_test_ctx.budget.retry != BUDGET_DEFAULT_RETRY)
+    {
+        cutest_porting_fprintf(g_test_ctx.out,
+            "[ $PARAME. ] --test_budget_retry=%lu\n", g_test_ctx.budget.retry);
+    }
+    if (g_test_ctx.budget.max_io_bytes != 0)
+    {
+        cutest_porting_fprintf(g_test_ctx.out,
+            "[ $PARAME. ] --test_max_io_bytes=%lu\n", g_test_ctx.budget.max_io_bytes);
+    }
     cutest_porting_fprintf(g_test_ctx.out,
         "[==========] total %u test%s registered.\n",
         (unsigned)g_test_ctx.case_table.size,
         g_test_ctx.case_table.size > 1 ? "s" : "");
 }
 
+static void _cutest_reset_all_test_stat(void)
+{
+    cutest_map_node_t* it = cutest_map_begin(&g_test_ctx.case_table);
+    for (; it != NULL; it = cutest_map_next(it))
+    {
+        cutest_case_t* test_case = CONTAINER_OF(it, cutest_case_t, node);
+        cutest_porting_memset(&test_case->data.stat, 0, sizeof(test_case->data.stat));
+    }
+}
+
 static void _cutest_run_all_tests(void)
 {
     _cutest_show_information();
+    _cutest_reset_all_test_stat();
 
     for (g_test_ctx.counter.repeat.repeated = 0;
         g_test_ctx.counter.repeat.repeated < g_test_ctx.counter.repeat.repeat;
@@ -3411,6 +8795,15 @@ static void _cutest_run_all_tests(void)
             }
         }
     }
+
+    if (g_test_ctx.report.slowest != 0)
+    {
+        _cutest_show_report_slowest();
+    }
+    if (g_test_ctx.counter.repeat.repeat > 1 && g_test_ctx.report.variance != 0)
+    {
+        _cutest_show_report_variance();
+    }
 }
 
 void cutest_register_case(cutest_case_t* tc)
@@ -3428,10 +8821,11 @@ void cutest_case_init(cutest_case_t* tc, const char* fixture_name, const char* c
 {
     const cutest_case_t s_empty_tc = {
         { NULL, NULL, NULL },       /* .node */
-        { NULL, NULL },             /* .info */
+        { NULL, NULL, NULL, 0 },    /* .info */
         { NULL, NULL, NULL },       /* .stage */
-        { 0,0 },                    /* .data */
+        { 0, 0, 0, { 0, 0, 0, 0, 0 }, { 0, 0, 0, 0, 0, 0, 0 }, { 0, 0, 0, 0, 0, 0 } }, /* .data */
         { NULL, NULL, NULL, 0 },    /* .parameterized */
+        { 0, 0, 0, 0, 0 },          /* .bench */
     };
     *tc = s_empty_tc;
 
@@ -3451,21 +8845,300 @@ void cutest_case_convert_parameterized(cutest_case_t* tc, const char* type,
     tc->parameterized.param_idx = size;
 }
 
+void cutest_case_convert_benchmark(cutest_case_t* tc, int type)
+{
+    tc->bench.type = type;
+}
+
+void cutest_case_convert_load(cutest_case_t* tc, unsigned long rate, unsigned long duration)
+{
+    CUTEST_PORTING_ASSERT(rate != 0);
+    CUTEST_PORTING_ASSERT(duration != 0);
+
+    tc->bench.type = CUTEST_BENCH_LOAD;
+    tc->bench.rate = rate;
+    tc->bench.duration = duration;
+}
+
+void cutest_case_convert_budget(cutest_case_t* tc, unsigned long ms)
+{
+    CUTEST_PORTING_ASSERT(ms != 0);
+    tc->bench.budget = ms;
+}
+
+int cutest_internal_elapsed_check(cutest_elapsed_t* elapsed)
+{
+    cutest_porting_timespec_t tv_now;
+    cutest_porting_clock_gettime(&tv_now);
+
+    if (elapsed->attempt != 0)
+    {
+        double cost = cutest_timestamp_ns(&tv_now) - elapsed->start;
+        if (elapsed->attempt == 1 || cost < elapsed->best)
+        {
+            elapsed->best = cost;
+        }
+        if (cost < _cutest_budget_limit(elapsed->budget))
+        {
+            return 0;
+        }
+        if (elapsed->attempt > g_test_ctx.budget.retry)
+        {
+            _cutest_record_failure(elapsed->file, elapsed->line);
+            cutest_porting_fprintf(g_test_ctx.out,
+                "%s:%d:failure:\n"
+                "            expected: elapsed < `%s' ns (+%lu%%)\n"
+                "              actual: %.0f ns, best of %lu attempts\n",
+                elapsed->file, elapsed->line, elapsed->expr, g_test_ctx.budget.tolerance,
+                elapsed->best, elapsed->attempt);
+            _cutest_raise_failure();
+            return 0;
+        }
+    }
+
+    elapsed->attempt++;
+    cutest_porting_clock_gettime(&tv_now);
+    elapsed->start = cutest_timestamp_ns(&tv_now);
+    return 1;
+}
+
+void cutest_case_convert_noalloc(cutest_case_t* tc)
+{
+    tc->bench.noalloc = 1;
+}
+
+void cutest_no_alloc_begin(void)
+{
+    static int s_warned = 0;
+    if (cutest_alloc_scope_enter() != 0 && !s_warned)
+    {
+        s_warned = 1;
+        _cutest_warning("allocations are not tracked, build with CUTEST_ALLOC_TRACKER"
+            " to check CUTEST_NO_ALLOC_BEGIN().");
+    }
+}
+
+void cutest_no_alloc_end(const char* file, int line)
+{
+    _cutest_alloc_scope_check(file, line);
+}
+
+void cutest_alloc_ignore_begin(void)
+{
+    cutest_alloc_ignore(1);
+}
+
+void cutest_alloc_ignore_end(void)
+{
+    cutest_alloc_ignore(0);
+}
+
+void* cutest_arena_alloc(size_t size)
+{
+    return _cutest_arena_alloc(size, (size_t)g_test_ctx.arena.size * 1024 * 1024,
+        g_test_ctx.arena.huge_pages);
+}
+
+unsigned long long cutest_now(void)
+{
+    if (!g_test_ctx.mask.virtual_time)
+    {
+        return _cutest_real_now();
+    }
+
+    SPIN_LOCK(&s_vtime.lock);
+    unsigned long long now = s_vtime.now;
+    SPIN_UNLOCK(&s_vtime.lock);
+    return now;
+}
+
+void cutest_sleep(unsigned long long ns)
+{
+    if (!g_test_ctx.mask.virtual_time)
+    {
+        _cutest_real_sleep(ns);
+    }
+    else if (ns != 0)
+    {
+        _cutest_vtime_sleep(ns);
+    }
+}
+
+void cutest_time_attach(void)
+{
+    SPIN_LOCK(&s_vtime.lock);
+    s_vtime.threads++;
+    SPIN_UNLOCK(&s_vtime.lock);
+}
+
+void cutest_time_detach(void)
+{
+    SPIN_LOCK(&s_vtime.lock);
+    if (s_vtime.threads > 0)
+    {
+        s_vtime.threads--;
+    }
+    /* The clock may only have been waiting for this thread. */
+    _cutest_vtime_advance();
+    SPIN_UNLOCK(&s_vtime.lock);
+}
+
+int cutest_io_fault_set(const cutest_io_fault_t* fault)
+{
+    if (g_test_ctx.runtime.cur_node == NULL)
+    {
+        return -1;
+    }
+    return cutest_io_fault_begin(fault);
+}
+
+const char* cutest_tmpdir(void)
+{
+    if (g_test_ctx.runtime.cur_node == NULL)
+    {
+        return NULL;
+    }
+
+    SPIN_LOCK(&s_tmpdir.lock);
+    if (!s_tmpdir.created)
+    {
+        if (g_test_ctx.tmpdir.root != NULL)
+        {
+            s_tmpdir.created = _cutest_tmpdir_create(g_test_ctx.tmpdir.root) == 0;
+        }
+        else
+        {
+            s_tmpdir.created = _cutest_tmpdir_create("/dev/shm") == 0
+                || _cutest_tmpdir_create("/tmp") == 0;
+        }
+    }
+    const char* path = s_tmpdir.created ? s_tmpdir.path : NULL;
+    SPIN_UNLOCK(&s_tmpdir.lock);
+
+    return path;
+}
+
+void* cutest_guarded_alloc(size_t size, cutest_guard_t guard)
+{
+    return _cutest_guarded_alloc(size, guard);
+}
+
+void cutest_guarded_free(void* ptr)
+{
+    if (ptr != NULL && _cutest_guarded_free(ptr) != 0)
+    {
+        cutest_abort("%p is not allocated by cutest_guarded_alloc().\n", ptr);
+    }
+}
+
+void cutest_timer_begin(const char* name)
+{
+    if (g_test_ctx.runtime.tid != cutest_porting_gettid())
+    {
+        return;
+    }
+
+    test_timer_region_t* region = _cutest_timer_find(name);
+    if (region == NULL)
+    {
+        if (s_timer_table.size >= CUTEST_TIMER_MAX)
+        {
+            _cutest_warning("too many timing regions, `%s' is ignored.", name);
+            return;
+        }
+        region = &s_timer_table.regions[s_timer_table.size++];
+        region->name = name;
+        region->count = 0;
+        region->total = 0;
+        region->running = 0;
+    }
+
+    if (region->running)
+    {
+        _cutest_warning("timing region `%s' is already started.", name);
+        return;
+    }
+    region->running = 1;
+    cutest_porting_clock_gettime(&region->tv_beg);
+}
+
+void cutest_timer_end(const char* name)
+{
+    cutest_porting_timespec_t tv_end, tv_diff;
+    cutest_porting_clock_gettime(&tv_end);
+
+    if (g_test_ctx.runtime.tid != cutest_porting_gettid())
+    {
+        return;
+    }
+
+    test_timer_region_t* region = _cutest_timer_find(name);
+    if (region == NULL || !region->running)
+    {
+        _cutest_warning("timing region `%s' is not started.", name);
+        return;
+    }
+
+    region->running = 0;
+    region->count++;
+    cutest_timestamp_dif(&region->tv_beg, &tv_end, &tv_diff);
+    region->total += cutest_timestamp_ns(&tv_diff);
+
+    /* Benchmarks may call it millions of times, which is too much for trace. */
+    if (g_test_ctx.runtime.cur_node == NULL
+        || g_test_ctx.runtime.cur_node->bench.type == CUTEST_BENCH_NONE)
+    {
+        _cutest_trace_span(name, "timer", 0, &region->tv_beg, &tv_end);
+    }
+}
+
+void cutest_bench_set_bytes(unsigned long bytes)
+{
+    if (g_test_ctx.runtime.tid != cutest_porting_gettid())
+    {
+        return;
+    }
+
+    g_test_ctx.bench.bytes = bytes;
+}
+
+void cutest_bench_set_items(unsigned long items)
+{
+    if (g_test_ctx.runtime.tid != cutest_porting_gettid())
+    {
+        return;
+    }
+
+    g_test_ctx.bench.items = items;
+}
+
 int cutest_run_tests(int argc, char* argv[], FILE* out, const cutest_hook_t* hook)
+{
+    return cutest_run_tests_ex(argc, argv, out, hook, NULL);
+}
+
+int cutest_run_tests_ex(int argc, char* argv[], FILE* out, const cutest_hook_t* hook,
+    const cutest_hook_ex_t* hook_ex)
 {
     int ret = 0;
     CUTEST_PORTING_ASSERT(out != NULL);
+    CUTEST_PORTING_ASSERT(hook_ex == NULL || hook_ex->version != 0);
 
     /* Parser parameter */
-    if ((ret = _cutest_setup(argc, argv, out, hook)) != 0)
+    if ((ret = _cutest_setup(argc, argv, out, hook, hook_ex)) != 0)
     {
         goto fin;
     }
 
+    _cutest_trace_open();
     _cutest_hook_before_all_test(argc, argv);
+    _cutest_profile_start();
     _cutest_run_all_tests();
+    _cutest_profile_stop();
     ret = (int)g_test_ctx.counter.result.failed;
     _cutest_hook_after_all_test();
+    _cutest_trace_close();
+    _cutest_arena_release();
 
 fin:
     _cutest_cleanup();
@@ -3490,6 +9163,31 @@ const char* cutest_get_current_test(void)
     return g_test_ctx.runtime.cur_node->info.case_name;
 }
 
+int cutest_get_current_usage(cutest_usage_t* usage)
+{
+    if (g_test_ctx.runtime.cur_node == NULL)
+    {
+        return -1;
+    }
+    return _cutest_usage_since_start(usage);
+}
+
+int cutest_get_current_io(cutest_io_t* io)
+{
+    if (g_test_ctx.runtime.cur_node == NULL)
+    {
+        return -1;
+    }
+    if (_cutest_io_since_start(io) != 0)
+    {
+        return -1;
+    }
+
+    /* This read is not I/O of the case either. */
+    _cutest_io_skip_probe();
+    return 0;
+}
+
 void cutest_internal_assert_failure(void)
 {
     if (g_test_ctx.runtime.tid != cutest_porting_gettid())
@@ -3547,6 +9245,10 @@ int cutest_internal_compare(const char* type_name, const void* addr1, const void
     cutest_type_info_t* type_info = _cutest_get_type_info(type_name);
     CUTEST_PORTING_ASSERT_P(type_info != NULL, "%s not registered", type_name);
 
+    if (g_test_ctx.runtime.tid == cutest_porting_gettid())
+    {
+        g_test_ctx.runtime.assertions++;
+    }
     return type_info->cmp(addr1, addr2);
 }
 
@@ -3561,6 +9263,7 @@ void cutest_internal_dump(const char* file, int line, const char* type_name,
         return;
     }
 
+    _cutest_record_failure(file, line);
     cutest_porting_fprintf(g_test_ctx.out,
         "%s:%d:failure:\n"
         "            expected: `%s' %s `%s'\n"
@@ -0,0 +1,181 @@
+#include "test.h"
+#include <fcntl.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/resource.h>
+
+#define MANY_FDS    1100
+
+static int s_fd = -1;
+static pthread_t s_thread;
+static int s_thread_started;
+static volatile int s_thread_stop;
+static int s_many[MANY_FDS];
+static int s_many_cnt;
+static int s_hole;
+
+static void* _thread_proc(void* arg)
+{
+    (void)arg;
+    while (!s_thread_stop)
+    {
+        usleep(1000);
+    }
+    return NULL;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Watchpoint
+///////////////////////////////////////////////////////////////////////////////
+
+TEST(check_leaks, clean)
+{
+    int fd = open("/dev/null", O_RDONLY);
+    ASSERT_GE_INT(fd, 0);
+    close(fd);
+}
+
+TEST(check_leaks, fd)
+{
+    s_fd = open("/dev/null", O_RDONLY);
+    ASSERT_GE_INT(s_fd, 0);
+}
+
+TEST(check_leaks, thread)
+{
+    s_thread_stop = 0;
+    ASSERT_EQ_INT(pthread_create(&s_thread, NULL, _thread_proc, NULL), 0);
+    s_thread_started = 1;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Verify
+///////////////////////////////////////////////////////////////////////////////
+
+DEFINE_TEST_SETUP(check_leaks)
+{
+}
+
+DEFINE_TEST_TEARDOWN(check_leaks)
+{
+    if (s_fd >= 0)
+    {
+        close(s_fd);
+        s_fd = -1;
+    }
+    if (s_thread_started)
+    {
+        s_thread_stop = 1;
+        pthread_join(s_thread, NULL);
+        s_thread_started = 0;
+    }
+}
+
+DEFINE_TEST_F(check_leaks, 0, "--test_filter=check_leaks.fd")
+{
+    TEST_PORTING_ASSERT(_TEST.rret == 0);
+
+    string_matrix_t* matrix = string_matrix_create_from_file(_TEST.out, "\n");
+    TEST_PORTING_ASSERT(string_matrix_count(matrix, "--test_check_leaks") == 0);
+    TEST_PORTING_ASSERT(string_matrix_count(matrix, "leaks fd") == 0);
+    string_matrix_destroy(matrix);
+}
+
+DEFINE_TEST_F(check_leaks, clean, "--test_filter=check_leaks.clean", "--test_check_leaks=2")
+{
+    TEST_PORTING_ASSERT(_TEST.rret == 0);
+
+    string_matrix_t* matrix = string_matrix_create_from_file(_TEST.out, "\n");
+    TEST_PORTING_ASSERT(string_matrix_count(matrix, "[ $PARAME. ] --test_check_leaks=2") == 1);
+    string_matrix_destroy(matrix);
+}
+
+DEFINE_TEST_F(check_leaks, warn_fd, "--test_filter=check_leaks.fd", "--test_check_leaks=1")
+{
+    TEST_PORTING_ASSERT(_TEST.rret == 0);
+
+    string_matrix_t* matrix = string_matrix_create_from_file(_TEST.out, "\n");
+    TEST_PORTING_ASSERT(string_matrix_count(matrix, "[ WARNING  ] check_leaks.fd leaks fd ") == 1);
+    TEST_PORTING_ASSERT(string_matrix_count(matrix, " (/dev/null).") == 1);
+    string_matrix_destroy(matrix);
+}
+
+DEFINE_TEST_F(check_leaks, fail_fd, "--test_filter=check_leaks.fd", "--test_check_leaks=2")
+{
+    TEST_PORTING_ASSERT(_TEST.rret == 1);
+
+    string_matrix_t* matrix = string_matrix_create_from_file(_TEST.out, "\n");
+    TEST_PORTING_ASSERT(string_matrix_count(matrix, "check_leaks.fd:failure:") == 1);
+    TEST_PORTING_ASSERT(string_matrix_count(matrix, "expected: no leaked fd") == 1);
+    TEST_PORTING_ASSERT(string_matrix_count(matrix, "actual: fd ") == 1);
+    TEST_PORTING_ASSERT(string_matrix_count(matrix, " (/dev/null)") == 1);
+    string_matrix_destroy(matrix);
+}
+
+DEFINE_TEST_F(check_leaks, fail_thread, "--test_filter=check_leaks.thread", "--test_check_leaks=2")
+{
+    TEST_PORTING_ASSERT(_TEST.rret == 1);
+
+    string_matrix_t* matrix = string_matrix_create_from_file(_TEST.out, "\n");
+    TEST_PORTING_ASSERT(string_matrix_count(matrix, "expected: no leaked thread") == 1);
+    TEST_PORTING_ASSERT(string_matrix_count(matrix, "actual: thread ") == 1);
+    string_matrix_destroy(matrix);
+}
+
+/* More descriptors than the check keeps, with a low one free for the leak. */
+DEFINE_TEST_SETUP(many_fds)
+{
+    struct rlimit lim;
+    s_many_cnt = 0;
+    s_hole = -1;
+    if (getrlimit(RLIMIT_NOFILE, &lim) != 0 || lim.rlim_max < MANY_FDS + 64)
+    {
+        return;
+    }
+    lim.rlim_cur = lim.rlim_max;
+    TEST_PORTING_ASSERT(setrlimit(RLIMIT_NOFILE, &lim) == 0);
+
+    for (s_many_cnt = 0; s_many_cnt < MANY_FDS; s_many_cnt++)
+    {
+        s_many[s_many_cnt] = open("/dev/null", O_RDONLY);
+        TEST_PORTING_ASSERT(s_many[s_many_cnt] >= 0);
+    }
+    s_hole = s_many[5];
+    close(s_hole);
+    s_many[5] = -1;
+}
+
+DEFINE_TEST_TEARDOWN(many_fds)
+{
+    int i;
+    for (i = 0; i < s_many_cnt; i++)
+    {
+        if (s_many[i] >= 0)
+        {
+            close(s_many[i]);
+        }
+    }
+    if (s_fd >= 0)
+    {
+        close(s_fd);
+        s_fd = -1;
+    }
+}
+
+DEFINE_TEST_F(many_fds, truncated, "--test_filter=check_leaks.fd", "--test_check_leaks=2")
+{
+    char buf[64];
+    if (s_hole < 0)
+    {
+        return;
+    }
+
+    TEST_PORTING_ASSERT(_TEST.rret == 1);
+    TEST_PORTING_ASSERT(s_fd == s_hole);
+
+    string_matrix_t* matrix = string_matrix_create_from_file(_TEST.out, "\n");
+    TEST_PORTING_ASSERT(string_matrix_count(matrix, "entries in /proc/self/fd, only the lowest are checked.") == 1);
+    snprintf(buf, sizeof(buf), "actual: fd %d (/dev/null)", s_hole);
+    TEST_PORTING_ASSERT(string_matrix_count(matrix, buf) == 1);
+    string_matrix_destroy(matrix);
+}
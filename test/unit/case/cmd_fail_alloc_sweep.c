@@ -0,0 +1,112 @@
+#include "test.h"
+#include <stdlib.h>
+
+///////////////////////////////////////////////////////////////////////////////
+// Watchpoint
+///////////////////////////////////////////////////////////////////////////////
+
+TEST(sweep, robust)
+{
+    void* volatile p = malloc(8);
+    if (p == NULL)
+    {
+        return;
+    }
+    void* volatile q = calloc(1, 8);
+    if (q == NULL)
+    {
+        free(p);
+        return;
+    }
+    free(q);
+    free(p);
+}
+
+TEST(sweep, crash)
+{
+    /* Keep the store, so the NULL dereference is not optimized out. */
+    volatile char* volatile p = malloc(8);
+    p[0] = 1;
+    free((char*)p);
+}
+
+TEST(sweep, leak)
+{
+    void* volatile p = malloc(8);
+    if (p == NULL)
+    {
+        return;
+    }
+    void* volatile q = malloc(8);
+    if (q == NULL)
+    {
+        return;
+    }
+    free(q);
+    free(p);
+}
+
+TEST(sweep, assert)
+{
+    void* volatile p = malloc(8);
+    ASSERT_NE_PTR(p, NULL);
+    free(p);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Verify
+///////////////////////////////////////////////////////////////////////////////
+
+DEFINE_TEST(sweep, robust, "--test_filter=sweep.robust", "--test_fail_alloc_sweep")
+{
+    TEST_PORTING_ASSERT(_TEST.rret == 0);
+
+    string_matrix_t* matrix = string_matrix_create_from_file(_TEST.out, "\n");
+    TEST_PORTING_ASSERT(string_matrix_count(matrix, "[ $PARAME. ] --test_fail_alloc_sweep") == 1);
+    TEST_PORTING_ASSERT(string_matrix_count(matrix, "[ RUN      ] sweep.robust") == 1);
+    TEST_PORTING_ASSERT(string_matrix_count(matrix, "[ SWEEP    ] sweep.robust 2 allocation points, 0 crashed, 0 leaked") == 1);
+    string_matrix_destroy(matrix);
+}
+
+DEFINE_TEST(sweep, crash, "--test_filter=sweep.crash", "--test_fail_alloc_sweep")
+{
+    TEST_PORTING_ASSERT(_TEST.rret == 1);
+
+    string_matrix_t* matrix = string_matrix_create_from_file(_TEST.out, "\n");
+    TEST_PORTING_ASSERT(string_matrix_count(matrix, "expected: survive failure of allocation #1 of 1") == 1);
+    TEST_PORTING_ASSERT(string_matrix_count(matrix, "actual: crashed by signal ") == 1);
+    TEST_PORTING_ASSERT(string_matrix_count(matrix, "[ SWEEP    ] sweep.crash 1 allocation points, 1 crashed, 0 leaked") == 1);
+    TEST_PORTING_ASSERT(string_matrix_count(matrix, "[  FAILED  ] sweep.crash") == 2);
+    string_matrix_destroy(matrix);
+}
+
+DEFINE_TEST(sweep, leak, "--test_filter=sweep.leak", "--test_fail_alloc_sweep")
+{
+    TEST_PORTING_ASSERT(_TEST.rret == 1);
+
+    string_matrix_t* matrix = string_matrix_create_from_file(_TEST.out, "\n");
+    TEST_PORTING_ASSERT(string_matrix_count(matrix, "expected: survive failure of allocation #2 of 2") == 1);
+    TEST_PORTING_ASSERT(string_matrix_count(matrix, "actual: memory leak") == 1);
+    TEST_PORTING_ASSERT(string_matrix_count(matrix, "[ SWEEP    ] sweep.leak 2 allocation points, 0 crashed, 1 leaked") == 1);
+    string_matrix_destroy(matrix);
+}
+
+DEFINE_TEST(sweep, assert, "--test_filter=sweep.assert", "--test_fail_alloc_sweep")
+{
+    /* Assertion failure is a way to handle allocation failure. */
+    TEST_PORTING_ASSERT(_TEST.rret == 0);
+
+    string_matrix_t* matrix = string_matrix_create_from_file(_TEST.out, "\n");
+    TEST_PORTING_ASSERT(string_matrix_count(matrix, "[ SWEEP    ] sweep.assert 1 allocation points, 0 crashed, 0 leaked") == 1);
+    string_matrix_destroy(matrix);
+}
+
+DEFINE_TEST(sweep, disabled, "--test_filter=sweep.robust")
+{
+    TEST_PORTING_ASSERT(_TEST.rret == 0);
+
+    string_matrix_t* matrix = string_matrix_create_from_file(_TEST.out, "\n");
+    TEST_PORTING_ASSERT(string_matrix_count(matrix, "--test_fail_alloc_sweep") == 0);
+    TEST_PORTING_ASSERT(string_matrix_count(matrix, "[ SWEEP    ]") == 0);
+    string_matrix_destroy(matrix);
+}
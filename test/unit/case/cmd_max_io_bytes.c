@@ -0,0 +1,88 @@
+#include "test.h"
+#include <fcntl.h>
+#include <unistd.h>
+
+///////////////////////////////////////////////////////////////////////////////
+// Watchpoint
+///////////////////////////////////////////////////////////////////////////////
+
+TEST(max_io_bytes, write)
+{
+    static char buf[64 * 1024];
+    int i, fd = open("/dev/null", O_WRONLY);
+    ASSERT_GE_INT(fd, 0);
+    for (i = 0; i < 16; i++)
+    {
+        ASSERT_EQ_INT((int)write(fd, buf, sizeof(buf)), (int)sizeof(buf));
+    }
+    close(fd);
+
+    cutest_io_t io;
+    ASSERT_EQ_INT(cutest_get_current_io(&io), 0);
+    ASSERT_GE_ULONG(io.wchar, 16 * (unsigned long)sizeof(buf));
+    ASSERT_GE_ULONG(io.syscw, 16UL);
+}
+
+TEST(max_io_bytes, empty)
+{
+    cutest_io_t io;
+    ASSERT_EQ_INT(cutest_get_current_io(&io), 0);
+    ASSERT_EQ_ULONG(io.rchar, 0UL);
+    ASSERT_EQ_ULONG(io.syscr, 0UL);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Verify
+///////////////////////////////////////////////////////////////////////////////
+
+DEFINE_TEST(max_io_bytes, 0, "--test_filter=max_io_bytes.write")
+{
+    TEST_PORTING_ASSERT(_TEST.rret == 0);
+
+    string_matrix_t* matrix = string_matrix_create_from_file(_TEST.out, "\n");
+    TEST_PORTING_ASSERT(string_matrix_count(matrix, "--test_max_io_bytes") == 0);
+    TEST_PORTING_ASSERT(string_matrix_count(matrix, "[ IO       ]") == 0);
+    string_matrix_destroy(matrix);
+}
+
+DEFINE_TEST(max_io_bytes, print_usage, "--test_filter=max_io_bytes.write", "--test_print_usage")
+{
+    TEST_PORTING_ASSERT(_TEST.rret == 0);
+
+    string_matrix_t* matrix = string_matrix_create_from_file(_TEST.out, "\n");
+    TEST_PORTING_ASSERT(string_matrix_count(matrix, "[ IO       ] max_io_bytes.write rchar ") == 1);
+    TEST_PORTING_ASSERT(string_matrix_count(matrix, ", write_bytes ") == 1);
+    string_matrix_destroy(matrix);
+}
+
+DEFINE_TEST(max_io_bytes, pass, "--test_filter=max_io_bytes.write", "--test_max_io_bytes=104857600")
+{
+    TEST_PORTING_ASSERT(_TEST.rret == 0);
+
+    string_matrix_t* matrix = string_matrix_create_from_file(_TEST.out, "\n");
+    TEST_PORTING_ASSERT(string_matrix_count(matrix, "[ $PARAME. ] --test_max_io_bytes=104857600") == 1);
+    TEST_PORTING_ASSERT(string_matrix_count(matrix, "failure:") == 0);
+    string_matrix_destroy(matrix);
+}
+
+/* Reading the I/O counters must not count as I/O of the case. */
+DEFINE_TEST(max_io_bytes, empty, "--test_filter=max_io_bytes.empty", "--test_max_io_bytes=1")
+{
+    TEST_PORTING_ASSERT(_TEST.rret == 0);
+
+    string_matrix_t* matrix = string_matrix_create_from_file(_TEST.out, "\n");
+    TEST_PORTING_ASSERT(string_matrix_count(matrix, "[       OK ] max_io_bytes.empty") == 1);
+    TEST_PORTING_ASSERT(string_matrix_count(matrix, "failure:") == 0);
+    string_matrix_destroy(matrix);
+}
+
+DEFINE_TEST(max_io_bytes, fail, "--test_filter=max_io_bytes.write", "--test_max_io_bytes=65536")
+{
+    TEST_PORTING_ASSERT(_TEST.rret == 1);
+
+    string_matrix_t* matrix = string_matrix_create_from_file(_TEST.out, "\n");
+    TEST_PORTING_ASSERT(string_matrix_count(matrix, "max_io_bytes.write:failure:") == 1);
+    TEST_PORTING_ASSERT(string_matrix_count(matrix, "expected: I/O <= 65536 bytes") == 1);
+    TEST_PORTING_ASSERT(string_matrix_count(matrix, "actual: ") == 1);
+    string_matrix_destroy(matrix);
+}
@@ -0,0 +1,52 @@
+#include "test.h"
+
+///////////////////////////////////////////////////////////////////////////////
+// Watchpoint
+///////////////////////////////////////////////////////////////////////////////
+
+TEST_FIXTURE_SETUP(print_time)
+{
+}
+
+TEST_FIXTURE_TEARDOWN(print_time)
+{
+}
+
+TEST_F(print_time, stage)
+{
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Verify
+///////////////////////////////////////////////////////////////////////////////
+
+DEFINE_TEST(print_time, 1, "--test_print_time=1")
+{
+    TEST_PORTING_ASSERT(_TEST.rret == 0);
+
+    string_matrix_t* matrix = string_matrix_create_from_file(_TEST.out, "\n");
+    const char* line = string_matrix_find(matrix, "[       OK ] print_time.stage");
+    TEST_PORTING_ASSERT(line != NULL);
+    TEST_PORTING_ASSERT(strstr(line, " ms)") != NULL);
+    TEST_PORTING_ASSERT(strstr(line, "setup") == NULL);
+    string_matrix_destroy(matrix);
+}
+
+DEFINE_TEST(print_time, 2, "--test_print_time=2")
+{
+    TEST_PORTING_ASSERT(_TEST.rret == 0);
+
+    string_matrix_t* matrix = string_matrix_create_from_file(_TEST.out, "\n");
+    TEST_PORTING_ASSERT(string_matrix_find(matrix, "--test_print_time=2") != NULL);
+
+    const char* line = string_matrix_find(matrix, "[       OK ] print_time.stage");
+    TEST_PORTING_ASSERT(line != NULL);
+    TEST_PORTING_ASSERT(strstr(line, " ms, setup ") != NULL);
+    TEST_PORTING_ASSERT(strstr(line, " ns, body ") != NULL);
+    TEST_PORTING_ASSERT(strstr(line, " ns, teardown ") != NULL);
+#if defined(_WIN32) || defined(__linux__)
+    TEST_PORTING_ASSERT(strstr(line, " ns, cpu ") != NULL);
+    TEST_PORTING_ASSERT(strstr(line, " ns, thread cpu ") != NULL);
+#endif
+    string_matrix_destroy(matrix);
+}
@@ -0,0 +1,68 @@
+#include "test.h"
+
+///////////////////////////////////////////////////////////////////////////////
+// Watchpoint
+///////////////////////////////////////////////////////////////////////////////
+
+TEST_FIXTURE_SETUP(print_usage)
+{
+}
+
+TEST_FIXTURE_TEARDOWN(print_usage)
+{
+}
+
+TEST_F(print_usage, 0)
+{
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Verify
+///////////////////////////////////////////////////////////////////////////////
+
+static int s_usage_ret = 1;
+
+static void _on_after_test(const char* fixture, const char* test_name, int ret)
+{
+    (void)fixture; (void)test_name; (void)ret;
+
+    cutest_usage_t usage;
+    s_usage_ret = cutest_get_current_usage(&usage);
+}
+
+DEFINE_TEST_SETUP(print_usage)
+{
+    _TEST.hook.after_test = _on_after_test;
+    s_usage_ret = 1;
+}
+
+DEFINE_TEST_TEARDOWN(print_usage)
+{
+}
+
+DEFINE_TEST_F(print_usage, 0)
+{
+    TEST_PORTING_ASSERT(_TEST.rret == 0);
+    TEST_PORTING_ASSERT(cutest_get_current_usage(NULL) == -1);
+
+    string_matrix_t* matrix = string_matrix_create_from_file(_TEST.out, "\n");
+    TEST_PORTING_ASSERT(string_matrix_count(matrix, "--test_print_usage") == 0);
+    TEST_PORTING_ASSERT(string_matrix_count(matrix, "[ USAGE    ]") == 0);
+    string_matrix_destroy(matrix);
+}
+
+DEFINE_TEST_F(print_usage, 1, "--test_print_usage")
+{
+    TEST_PORTING_ASSERT(_TEST.rret == 0);
+
+    string_matrix_t* matrix = string_matrix_create_from_file(_TEST.out, "\n");
+    TEST_PORTING_ASSERT(string_matrix_count(matrix, "[ $PARAME. ] --test_print_usage") == 1);
+#if defined(__linux__)
+    TEST_PORTING_ASSERT(s_usage_ret == 0);
+    TEST_PORTING_ASSERT(string_matrix_count(matrix, "[ USAGE    ] print_usage.0 maxrss +") == 1);
+    TEST_PORTING_ASSERT(string_matrix_count(matrix, ", minflt ") == 1);
+    TEST_PORTING_ASSERT(string_matrix_count(matrix, ", nvcsw ") == 1);
+    TEST_PORTING_ASSERT(string_matrix_count(matrix, ", oublock ") == 1);
+#endif
+    string_matrix_destroy(matrix);
+}
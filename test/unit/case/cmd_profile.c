@@ -0,0 +1,49 @@
+#include "test.h"
+#include <time.h>
+
+#define PROFILE_FILE    "./cmd_profile.folded"
+
+///////////////////////////////////////////////////////////////////////////////
+// Watchpoint
+///////////////////////////////////////////////////////////////////////////////
+
+TEST(profile, busy)
+{
+    volatile unsigned long cnt = 0;
+    clock_t beg = clock();
+    while (clock() - beg < CLOCKS_PER_SEC / 10)
+    {
+        cnt++;
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Verify
+///////////////////////////////////////////////////////////////////////////////
+
+DEFINE_TEST(profile, 0, "--test_profile=" PROFILE_FILE, "--test_profile_hz=500")
+{
+    TEST_PORTING_ASSERT(_TEST.rret == 0);
+
+    string_matrix_t* matrix = string_matrix_create_from_file(_TEST.out, "\n");
+    TEST_PORTING_ASSERT(string_matrix_count(matrix, "[ $PARAME. ] --test_profile=" PROFILE_FILE) == 1);
+    TEST_PORTING_ASSERT(string_matrix_count(matrix, "[ $PARAME. ] --test_profile_hz=500") == 1);
+#if defined(__linux__) && defined(__GLIBC__)
+    TEST_PORTING_ASSERT(string_matrix_count(matrix, "[ PROFILE  ]") == 1);
+    TEST_PORTING_ASSERT(string_matrix_count(matrix, " busy) written to `" PROFILE_FILE "`.") == 1);
+    string_matrix_destroy(matrix);
+
+    FILE* file = fopen(PROFILE_FILE, "r");
+    TEST_PORTING_ASSERT(file != NULL);
+
+    matrix = string_matrix_create_from_file(file, "\n");
+    TEST_PORTING_ASSERT(string_matrix_count(matrix, "profile.busy;") > 0);
+    string_matrix_destroy(matrix);
+
+    fclose(file);
+    remove(PROFILE_FILE);
+#else
+    TEST_PORTING_ASSERT(string_matrix_count(matrix, "[ WARNING  ] --test_profile is not supported") == 1);
+    string_matrix_destroy(matrix);
+#endif
+}
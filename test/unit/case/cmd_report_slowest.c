@@ -0,0 +1,55 @@
+#include "test.h"
+
+///////////////////////////////////////////////////////////////////////////////
+// Watchpoint
+///////////////////////////////////////////////////////////////////////////////
+
+TEST(report_slowest, 0)
+{
+}
+
+TEST(report_slowest, 1)
+{
+}
+
+TEST(report_other, 0)
+{
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Verify
+///////////////////////////////////////////////////////////////////////////////
+
+DEFINE_TEST(report_slowest, 0)
+{
+    TEST_PORTING_ASSERT(_TEST.rret == 0);
+
+    string_matrix_t* matrix = string_matrix_create_from_file(_TEST.out, "\n");
+    TEST_PORTING_ASSERT(string_matrix_count(matrix, "[ SLOWEST  ]") == 0);
+    string_matrix_destroy(matrix);
+}
+
+DEFINE_TEST(report_slowest, 2, "--test_report_slowest=2", "--test_shuffle")
+{
+    TEST_PORTING_ASSERT(_TEST.rret == 0);
+
+    string_matrix_t* matrix = string_matrix_create_from_file(_TEST.out, "\n");
+    TEST_PORTING_ASSERT(string_matrix_count(matrix, "[ SLOWEST  ] 2 slowest of 3 tests") == 1);
+    TEST_PORTING_ASSERT(string_matrix_count(matrix, "[ SLOWEST  ] 2 slowest fixtures") == 1);
+    TEST_PORTING_ASSERT(string_matrix_count(matrix, "  report_slowest (2 tests)") == 1);
+    TEST_PORTING_ASSERT(string_matrix_count(matrix, "  report_other (1 test)") == 1);
+    TEST_PORTING_ASSERT(string_matrix_count(matrix, "[ SLOWEST  ]") == 6);
+    string_matrix_destroy(matrix);
+}
+
+/* Printed once after all iterations, not once per iteration. */
+DEFINE_TEST(report_slowest, repeat, "--test_report_slowest=2", "--test_repeat=3")
+{
+    TEST_PORTING_ASSERT(_TEST.rret == 0);
+
+    string_matrix_t* matrix = string_matrix_create_from_file(_TEST.out, "\n");
+    TEST_PORTING_ASSERT(string_matrix_count(matrix, "[ SLOWEST  ] 2 slowest of 3 tests") == 1);
+    TEST_PORTING_ASSERT(string_matrix_count(matrix, "[ SLOWEST  ] 2 slowest fixtures") == 1);
+    TEST_PORTING_ASSERT(string_matrix_count(matrix, "[ SLOWEST  ]") == 6);
+    string_matrix_destroy(matrix);
+}
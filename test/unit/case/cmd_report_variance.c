@@ -0,0 +1,57 @@
+#include "test.h"
+
+///////////////////////////////////////////////////////////////////////////////
+// Watchpoint
+///////////////////////////////////////////////////////////////////////////////
+
+TEST(report_variance, 0)
+{
+}
+
+TEST(report_variance, 1)
+{
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Verify
+///////////////////////////////////////////////////////////////////////////////
+
+DEFINE_TEST(report_variance, no_repeat, "--test_report_variance=10")
+{
+    TEST_PORTING_ASSERT(_TEST.rret == 0);
+
+    string_matrix_t* matrix = string_matrix_create_from_file(_TEST.out, "\n");
+    TEST_PORTING_ASSERT(string_matrix_count(matrix, "[ VARIANCE ]") == 0);
+    string_matrix_destroy(matrix);
+}
+
+DEFINE_TEST(report_variance, default, "--test_repeat=3")
+{
+    TEST_PORTING_ASSERT(_TEST.rret == 0);
+
+    string_matrix_t* matrix = string_matrix_create_from_file(_TEST.out, "\n");
+    TEST_PORTING_ASSERT(string_matrix_count(matrix, "--test_report_variance") == 0);
+    TEST_PORTING_ASSERT(string_matrix_count(matrix, "[ VARIANCE ]") == 0);
+    string_matrix_destroy(matrix);
+}
+
+DEFINE_TEST(report_variance, repeat, "--test_repeat=3", "--test_report_variance=10")
+{
+    TEST_PORTING_ASSERT(_TEST.rret == 0);
+
+    string_matrix_t* matrix = string_matrix_create_from_file(_TEST.out, "\n");
+    TEST_PORTING_ASSERT(string_matrix_count(matrix, "[ $PARAME. ] --test_report_variance=10") == 1);
+    TEST_PORTING_ASSERT(string_matrix_count(matrix, "[ VARIANCE ] 2 highest-variance of 2 tests") == 1);
+    TEST_PORTING_ASSERT(string_matrix_count(matrix, "      3  report_variance.") == 2);
+    string_matrix_destroy(matrix);
+}
+
+DEFINE_TEST(report_variance, limit, "--test_repeat=2", "--test_report_variance=1")
+{
+    TEST_PORTING_ASSERT(_TEST.rret == 0);
+
+    string_matrix_t* matrix = string_matrix_create_from_file(_TEST.out, "\n");
+    TEST_PORTING_ASSERT(string_matrix_count(matrix, "[ VARIANCE ] 1 highest-variance of 2 tests") == 1);
+    TEST_PORTING_ASSERT(string_matrix_count(matrix, "      2  report_variance.") == 1);
+    string_matrix_destroy(matrix);
+}
@@ -0,0 +1,60 @@
+#include "test.h"
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+///////////////////////////////////////////////////////////////////////////////
+// Watchpoint
+///////////////////////////////////////////////////////////////////////////////
+
+TEST(report_waiting, sleep)
+{
+#if defined(_WIN32)
+    Sleep(50);
+#else
+    usleep(50 * 1000);
+#endif
+}
+
+TEST(report_waiting, empty)
+{
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Verify
+///////////////////////////////////////////////////////////////////////////////
+
+DEFINE_TEST(report_waiting, default)
+{
+    TEST_PORTING_ASSERT(_TEST.rret == 0);
+
+    string_matrix_t* matrix = string_matrix_create_from_file(_TEST.out, "\n");
+    TEST_PORTING_ASSERT(string_matrix_count(matrix, "--test_report_waiting") == 0);
+    TEST_PORTING_ASSERT(string_matrix_count(matrix, "[ WAITING  ]") == 0);
+    string_matrix_destroy(matrix);
+}
+
+DEFINE_TEST(report_waiting, enable, "--test_report_waiting=50")
+{
+    TEST_PORTING_ASSERT(_TEST.rret == 0);
+
+    string_matrix_t* matrix = string_matrix_create_from_file(_TEST.out, "\n");
+    TEST_PORTING_ASSERT(string_matrix_count(matrix, "[ $PARAME. ] --test_report_waiting=50") == 1);
+#if defined(_WIN32) || defined(__linux__)
+    TEST_PORTING_ASSERT(string_matrix_count(matrix, "[ WAITING  ] report_waiting.sleep was on CPU for") == 1);
+#endif
+    TEST_PORTING_ASSERT(string_matrix_count(matrix, "[ WAITING  ] report_waiting.empty") == 0);
+    string_matrix_destroy(matrix);
+}
+
+DEFINE_TEST(report_waiting, disable, "--test_report_waiting=0")
+{
+    TEST_PORTING_ASSERT(_TEST.rret == 0);
+
+    string_matrix_t* matrix = string_matrix_create_from_file(_TEST.out, "\n");
+    TEST_PORTING_ASSERT(string_matrix_count(matrix, "--test_report_waiting") == 0);
+    TEST_PORTING_ASSERT(string_matrix_count(matrix, "[ WAITING  ]") == 0);
+    string_matrix_destroy(matrix);
+}
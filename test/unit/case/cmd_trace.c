@@ -0,0 +1,71 @@
+#include "test.h"
+#include <stdio.h>
+
+#define TRACE_FILE  "./cmd_trace.json"
+
+///////////////////////////////////////////////////////////////////////////////
+// Watchpoint
+///////////////////////////////////////////////////////////////////////////////
+
+TEST_FIXTURE_SETUP(trace)
+{
+}
+
+TEST_FIXTURE_TEARDOWN(trace)
+{
+}
+
+TEST_F(trace, 0)
+{
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Verify
+///////////////////////////////////////////////////////////////////////////////
+
+static void _on_before_all_test(int argc, char* argv[])
+{
+    (void)argc; (void)argv;
+}
+
+static void _on_after_all_test(void)
+{
+}
+
+static void _on_before_test(const char* fixture, const char* test_name)
+{
+    (void)fixture; (void)test_name;
+}
+
+DEFINE_TEST_SETUP(trace)
+{
+    _TEST.hook.before_all_test = _on_before_all_test;
+    _TEST.hook.after_all_test = _on_after_all_test;
+    _TEST.hook.before_test = _on_before_test;
+}
+
+DEFINE_TEST_TEARDOWN(trace)
+{
+}
+
+DEFINE_TEST_F(trace, 0, "--test_trace=" TRACE_FILE)
+{
+    TEST_PORTING_ASSERT(_TEST.rret == 0);
+
+    FILE* file = fopen(TRACE_FILE, "r");
+    TEST_PORTING_ASSERT(file != NULL);
+
+    string_matrix_t* matrix = string_matrix_create_from_file(file, "\n");
+    TEST_PORTING_ASSERT(strstr(string_matrix_access(matrix, 0, 0), "\"traceEvents\":[") != NULL);
+    TEST_PORTING_ASSERT(strcmp(string_matrix_access(matrix, matrix->line_sz - 1, 0), "]}") == 0);
+    TEST_PORTING_ASSERT(string_matrix_count(matrix, "{\"name\":\"trace.0\",\"cat\":\"case\",\"ph\":\"X\"") == 1);
+    TEST_PORTING_ASSERT(string_matrix_count(matrix, "{\"name\":\"setup\",\"cat\":\"stage\"") == 1);
+    TEST_PORTING_ASSERT(string_matrix_count(matrix, "{\"name\":\"body\",\"cat\":\"stage\"") == 1);
+    TEST_PORTING_ASSERT(string_matrix_count(matrix, "{\"name\":\"teardown\",\"cat\":\"stage\"") == 1);
+    TEST_PORTING_ASSERT(string_matrix_count(matrix, "{\"name\":\"before_test\",\"cat\":\"hook\"") == 1);
+    TEST_PORTING_ASSERT(string_matrix_count(matrix, "{\"name\":\"after_all_test\",\"cat\":\"hook\"") == 1);
+    string_matrix_destroy(matrix);
+
+    fclose(file);
+    remove(TRACE_FILE);
+}
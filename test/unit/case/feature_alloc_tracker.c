@@ -0,0 +1,172 @@
+#include "test.h"
+#include <stdlib.h>
+#include <time.h>
+
+static void* volatile s_leak;
+static void* volatile s_fixture_mem;
+
+///////////////////////////////////////////////////////////////////////////////
+// Watchpoint
+///////////////////////////////////////////////////////////////////////////////
+
+TEST_FIXTURE_SETUP(alloc)
+{
+    s_fixture_mem = malloc(32);
+}
+
+TEST_FIXTURE_TEARDOWN(alloc)
+{
+    free(s_fixture_mem);
+    s_fixture_mem = NULL;
+}
+
+TEST_F(alloc, clean)
+{
+    void* volatile p = malloc(100);
+    p = realloc(p, 4000);
+    free(p);
+
+    p = calloc(4, 8);
+    free(p);
+}
+
+TEST(alloc, leak)
+{
+    s_leak = malloc(64);
+}
+
+TEST(alloc, localtime)
+{
+    time_t t = time(NULL);
+    ASSERT_NE_PTR(localtime(&t), NULL);
+}
+
+TEST(alloc, ignore)
+{
+    CUTEST_ALLOC_IGNORE_BEGIN();
+    s_leak = malloc(64);
+    CUTEST_ALLOC_IGNORE_END();
+}
+
+TEST(alloc, ignore_freed)
+{
+    CUTEST_ALLOC_IGNORE_BEGIN();
+    void* volatile p = malloc(32);
+    CUTEST_ALLOC_IGNORE_END();
+    free(p);
+
+    s_leak = malloc(64);
+}
+
+TEST(alloc, fail)
+{
+    s_leak = malloc(64);
+    ASSERT_EQ_INT(1, 2);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Verify
+///////////////////////////////////////////////////////////////////////////////
+
+DEFINE_TEST_SETUP(alloc)
+{
+    test_capture_result();
+}
+
+DEFINE_TEST_TEARDOWN(alloc)
+{
+    free(s_leak);
+    s_leak = NULL;
+}
+
+DEFINE_TEST_F(alloc, clean, "--test_filter=alloc.clean")
+{
+    TEST_PORTING_ASSERT(_TEST.rret == 0);
+    TEST_PORTING_ASSERT(_TEST.result.status == 0);
+    TEST_PORTING_ASSERT(_TEST.result.alloc.allocs == 4);
+    TEST_PORTING_ASSERT(_TEST.result.alloc.bytes >= 32 + 100 + 4000 + 32);
+    TEST_PORTING_ASSERT(_TEST.result.alloc.peak >= 4000);
+    TEST_PORTING_ASSERT(_TEST.result.alloc.leaks == 0);
+}
+
+DEFINE_TEST_F(alloc, leak_warn, "--test_filter=alloc.leak", "--test_alloc_leaks=1")
+{
+    TEST_PORTING_ASSERT(_TEST.rret == 0);
+    TEST_PORTING_ASSERT(_TEST.result.status == 0);
+    TEST_PORTING_ASSERT(_TEST.result.alloc.leaks == 1);
+
+    string_matrix_t* matrix = string_matrix_create_from_file(_TEST.out, "\n");
+    TEST_PORTING_ASSERT(string_matrix_count(matrix, "[ $PARAME. ] --test_alloc_leaks=1") == 1);
+    TEST_PORTING_ASSERT(string_matrix_count(matrix, "[ WARNING  ] alloc.leak leaks 1 allocation (") == 1);
+    TEST_PORTING_ASSERT(string_matrix_count(matrix, "expected: no memory leak") == 0);
+    string_matrix_destroy(matrix);
+}
+
+DEFINE_TEST_F(alloc, leak_off, "--test_filter=alloc.leak", "--test_alloc_leaks=0")
+{
+    TEST_PORTING_ASSERT(_TEST.rret == 0);
+
+    string_matrix_t* matrix = string_matrix_create_from_file(_TEST.out, "\n");
+    TEST_PORTING_ASSERT(string_matrix_count(matrix, "[ $PARAME. ] --test_alloc_leaks=0") == 1);
+    TEST_PORTING_ASSERT(string_matrix_count(matrix, "leaks 1 allocation") == 0);
+    string_matrix_destroy(matrix);
+}
+
+DEFINE_TEST_F(alloc, leak, "--test_filter=alloc.leak")
+{
+    TEST_PORTING_ASSERT(_TEST.rret == 1);
+    TEST_PORTING_ASSERT(_TEST.result.status == CUTEST_RESULT_FAILURE);
+    TEST_PORTING_ASSERT(_TEST.result.alloc.leaks == 1);
+    TEST_PORTING_ASSERT(_TEST.result.alloc.leak_bytes >= 64);
+
+    string_matrix_t* matrix = string_matrix_create_from_file(_TEST.out, "\n");
+    TEST_PORTING_ASSERT(string_matrix_count(matrix, "--test_alloc_leaks") == 0);
+    TEST_PORTING_ASSERT(string_matrix_count(matrix, "alloc.leak:failure:") == 1);
+    TEST_PORTING_ASSERT(string_matrix_count(matrix, "expected: no memory leak") == 1);
+    TEST_PORTING_ASSERT(string_matrix_count(matrix, "actual: 1 allocation (") == 1);
+    string_matrix_destroy(matrix);
+}
+
+DEFINE_TEST_F(alloc, localtime, "--test_filter=alloc.localtime", "--test_alloc_leaks=2")
+{
+    /* Timezone loaded by libc on first use is not a leak. */
+    TEST_PORTING_ASSERT(_TEST.rret == 0);
+    TEST_PORTING_ASSERT(_TEST.result.alloc.leaks == 0);
+}
+
+DEFINE_TEST_F(alloc, ignore, "--test_filter=alloc.ignore", "--test_alloc_leaks=2")
+{
+    TEST_PORTING_ASSERT(_TEST.rret == 0);
+    TEST_PORTING_ASSERT(_TEST.result.alloc.allocs == 1);
+    TEST_PORTING_ASSERT(_TEST.result.alloc.leaks == 0);
+}
+
+DEFINE_TEST_F(alloc, ignore_freed, "--test_filter=alloc.ignore_freed", "--test_alloc_leaks=2")
+{
+    /* Freeing an ignored block does not hide the real leak. */
+    TEST_PORTING_ASSERT(_TEST.rret == 1);
+    TEST_PORTING_ASSERT(_TEST.result.status == CUTEST_RESULT_FAILURE);
+    TEST_PORTING_ASSERT(_TEST.result.alloc.allocs == 2);
+    TEST_PORTING_ASSERT(_TEST.result.alloc.leaks == 1);
+}
+
+DEFINE_TEST_F(alloc, fail, "--test_filter=alloc.fail", "--test_alloc_leaks=2")
+{
+    /* Leaks of a failed test are not reported again. */
+    TEST_PORTING_ASSERT(_TEST.rret == 1);
+    TEST_PORTING_ASSERT(_TEST.result.status == CUTEST_RESULT_FAILURE);
+    TEST_PORTING_ASSERT(_TEST.result.alloc.leaks == 1);
+
+    string_matrix_t* matrix = string_matrix_create_from_file(_TEST.out, "\n");
+    TEST_PORTING_ASSERT(string_matrix_count(matrix, "expected: no memory leak") == 0);
+    string_matrix_destroy(matrix);
+}
+
+DEFINE_TEST_F(alloc, usage, "--test_filter=alloc.clean", "--test_print_usage")
+{
+    TEST_PORTING_ASSERT(_TEST.rret == 0);
+
+    string_matrix_t* matrix = string_matrix_create_from_file(_TEST.out, "\n");
+    TEST_PORTING_ASSERT(string_matrix_count(matrix, "[ ALLOC    ] alloc.clean 4 allocs, ") == 1);
+    string_matrix_destroy(matrix);
+}
@@ -0,0 +1,88 @@
+#include "test.h"
+#include <stdint.h>
+
+static void* s_first;
+
+///////////////////////////////////////////////////////////////////////////////
+// Watchpoint
+///////////////////////////////////////////////////////////////////////////////
+
+TEST(arena, 0_alloc)
+{
+    size_t i;
+    char* p = cutest_arena_alloc(1);
+    ASSERT_NE_PTR(p, NULL);
+    s_first = p;
+
+    for (i = 0; i < 1000; i++)
+    {
+        char* q = cutest_arena_alloc(i + 1);
+        ASSERT_NE_PTR(q, NULL);
+        ASSERT_EQ_SIZE((uintptr_t)q % 16, (size_t)0);
+        memset(q, 0xaa, i + 1);
+    }
+}
+
+TEST(arena, 1_reset)
+{
+    /* Arena of previous test is freed. */
+    ASSERT_EQ_PTR(cutest_arena_alloc(1), s_first);
+}
+
+TEST(arena, 2_exhaust)
+{
+    ASSERT_NE_PTR(cutest_arena_alloc(512 * 1024), NULL);
+    ASSERT_EQ_PTR(cutest_arena_alloc(1024 * 1024), NULL);
+}
+
+TEST(arena, 3_overflow)
+{
+    ASSERT_EQ_PTR(cutest_arena_alloc(SIZE_MAX), NULL);
+    ASSERT_EQ_PTR(cutest_arena_alloc(SIZE_MAX - 3), NULL);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Verify
+///////////////////////////////////////////////////////////////////////////////
+
+DEFINE_TEST(arena, reset, "--test_filter=arena.0_alloc:arena.1_reset", "--test_print_usage")
+{
+    TEST_PORTING_ASSERT(_TEST.rret == 0);
+
+    string_matrix_t* matrix = string_matrix_create_from_file(_TEST.out, "\n");
+    TEST_PORTING_ASSERT(string_matrix_count(matrix, "[ ARENA    ] arena.0_alloc ") == 1);
+    TEST_PORTING_ASSERT(string_matrix_count(matrix, "[ ARENA    ] arena.1_reset 16 bytes") == 1);
+    string_matrix_destroy(matrix);
+}
+
+DEFINE_TEST(arena, size, "--test_filter=arena.2_exhaust", "--test_arena_size=1")
+{
+    TEST_PORTING_ASSERT(_TEST.rret == 0);
+
+    string_matrix_t* matrix = string_matrix_create_from_file(_TEST.out, "\n");
+    TEST_PORTING_ASSERT(string_matrix_count(matrix, "[ $PARAME. ] --test_arena_size=1") == 1);
+    string_matrix_destroy(matrix);
+}
+
+DEFINE_TEST(arena, overflow, "--test_filter=arena.3_overflow")
+{
+    TEST_PORTING_ASSERT(_TEST.rret == 0);
+}
+
+DEFINE_TEST(arena, size_too_large, "--test_filter=arena.0_alloc", "--test_arena_size=9000000000000")
+{
+    TEST_PORTING_ASSERT(_TEST.rret != 0);
+
+    string_matrix_t* matrix = string_matrix_create_from_file(_TEST.out, "\n");
+    TEST_PORTING_ASSERT(string_matrix_count(matrix, "[ RUN      ]") == 0);
+    string_matrix_destroy(matrix);
+}
+
+DEFINE_TEST(arena, huge_pages, "--test_filter=arena.0_alloc", "--test_arena_huge_pages")
+{
+    TEST_PORTING_ASSERT(_TEST.rret == 0);
+
+    string_matrix_t* matrix = string_matrix_create_from_file(_TEST.out, "\n");
+    TEST_PORTING_ASSERT(string_matrix_count(matrix, "[ $PARAME. ] --test_arena_huge_pages") == 1);
+    string_matrix_destroy(matrix);
+}
@@ -0,0 +1,229 @@
+#if defined(__linux__)
+#   define _GNU_SOURCE
+#   include <sched.h>
+#endif
+#include "test.h"
+#include <time.h>
+
+///////////////////////////////////////////////////////////////////////////////
+// Watchpoint
+///////////////////////////////////////////////////////////////////////////////
+
+static unsigned long s_setup_cnt = 0;
+static unsigned long s_body_cnt = 0;
+
+TEST_FIXTURE_SETUP(bench)
+{
+    s_setup_cnt++;
+}
+
+TEST_FIXTURE_TEARDOWN(bench)
+{
+}
+
+TEST_BENCH(bench, single)
+{
+    s_body_cnt++;
+}
+
+TEST_BENCH_MT(bench, scaling)
+{
+    volatile unsigned long v = 0;
+    v++;
+}
+
+TEST_BENCH(bench, throughput)
+{
+    cutest_bench_set_bytes(4096);
+    cutest_bench_set_items(16);
+}
+
+static void* s_main_tid = NULL;
+
+TEST_FIXTURE_SETUP(bench_mt)
+{
+    s_main_tid = cutest_porting_gettid();
+}
+
+TEST_FIXTURE_TEARDOWN(bench_mt)
+{
+}
+
+TEST_BENCH_MT(bench_mt, throughput)
+{
+    if (cutest_porting_gettid() == s_main_tid)
+    {
+        cutest_bench_set_items(16);
+    }
+    else
+    {
+        cutest_bench_set_bytes(4096);
+    }
+}
+
+static int s_bench_cpu = -1;
+
+TEST_BENCH(bench, pinned)
+{
+#if defined(__linux__)
+    s_bench_cpu = sched_getcpu();
+#endif
+}
+
+static unsigned long s_load_cnt = 0;
+
+TEST_LOAD(bench, load, 1000, 20)
+{
+    s_load_cnt++;
+}
+
+static unsigned long s_slow_cnt = 0;
+static clock_t s_slow_cpu_beg = 0;
+static clock_t s_slow_cpu_end = 0;
+
+TEST_LOAD(bench, slow_load, 20, 200)
+{
+    if (s_slow_cnt++ == 0)
+    {
+        s_slow_cpu_beg = clock();
+    }
+    s_slow_cpu_end = clock();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Verify
+///////////////////////////////////////////////////////////////////////////////
+
+DEFINE_TEST(bench, single, "--test_filter=bench.single", "--test_bench_min_time=1")
+{
+    TEST_PORTING_ASSERT(_TEST.rret == 0);
+    TEST_PORTING_ASSERT(s_setup_cnt == 1);
+    TEST_PORTING_ASSERT(s_body_cnt > 0);
+
+    string_matrix_t* matrix = string_matrix_create_from_file(_TEST.out, "\n");
+    TEST_PORTING_ASSERT(string_matrix_find(matrix, "[ BENCH    ]") != NULL);
+    TEST_PORTING_ASSERT(string_matrix_find(matrix, "[ LATENCY  ]") != NULL);
+    string_matrix_destroy(matrix);
+}
+
+DEFINE_TEST(bench, scaling, "--test_filter=bench.scaling", "--test_bench_min_time=1", "--test_bench_threads=4")
+{
+    TEST_PORTING_ASSERT(_TEST.rret == 0);
+
+    string_matrix_t* matrix = string_matrix_create_from_file(_TEST.out, "\n");
+    TEST_PORTING_ASSERT(string_matrix_find(matrix, "amdahl serial fraction") != NULL);
+    TEST_PORTING_ASSERT(string_matrix_find(matrix, "[ LATENCY  ]") != NULL);
+    string_matrix_destroy(matrix);
+}
+
+DEFINE_TEST(bench, throughput, "--test_filter=bench.throughput", "--test_bench_min_time=1")
+{
+    TEST_PORTING_ASSERT(_TEST.rret == 0);
+
+    string_matrix_t* matrix = string_matrix_create_from_file(_TEST.out, "\n");
+    TEST_PORTING_ASSERT(string_matrix_find(matrix, " GB/s") != NULL);
+    TEST_PORTING_ASSERT(string_matrix_find(matrix, " items/s") != NULL);
+    string_matrix_destroy(matrix);
+}
+
+DEFINE_TEST(bench, throughput_mt, "--test_filter=bench_mt.throughput", "--test_bench_min_time=1",
+    "--test_bench_threads=2")
+{
+    TEST_PORTING_ASSERT(_TEST.rret == 0);
+
+    string_matrix_t* matrix = string_matrix_create_from_file(_TEST.out, "\n");
+    TEST_PORTING_ASSERT(string_matrix_find(matrix, " items/s") != NULL);
+    /* Worker threads cannot set the throughput. */
+    TEST_PORTING_ASSERT(string_matrix_count(matrix, " GB/s") == 0);
+    string_matrix_destroy(matrix);
+}
+
+DEFINE_TEST(bench, hgrm, "--test_filter=bench.throughput", "--test_bench_min_time=1", "--test_bench_hgrm=.")
+{
+    TEST_PORTING_ASSERT(_TEST.rret == 0);
+
+    FILE* file = fopen("./bench.throughput.hgrm", "r");
+    TEST_PORTING_ASSERT(file != NULL);
+
+    string_matrix_t* matrix = string_matrix_create_from_file(file, "\n");
+    TEST_PORTING_ASSERT(strstr(string_matrix_access(matrix, 0, 0), "Percentile") != NULL);
+    TEST_PORTING_ASSERT(strstr(string_matrix_access(matrix, matrix->line_sz - 1, 0), "#[Buckets") != NULL);
+    string_matrix_destroy(matrix);
+
+    fclose(file);
+    remove("./bench.throughput.hgrm");
+}
+
+DEFINE_TEST(bench, load, "--test_filter=bench.load")
+{
+    TEST_PORTING_ASSERT(_TEST.rret == 0);
+    TEST_PORTING_ASSERT(s_load_cnt > 0 && s_load_cnt <= 20);
+
+    string_matrix_t* matrix = string_matrix_create_from_file(_TEST.out, "\n");
+    TEST_PORTING_ASSERT(string_matrix_find(matrix, "[ LOAD     ] target 1000/s") != NULL);
+    TEST_PORTING_ASSERT(string_matrix_find(matrix, "[ LATENCY  ]") != NULL);
+    string_matrix_destroy(matrix);
+}
+
+DEFINE_TEST(bench, slow_load, "--test_filter=bench.slow_load")
+{
+    TEST_PORTING_ASSERT(_TEST.rret == 0);
+    TEST_PORTING_ASSERT(s_slow_cnt == 4);
+
+    string_matrix_t* matrix = string_matrix_create_from_file(_TEST.out, "\n");
+    const char* line = string_matrix_find(matrix, "[ LOAD     ] target 20/s");
+    TEST_PORTING_ASSERT(line != NULL);
+
+    /* The rate is measured over the whole 200 ms window. */
+    double achieved = 0;
+    const char* pos = strstr(line, "achieved ");
+    TEST_PORTING_ASSERT(pos != NULL && sscanf(pos, "achieved %lf/s", &achieved) == 1);
+    TEST_PORTING_ASSERT(achieved > 15.0 && achieved <= 20.0);
+    string_matrix_destroy(matrix);
+
+#if !defined(_WIN32)
+    /* Waiting between calls sleeps instead of spinning. */
+    TEST_PORTING_ASSERT(s_slow_cpu_end - s_slow_cpu_beg < CLOCKS_PER_SEC / 20);
+#endif
+}
+
+DEFINE_TEST(bench, environment, "--test_filter=bench.pinned", "--test_bench_min_time=1",
+    "--test_bench_warmup=1", "--test_bench_cpu=0")
+{
+    TEST_PORTING_ASSERT(_TEST.rret == 0);
+
+    string_matrix_t* matrix = string_matrix_create_from_file(_TEST.out, "\n");
+    TEST_PORTING_ASSERT(string_matrix_find(matrix, "--test_bench_warmup=1") != NULL);
+    TEST_PORTING_ASSERT(string_matrix_find(matrix, "--test_bench_cpu=0") != NULL);
+
+#if defined(__linux__)
+    char buf[4096] = { 0 };
+    FILE* cpuinfo = fopen("/proc/cpuinfo", "r");
+    if (cpuinfo != NULL)
+    {
+        (void)!fread(buf, 1, sizeof(buf) - 1, cpuinfo);
+        fclose(cpuinfo);
+    }
+    TEST_PORTING_ASSERT(string_matrix_count(matrix, "[ ENV      ] cpu: ") == (strstr(buf, "model name") != NULL ? 1u : 0u));
+    TEST_PORTING_ASSERT(string_matrix_count(matrix, "[ ENV      ] load average: ") == 1);
+#endif
+
+    /* Either the body runs on cpu0, or cutest says it cannot pin. */
+    if (string_matrix_count(matrix, "[ WARNING  ] cannot pin to cpu0.") == 0)
+    {
+#if defined(__linux__)
+        TEST_PORTING_ASSERT(s_bench_cpu == 0);
+#endif
+    }
+    string_matrix_destroy(matrix);
+}
+
+DEFINE_TEST(bench, environment_bad_cpu, "--test_filter=bench.pinned", "--test_bench_min_time=1",
+    "--test_bench_cpu=100000")
+{
+    TEST_PORTING_ASSERT(_TEST.rret == 0);
+
+    string_matrix_t* matrix = string_matrix_create_from_file(_TEST.out, "\n");
+    TEST_PORTING_ASSERT(string_matrix_count(matrix, "[ WARNING  ] cannot pin to cpu100000.") == 1);
+    string_matrix_destroy(matrix);
+}
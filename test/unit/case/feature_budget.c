@@ -0,0 +1,106 @@
+#include "test.h"
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+static unsigned s_run_cnt = 0;
+
+static void _sleep_ms(unsigned ms)
+{
+#if defined(_WIN32)
+    Sleep(ms);
+#else
+    usleep(ms * 1000);
+#endif
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Watchpoint
+///////////////////////////////////////////////////////////////////////////////
+
+TEST_FIXTURE_SETUP(budget)
+{
+}
+
+TEST_FIXTURE_TEARDOWN(budget)
+{
+}
+
+TEST_BUDGET(budget, fast, 1000)
+{
+    s_run_cnt++;
+}
+
+TEST_BUDGET(budget, slow, 1)
+{
+    s_run_cnt++;
+    _sleep_ms(5);
+}
+
+TEST(budget, block_fast)
+{
+    ASSERT_ELAPSED_LT_NS(1000 * 1000 * 1000)
+    {
+        s_run_cnt++;
+    }
+}
+
+TEST(budget, block_slow)
+{
+    ASSERT_ELAPSED_LT_NS(1000)
+    {
+        s_run_cnt++;
+        _sleep_ms(2);
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Verify
+///////////////////////////////////////////////////////////////////////////////
+
+DEFINE_TEST_SETUP(budget)
+{
+    s_run_cnt = 0;
+}
+
+DEFINE_TEST_TEARDOWN(budget)
+{
+}
+
+DEFINE_TEST_F(budget, fast, "--test_filter=budget.*fast")
+{
+    TEST_PORTING_ASSERT(_TEST.rret == 0);
+    TEST_PORTING_ASSERT(s_run_cnt == 2);
+}
+
+DEFINE_TEST_F(budget, slow, "--test_filter=budget.slow")
+{
+    TEST_PORTING_ASSERT(_TEST.rret == 1);
+    TEST_PORTING_ASSERT(s_run_cnt == 3);
+
+    string_matrix_t* matrix = string_matrix_create_from_file(_TEST.out, "\n");
+    TEST_PORTING_ASSERT(string_matrix_count(matrix, "budget.slow:failure:") == 1);
+    TEST_PORTING_ASSERT(string_matrix_count(matrix, "expected: body < 1 ms (+10%)") == 1);
+    TEST_PORTING_ASSERT(string_matrix_count(matrix, "best of 3 attempts") == 1);
+    string_matrix_destroy(matrix);
+}
+
+DEFINE_TEST_F(budget, block_slow, "--test_filter=budget.block_slow", "--test_budget_retry=0")
+{
+    TEST_PORTING_ASSERT(_TEST.rret == 1);
+    TEST_PORTING_ASSERT(s_run_cnt == 1);
+
+    string_matrix_t* matrix = string_matrix_create_from_file(_TEST.out, "\n");
+    TEST_PORTING_ASSERT(string_matrix_count(matrix, "[ $PARAME. ] --test_budget_retry=0") == 1);
+    TEST_PORTING_ASSERT(string_matrix_count(matrix, "expected: elapsed < `1000' ns (+10%)") == 1);
+    TEST_PORTING_ASSERT(string_matrix_count(matrix, "best of 1 attempts") == 1);
+    string_matrix_destroy(matrix);
+}
+
+DEFINE_TEST_F(budget, tolerance, "--test_filter=budget.slow", "--test_budget_tolerance=100000")
+{
+    TEST_PORTING_ASSERT(_TEST.rret == 0);
+    TEST_PORTING_ASSERT(s_run_cnt == 1);
+}
@@ -0,0 +1,122 @@
+#include "test.h"
+#include <stdint.h>
+#if defined(__linux__)
+#include <sys/wait.h>
+#include <signal.h>
+#include <unistd.h>
+#endif
+
+///////////////////////////////////////////////////////////////////////////////
+// Watchpoint
+///////////////////////////////////////////////////////////////////////////////
+
+TEST(guarded, end)
+{
+    char* buf = cutest_guarded_alloc(10, CUTEST_GUARD_END);
+    if (buf == NULL)
+    {
+        cutest_skip_test();
+        return;
+    }
+    ASSERT_EQ_SIZE((uintptr_t)(buf + 10) % 4096, (size_t)0);
+
+    memset(buf, 0xaa, 10);
+    ASSERT_EQ_INT(buf[9], (char)0xaa);
+    cutest_guarded_free(buf);
+}
+
+TEST(guarded, start)
+{
+    char* buf = cutest_guarded_alloc(10000, CUTEST_GUARD_START);
+    if (buf == NULL)
+    {
+        cutest_skip_test();
+        return;
+    }
+    ASSERT_EQ_SIZE((uintptr_t)buf % 4096, (size_t)0);
+
+    memset(buf, 0xaa, 10000);
+    cutest_guarded_free(buf);
+}
+
+TEST(guarded, zero)
+{
+    void* buf = cutest_guarded_alloc(0, CUTEST_GUARD_END);
+    cutest_guarded_free(buf);
+    cutest_guarded_free(NULL);
+}
+
+TEST(guarded, huge)
+{
+    ASSERT_EQ_PTR(cutest_guarded_alloc(SIZE_MAX, CUTEST_GUARD_END), NULL);
+    ASSERT_EQ_PTR(cutest_guarded_alloc(SIZE_MAX - 4096, CUTEST_GUARD_START), NULL);
+}
+
+TEST(guarded, fill)
+{
+    size_t i;
+    if (cutest_guarded_alloc(1, CUTEST_GUARD_END) == NULL)
+    {
+        cutest_skip_test();
+        return;
+    }
+    /* Never freed, so the table is only empty if cutest frees them. */
+    for (i = 1; i < CUTEST_GUARDED_MAX; i++)
+    {
+        ASSERT_NE_PTR(cutest_guarded_alloc(1, CUTEST_GUARD_END), NULL);
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Verify
+///////////////////////////////////////////////////////////////////////////////
+
+DEFINE_TEST(guarded, alloc)
+{
+    TEST_PORTING_ASSERT(_TEST.rret == 0);
+}
+
+DEFINE_TEST(guarded, release, "--test_filter=guarded.fill", "--test_repeat=2")
+{
+    TEST_PORTING_ASSERT(_TEST.rret == 0);
+
+    string_matrix_t* matrix = string_matrix_create_from_file(_TEST.out, "\n");
+    TEST_PORTING_ASSERT(string_matrix_count(matrix, "[   SKIP   ] guarded.fill") != 0
+        || string_matrix_count(matrix, "[ WARNING  ] guarded.fill leaks " TEST_STRINGIFY(CUTEST_GUARDED_MAX) " guarded buffers.") == 2);
+    string_matrix_destroy(matrix);
+}
+
+#if defined(__linux__)
+
+/**
+ * @brief Access \p off of guarded buffer in child process.
+ * @return Signal that kills child, 0 if child exits.
+ */
+static int _access_in_child(cutest_guard_t guard, long off)
+{
+    char* buf = cutest_guarded_alloc(10, guard);
+    TEST_PORTING_ASSERT(buf != NULL);
+
+    pid_t pid = fork();
+    TEST_PORTING_ASSERT(pid >= 0);
+    if (pid == 0)
+    {
+        ((volatile char*)buf)[off] = 1;
+        _exit(0);
+    }
+
+    int status = 0;
+    TEST_PORTING_ASSERT(waitpid(pid, &status, 0) == pid);
+    cutest_guarded_free(buf);
+    return WIFSIGNALED(status) ? WTERMSIG(status) : 0;
+}
+
+DEFINE_TEST(guarded, fault)
+{
+    TEST_PORTING_ASSERT(_access_in_child(CUTEST_GUARD_END, 9) == 0);
+    TEST_PORTING_ASSERT(_access_in_child(CUTEST_GUARD_END, 10) == SIGSEGV);
+    TEST_PORTING_ASSERT(_access_in_child(CUTEST_GUARD_START, 0) == 0);
+    TEST_PORTING_ASSERT(_access_in_child(CUTEST_GUARD_START, -1) == SIGSEGV);
+}
+
+#endif
@@ -0,0 +1,98 @@
+#include "test.h"
+
+static cutest_result_t s_before;
+static char s_before_name[64];
+static int s_fail_line;
+
+///////////////////////////////////////////////////////////////////////////////
+// Watchpoint
+///////////////////////////////////////////////////////////////////////////////
+
+TEST_FIXTURE_SETUP(hook_ex)
+{
+}
+
+TEST_FIXTURE_TEARDOWN(hook_ex)
+{
+}
+
+static const int s_pass_line = __LINE__ + 1;
+TEST(hook_ex, pass)
+{
+    ASSERT_EQ_INT(1, 1);
+    ASSERT_EQ_INT(2, 2);
+}
+
+TEST(hook_ex, fail)
+{
+    ASSERT_EQ_INT(1, 1);
+    s_fail_line = __LINE__ + 1;
+    ASSERT_EQ_INT(1, 2);
+}
+
+TEST_PARAMETERIZED_DEFINE(hook_ex, param, int, 10, 20);
+TEST_P(hook_ex, param)
+{
+    TEST_PARAMETERIZED_SUPPRESS_UNUSED;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Verify
+///////////////////////////////////////////////////////////////////////////////
+
+static void _on_before_test(const cutest_result_t* result)
+{
+    s_before = *result;
+    snprintf(s_before_name, sizeof(s_before_name), "%s", result->full_name);
+}
+
+DEFINE_TEST_SETUP(hook_ex)
+{
+    test_capture_result();
+    _TEST.hook_ex.before_test = _on_before_test;
+    memset(&s_before, 0, sizeof(s_before));
+}
+
+DEFINE_TEST_TEARDOWN(hook_ex)
+{
+}
+
+DEFINE_TEST_F(hook_ex, pass, "--test_filter=hook_ex.pass")
+{
+    TEST_PORTING_ASSERT(_TEST.rret == 0);
+    TEST_PORTING_ASSERT(_TEST.result_cnt == 1);
+
+    TEST_PORTING_ASSERT(s_before.version == CUTEST_HOOK_EX_VERSION);
+    ASSERT_STRING_EQ(s_before_name, "hook_ex.pass");
+    ASSERT_STRING_EQ(_TEST.result.fixture_name, "hook_ex");
+    ASSERT_STRING_EQ(_TEST.result.case_name, "pass");
+    TEST_PORTING_ASSERT(strstr(_TEST.result.file, "feature_hook_ex.c") != NULL);
+    TEST_PORTING_ASSERT(_TEST.result.line == s_pass_line);
+    TEST_PORTING_ASSERT(_TEST.result.param_type == NULL);
+
+    TEST_PORTING_ASSERT(_TEST.result.status == 0);
+    TEST_PORTING_ASSERT(_TEST.result.assertions == 2);
+    TEST_PORTING_ASSERT(_TEST.result.failure_file == NULL);
+    TEST_PORTING_ASSERT(_TEST.result.elapsed_ns >= _TEST.result.body_ns);
+}
+
+DEFINE_TEST_F(hook_ex, fail, "--test_filter=hook_ex.fail")
+{
+    TEST_PORTING_ASSERT(_TEST.rret == 1);
+    TEST_PORTING_ASSERT(_TEST.result_cnt == 1);
+
+    TEST_PORTING_ASSERT(_TEST.result.status == CUTEST_RESULT_FAILURE);
+    TEST_PORTING_ASSERT(_TEST.result.assertions == 2);
+    TEST_PORTING_ASSERT(strstr(_TEST.result.failure_file, "feature_hook_ex.c") != NULL);
+    TEST_PORTING_ASSERT(_TEST.result.failure_line == s_fail_line);
+}
+
+DEFINE_TEST_F(hook_ex, param, "--test_filter=hook_ex.param*")
+{
+    TEST_PORTING_ASSERT(_TEST.rret == 0);
+    TEST_PORTING_ASSERT(_TEST.result_cnt == 2);
+
+    ASSERT_STRING_EQ(_TEST.result.param_type, "int");
+    TEST_PORTING_ASSERT(_TEST.result.param_idx == 1);
+    ASSERT_STRING_EQ(_TEST.result_name, "hook_ex.param/1");
+}
@@ -0,0 +1,165 @@
+#include "test.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#define NS_PER_SEC  1000000000ULL
+
+static char s_path[4096];
+
+static int _create_file(void)
+{
+    snprintf(s_path, sizeof(s_path), "%s/data", cutest_tmpdir());
+    int fd = open(s_path, O_CREAT | O_WRONLY, 0600);
+    if (fd >= 0)
+    {
+        ASSERT_EQ_INT((int)write(fd, "0123456789", 10), 10);
+        close(fd);
+    }
+    return fd;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Watchpoint
+///////////////////////////////////////////////////////////////////////////////
+
+TEST(io_fault, eio)
+{
+    char buf[16];
+    cutest_io_fault_t fault;
+    memset(&fault, 0, sizeof(fault));
+    ASSERT_GE_INT(_create_file(), 0);
+
+    fault.ops = CUTEST_IO_READ;
+    fault.path = cutest_tmpdir();
+    fault.eio_pct = 100;
+    ASSERT_EQ_INT(cutest_io_fault_set(&fault), 0);
+
+    /* Files out of path are not affected. */
+    int fd = open("/dev/zero", O_RDONLY);
+    ASSERT_GE_INT(fd, 0);
+    ASSERT_EQ_INT((int)read(fd, buf, sizeof(buf)), (int)sizeof(buf));
+    close(fd);
+
+    fd = open(s_path, O_RDONLY);
+    ASSERT_GE_INT(fd, 0);
+    ASSERT_EQ_INT((int)read(fd, buf, sizeof(buf)), -1);
+    ASSERT_EQ_INT(errno, EIO);
+    close(fd);
+}
+
+TEST(io_fault, eintr)
+{
+    cutest_io_fault_t fault;
+    memset(&fault, 0, sizeof(fault));
+    fault.ops = CUTEST_IO_OPEN;
+    fault.eintr_pct = 100;
+    ASSERT_EQ_INT(cutest_io_fault_set(&fault), 0);
+
+    ASSERT_EQ_INT(open("/dev/null", O_RDONLY), -1);
+    ASSERT_EQ_INT(errno, EINTR);
+}
+
+TEST(io_fault, short)
+{
+    char buf[100];
+    cutest_io_fault_t fault;
+    memset(&fault, 0, sizeof(fault));
+    memset(buf, 0, sizeof(buf));
+    fault.ops = CUTEST_IO_WRITE;
+    fault.short_pct = 100;
+    fault.seed = 1;
+    ASSERT_EQ_INT(cutest_io_fault_set(&fault), 0);
+
+    int fd = open("/dev/null", O_WRONLY);
+    ASSERT_GE_INT(fd, 0);
+    int n = (int)write(fd, buf, sizeof(buf));
+    close(fd);
+    ASSERT_GT_INT(n, 0);
+    ASSERT_LT_INT(n, (int)sizeof(buf));
+}
+
+TEST(io_fault, latency)
+{
+    cutest_io_fault_t fault;
+    memset(&fault, 0, sizeof(fault));
+    ASSERT_GE_INT(_create_file(), 0);
+
+    fault.ops = CUTEST_IO_FSYNC;
+    fault.latency_us = 1000000;
+    ASSERT_EQ_INT(cutest_io_fault_set(&fault), 0);
+
+    int fd = open(s_path, O_WRONLY);
+    ASSERT_GE_INT(fd, 0);
+    unsigned long long beg = cutest_now();
+    ASSERT_EQ_INT(fsync(fd), 0);
+    ASSERT_EQ_ULONGLONG(cutest_now() - beg, 1 * NS_PER_SEC);
+    close(fd);
+}
+
+TEST(io_fault, 0_leave)
+{
+    cutest_io_fault_t fault;
+    memset(&fault, 0, sizeof(fault));
+    fault.ops = CUTEST_IO_OPEN;
+    fault.eio_pct = 100;
+    ASSERT_EQ_INT(cutest_io_fault_set(&fault), 0);
+}
+
+TEST(io_fault, 1_clean)
+{
+    int fd = open("/dev/null", O_RDONLY);
+    ASSERT_GE_INT(fd, 0);
+    close(fd);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Verify
+///////////////////////////////////////////////////////////////////////////////
+
+DEFINE_TEST(io_fault, eio, "--test_filter=io_fault.eio")
+{
+    TEST_PORTING_ASSERT(_TEST.rret == 0);
+
+    string_matrix_t* matrix = string_matrix_create_from_file(_TEST.out, "\n");
+    TEST_PORTING_ASSERT(string_matrix_count(matrix, "[ IO FAULT ] io_fault.eio 0 delayed, 0 short, 0 eintr, 1 eio") == 1);
+    string_matrix_destroy(matrix);
+}
+
+DEFINE_TEST(io_fault, eintr, "--test_filter=io_fault.eintr")
+{
+    TEST_PORTING_ASSERT(_TEST.rret == 0);
+
+    string_matrix_t* matrix = string_matrix_create_from_file(_TEST.out, "\n");
+    TEST_PORTING_ASSERT(string_matrix_count(matrix, "[ IO FAULT ] io_fault.eintr 0 delayed, 0 short, 1 eintr, 0 eio") == 1);
+    string_matrix_destroy(matrix);
+}
+
+DEFINE_TEST(io_fault, short, "--test_filter=io_fault.short")
+{
+    TEST_PORTING_ASSERT(_TEST.rret == 0);
+
+    string_matrix_t* matrix = string_matrix_create_from_file(_TEST.out, "\n");
+    TEST_PORTING_ASSERT(string_matrix_count(matrix, "[ IO FAULT ] io_fault.short 0 delayed, 1 short, 0 eintr, 0 eio") == 1);
+    string_matrix_destroy(matrix);
+}
+
+DEFINE_TEST(io_fault, latency, "--test_filter=io_fault.latency", "--test_virtual_time")
+{
+    TEST_PORTING_ASSERT(_TEST.rret == 0);
+
+    string_matrix_t* matrix = string_matrix_create_from_file(_TEST.out, "\n");
+    TEST_PORTING_ASSERT(string_matrix_count(matrix, "[ IO FAULT ] io_fault.latency 1 delayed, 0 short, 0 eintr, 0 eio") == 1);
+    string_matrix_destroy(matrix);
+}
+
+DEFINE_TEST(io_fault, per_test, "--test_filter=io_fault.0_leave:io_fault.1_clean")
+{
+    TEST_PORTING_ASSERT(_TEST.rret == 0);
+
+    string_matrix_t* matrix = string_matrix_create_from_file(_TEST.out, "\n");
+    TEST_PORTING_ASSERT(string_matrix_count(matrix, "[ IO FAULT ]") == 1);
+    TEST_PORTING_ASSERT(string_matrix_count(matrix, "[       OK ] io_fault.1_clean") == 1);
+    string_matrix_destroy(matrix);
+}
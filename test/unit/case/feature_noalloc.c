@@ -0,0 +1,95 @@
+#include "test.h"
+#include <stdlib.h>
+
+static void* volatile s_mem;
+
+///////////////////////////////////////////////////////////////////////////////
+// Watchpoint
+///////////////////////////////////////////////////////////////////////////////
+
+TEST_FIXTURE_SETUP(noalloc)
+{
+    s_mem = malloc(16);
+}
+
+TEST_FIXTURE_TEARDOWN(noalloc)
+{
+    free(s_mem);
+    s_mem = NULL;
+}
+
+TEST(noalloc, scope_pass)
+{
+    void* volatile p = malloc(8);
+
+    CUTEST_NO_ALLOC_BEGIN();
+    CUTEST_NO_ALLOC_BEGIN();
+    ASSERT_EQ_INT(1, 1);
+    CUTEST_NO_ALLOC_END();
+    CUTEST_NO_ALLOC_END();
+
+    free(p);
+}
+
+TEST(noalloc, scope_fail)
+{
+    void* volatile p;
+
+    CUTEST_NO_ALLOC_BEGIN();
+    p = malloc(24);
+    free(p);
+    p = calloc(2, 8);
+    free(p);
+    CUTEST_NO_ALLOC_END();
+}
+
+TEST_NOALLOC(noalloc, body_pass)
+{
+    ASSERT_NE_PTR(s_mem, NULL);
+}
+
+TEST_NOALLOC(noalloc, body_fail)
+{
+    void* volatile p = realloc(NULL, 40);
+    free(p);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Verify
+///////////////////////////////////////////////////////////////////////////////
+
+DEFINE_TEST(noalloc, scope_pass, "--test_filter=noalloc.scope_pass")
+{
+    TEST_PORTING_ASSERT(_TEST.rret == 0);
+
+    string_matrix_t* matrix = string_matrix_create_from_file(_TEST.out, "\n");
+    TEST_PORTING_ASSERT(string_matrix_count(matrix, "expected: no allocation") == 0);
+    string_matrix_destroy(matrix);
+}
+
+DEFINE_TEST(noalloc, scope_fail, "--test_filter=noalloc.scope_fail")
+{
+    TEST_PORTING_ASSERT(_TEST.rret == 1);
+
+    string_matrix_t* matrix = string_matrix_create_from_file(_TEST.out, "\n");
+    TEST_PORTING_ASSERT(string_matrix_count(matrix, "feature_noalloc.c:43:failure:") == 1);
+    TEST_PORTING_ASSERT(string_matrix_count(matrix, "expected: no allocation") == 1);
+    TEST_PORTING_ASSERT(string_matrix_count(matrix, "actual: 2 allocations, first of 24 bytes at:") == 1);
+    TEST_PORTING_ASSERT(string_matrix_count(matrix, "                #0 ") == 1);
+    string_matrix_destroy(matrix);
+}
+
+DEFINE_TEST(noalloc, body_pass, "--test_filter=noalloc.body_pass")
+{
+    TEST_PORTING_ASSERT(_TEST.rret == 0);
+}
+
+DEFINE_TEST(noalloc, body_fail, "--test_filter=noalloc.body_fail")
+{
+    TEST_PORTING_ASSERT(_TEST.rret == 1);
+
+    string_matrix_t* matrix = string_matrix_create_from_file(_TEST.out, "\n");
+    TEST_PORTING_ASSERT(string_matrix_count(matrix, "feature_noalloc.c:51:failure:") == 1);
+    TEST_PORTING_ASSERT(string_matrix_count(matrix, "actual: 1 allocation, first of 40 bytes at:") == 1);
+    string_matrix_destroy(matrix);
+}
@@ -0,0 +1,91 @@
+#include "test.h"
+
+#define TRACE_FILE  "./feature_timer.json"
+
+///////////////////////////////////////////////////////////////////////////////
+// Watchpoint
+///////////////////////////////////////////////////////////////////////////////
+
+TEST(timer, region)
+{
+    int i;
+    for (i = 0; i < 3; i++)
+    {
+        CUTEST_TIMER_BEGIN("parse");
+        CUTEST_TIMER_END("parse");
+    }
+
+    CUTEST_TIMER_BEGIN("query");
+    CUTEST_TIMER_BEGIN("nested");
+    CUTEST_TIMER_END("nested");
+    CUTEST_TIMER_END("query");
+}
+
+TEST(timer, unmatched)
+{
+    CUTEST_TIMER_END("none");
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Verify
+///////////////////////////////////////////////////////////////////////////////
+
+DEFINE_TEST(timer, region, "--test_filter=timer.region")
+{
+    TEST_PORTING_ASSERT(_TEST.rret == 0);
+
+    string_matrix_t* matrix = string_matrix_create_from_file(_TEST.out, "\n");
+    TEST_PORTING_ASSERT(string_matrix_count(matrix, "[ TIMER    ]") == 3);
+    TEST_PORTING_ASSERT(string_matrix_count(matrix, "[ TIMER    ] parse: 3 calls,") == 1);
+    TEST_PORTING_ASSERT(string_matrix_count(matrix, "[ TIMER    ] query: 1 calls,") == 1);
+    TEST_PORTING_ASSERT(string_matrix_count(matrix, "[ TIMER    ] nested: 1 calls,") == 1);
+    string_matrix_destroy(matrix);
+}
+
+DEFINE_TEST(timer, unmatched, "--test_filter=timer.unmatched")
+{
+    TEST_PORTING_ASSERT(_TEST.rret == 0);
+
+    string_matrix_t* matrix = string_matrix_create_from_file(_TEST.out, "\n");
+    TEST_PORTING_ASSERT(string_matrix_count(matrix, "[ WARNING  ] timing region `none' is not started.") == 1);
+    TEST_PORTING_ASSERT(string_matrix_count(matrix, "[ TIMER    ]") == 0);
+    string_matrix_destroy(matrix);
+}
+
+static void _before_all_test(int argc, char* argv[])
+{
+    (void)argc; (void)argv;
+    CUTEST_TIMER_BEGIN("hook");
+    CUTEST_TIMER_END("hook");
+}
+
+DEFINE_TEST_SETUP(timer)
+{
+    _TEST.hook.before_all_test = _before_all_test;
+}
+
+DEFINE_TEST_TEARDOWN(timer)
+{
+}
+
+DEFINE_TEST_F(timer, hook, "--test_filter=timer.region")
+{
+    /* Timers outside of a test must not crash. */
+    TEST_PORTING_ASSERT(_TEST.rret == 0);
+}
+
+DEFINE_TEST(timer, trace, "--test_filter=timer.region", "--test_trace=" TRACE_FILE)
+{
+    TEST_PORTING_ASSERT(_TEST.rret == 0);
+
+    FILE* file = fopen(TRACE_FILE, "r");
+    TEST_PORTING_ASSERT(file != NULL);
+
+    string_matrix_t* matrix = string_matrix_create_from_file(file, "\n");
+    TEST_PORTING_ASSERT(string_matrix_count(matrix, "{\"name\":\"parse\",\"cat\":\"timer\"") == 3);
+    TEST_PORTING_ASSERT(string_matrix_count(matrix, "{\"name\":\"query\",\"cat\":\"timer\"") == 1);
+    string_matrix_destroy(matrix);
+
+    fclose(file);
+    remove(TRACE_FILE);
+}
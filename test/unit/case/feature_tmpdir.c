@@ -0,0 +1,127 @@
+#include "test.h"
+#include <fcntl.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+static char s_path[4096];
+static char s_taken[2][4096];
+
+///////////////////////////////////////////////////////////////////////////////
+// Watchpoint
+///////////////////////////////////////////////////////////////////////////////
+
+TEST(tmpdir, create)
+{
+    char buf[4096];
+    const char* path = cutest_tmpdir();
+    ASSERT_NE_PTR(path, NULL);
+    ASSERT_EQ_PTR(cutest_tmpdir(), path);
+    snprintf(s_path, sizeof(s_path), "%s", path);
+
+    snprintf(buf, sizeof(buf), "%s/a", path);
+    ASSERT_EQ_INT(mkdir(buf, 0700), 0);
+
+    snprintf(buf, sizeof(buf), "%s/a/b.txt", path);
+    int fd = open(buf, O_CREAT | O_WRONLY, 0600);
+    ASSERT_GE_INT(fd, 0);
+    ASSERT_EQ_INT((int)write(fd, "cutest", 6), 6);
+    close(fd);
+}
+
+/* Take the next two names, so the next test has to skip them. */
+TEST(tmpdir, collide_0)
+{
+    const char* path = cutest_tmpdir();
+    ASSERT_NE_PTR(path, NULL);
+
+    const char* seq = strrchr(path, '-') + 1;
+    int i, len = (int)(seq - path);
+    for (i = 0; i < 2; i++)
+    {
+        snprintf(s_taken[i], sizeof(s_taken[i]), "%.*s%lu", len, path, strtoul(seq, NULL, 10) + 1 + i);
+        ASSERT_EQ_INT(mkdir(s_taken[i], 0700), 0);
+    }
+}
+
+TEST(tmpdir, collide_1)
+{
+    const char* path = cutest_tmpdir();
+    ASSERT_NE_PTR(path, NULL);
+    snprintf(s_path, sizeof(s_path), "%s", path);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Verify
+///////////////////////////////////////////////////////////////////////////////
+
+DEFINE_TEST(tmpdir, remove, "--test_filter=tmpdir.create")
+{
+    TEST_PORTING_ASSERT(_TEST.rret == 0);
+    TEST_PORTING_ASSERT(strncmp(s_path, "/dev/shm/cutest-", 16) == 0
+        || strncmp(s_path, "/tmp/cutest-", 12) == 0);
+    TEST_PORTING_ASSERT(access(s_path, F_OK) != 0);
+}
+
+DEFINE_TEST(tmpdir, root, "--test_filter=tmpdir.create", "--test_tmpdir_root=/tmp")
+{
+    TEST_PORTING_ASSERT(_TEST.rret == 0);
+    TEST_PORTING_ASSERT(strncmp(s_path, "/tmp/cutest-", 12) == 0);
+    TEST_PORTING_ASSERT(access(s_path, F_OK) != 0);
+
+    string_matrix_t* matrix = string_matrix_create_from_file(_TEST.out, "\n");
+    TEST_PORTING_ASSERT(string_matrix_count(matrix, "[ $PARAME. ] --test_tmpdir_root=/tmp") == 1);
+    string_matrix_destroy(matrix);
+}
+
+DEFINE_TEST(tmpdir, collision, "--test_filter=tmpdir.collide_*", "--test_tmpdir_root=/tmp")
+{
+    TEST_PORTING_ASSERT(_TEST.rret == 0);
+    TEST_PORTING_ASSERT(strcmp(s_path, s_taken[0]) != 0);
+    TEST_PORTING_ASSERT(strcmp(s_path, s_taken[1]) != 0);
+    TEST_PORTING_ASSERT(access(s_path, F_OK) != 0);
+
+    /* Directories cutest did not create are left alone. */
+    TEST_PORTING_ASSERT(rmdir(s_taken[0]) == 0);
+    TEST_PORTING_ASSERT(rmdir(s_taken[1]) == 0);
+}
+
+/* Another process running the same test gets its own directory. */
+DEFINE_TEST(tmpdir, process, "--test_filter=tmpdir.create", "--test_tmpdir_root=/tmp")
+{
+    char parent[4096], child[4096] = { 0 };
+    TEST_PORTING_ASSERT(_TEST.rret == 0);
+    snprintf(parent, sizeof(parent), "%s", s_path);
+
+    int fds[2];
+    TEST_PORTING_ASSERT(pipe(fds) == 0);
+    pid_t pid = fork();
+    TEST_PORTING_ASSERT(pid >= 0);
+    if (pid == 0)
+    {
+        char* argv[] = { _TEST.argv[0], "--test_filter=tmpdir.create", "--test_tmpdir_root=/tmp", NULL };
+        FILE* out = fopen("/dev/null", "w");
+        int ret = cutest_run_tests(3, argv, out, NULL);
+        ssize_t len = write(fds[1], s_path, strlen(s_path));
+        _exit(ret == 0 && len > 0 ? 0 : 1);
+    }
+    close(fds[1]);
+    TEST_PORTING_ASSERT(read(fds[0], child, sizeof(child) - 1) > 0);
+    close(fds[0]);
+
+    int status;
+    TEST_PORTING_ASSERT(waitpid(pid, &status, 0) == pid);
+    TEST_PORTING_ASSERT(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+    TEST_PORTING_ASSERT(strncmp(child, "/tmp/cutest-", 12) == 0);
+    TEST_PORTING_ASSERT(strcmp(child, parent) != 0);
+}
+
+DEFINE_TEST(tmpdir, bad_root, "--test_filter=tmpdir.create", "--test_tmpdir_root=/nonexistent/cutest")
+{
+    TEST_PORTING_ASSERT(_TEST.rret == 1);
+
+    string_matrix_t* matrix = string_matrix_create_from_file(_TEST.out, "\n");
+    TEST_PORTING_ASSERT(string_matrix_count(matrix, "[  FAILED  ] tmpdir.create") == 2);
+    string_matrix_destroy(matrix);
+}
@@ -0,0 +1,145 @@
+#include "test.h"
+#include <pthread.h>
+#include <unistd.h>
+
+#define NS_PER_SEC  1000000000ULL
+
+static double s_real_ms;
+static unsigned long long s_worker_wake;
+static unsigned long long s_worker_start;
+static unsigned long long s_hook_beg;
+static pthread_t s_hook_thread;
+
+static double _real_ms_since(const cutest_porting_timespec_t* beg)
+{
+    cutest_porting_timespec_t end;
+    cutest_porting_clock_gettime(&end);
+    return (double)(end.tv_sec - beg->tv_sec) * 1000.0 + (double)(end.tv_nsec - beg->tv_nsec) / 1000000.0;
+}
+
+static void* _worker_proc(void* arg)
+{
+    unsigned long long beg = *(unsigned long long*)arg;
+    cutest_sleep(2 * NS_PER_SEC);
+    s_worker_wake = cutest_now() - beg;
+    cutest_time_detach();
+    return NULL;
+}
+
+/* Attached before all tests, and busy for a while before it sleeps. */
+static void* _hook_worker_proc(void* arg)
+{
+    (void)arg;
+    usleep(50 * 1000);
+    s_worker_start = cutest_now() - s_hook_beg;
+    cutest_sleep(2 * NS_PER_SEC);
+    s_worker_wake = cutest_now() - s_hook_beg;
+    cutest_time_detach();
+    return NULL;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Watchpoint
+///////////////////////////////////////////////////////////////////////////////
+
+TEST(virtual_time, hour)
+{
+    cutest_porting_timespec_t tv;
+    cutest_porting_clock_gettime(&tv);
+
+    unsigned long long beg = cutest_now();
+    cutest_sleep(3600 * NS_PER_SEC);
+    ASSERT_EQ_ULONGLONG(cutest_now() - beg, 3600 * NS_PER_SEC);
+
+    s_real_ms = _real_ms_since(&tv);
+}
+
+TEST(virtual_time, real)
+{
+    unsigned long long beg = cutest_now();
+    cutest_sleep(10 * 1000000ULL);
+    ASSERT_GE_ULONGLONG(cutest_now() - beg, 10 * 1000000ULL);
+}
+
+TEST(virtual_time, thread)
+{
+    pthread_t thread;
+    unsigned long long beg = cutest_now();
+
+    cutest_time_attach();
+    ASSERT_EQ_INT(pthread_create(&thread, NULL, _worker_proc, &beg), 0);
+
+    cutest_sleep(1 * NS_PER_SEC);
+    ASSERT_EQ_ULONGLONG(cutest_now() - beg, 1 * NS_PER_SEC);
+
+    /* Worker wakes up first and detaches, then the clock moves on without it. */
+    cutest_sleep(5 * NS_PER_SEC);
+    ASSERT_EQ_ULONGLONG(cutest_now() - beg, 6 * NS_PER_SEC);
+
+    pthread_join(thread, NULL);
+    ASSERT_EQ_ULONGLONG(s_worker_wake, 2 * NS_PER_SEC);
+}
+
+TEST(virtual_time, hook)
+{
+    /* The clock must wait for the worker attached in the hook. */
+    cutest_sleep(1 * NS_PER_SEC);
+    ASSERT_EQ_ULONGLONG(cutest_now() - s_hook_beg, 1 * NS_PER_SEC);
+
+    cutest_sleep(5 * NS_PER_SEC);
+    pthread_join(s_hook_thread, NULL);
+    ASSERT_EQ_ULONGLONG(s_worker_start, 0ULL);
+    ASSERT_EQ_ULONGLONG(s_worker_wake, 2 * NS_PER_SEC);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Verify
+///////////////////////////////////////////////////////////////////////////////
+
+DEFINE_TEST(virtual_time, hour, "--test_filter=virtual_time.hour", "--test_virtual_time")
+{
+    TEST_PORTING_ASSERT(_TEST.rret == 0);
+    TEST_PORTING_ASSERT(s_real_ms < 1000);
+
+    string_matrix_t* matrix = string_matrix_create_from_file(_TEST.out, "\n");
+    TEST_PORTING_ASSERT(string_matrix_count(matrix, "[ $PARAME. ] --test_virtual_time") == 1);
+    string_matrix_destroy(matrix);
+}
+
+DEFINE_TEST(virtual_time, real, "--test_filter=virtual_time.real")
+{
+    TEST_PORTING_ASSERT(_TEST.rret == 0);
+
+    string_matrix_t* matrix = string_matrix_create_from_file(_TEST.out, "\n");
+    TEST_PORTING_ASSERT(string_matrix_count(matrix, "--test_virtual_time") == 0);
+    string_matrix_destroy(matrix);
+}
+
+DEFINE_TEST(virtual_time, thread, "--test_filter=virtual_time.thread", "--test_virtual_time")
+{
+    TEST_PORTING_ASSERT(_TEST.rret == 0);
+}
+
+static void _before_all_test(int argc, char* argv[])
+{
+    (void)argc; (void)argv;
+    s_hook_beg = cutest_now();
+    cutest_time_attach();
+    TEST_PORTING_ASSERT(pthread_create(&s_hook_thread, NULL, _hook_worker_proc, NULL) == 0);
+}
+
+DEFINE_TEST_SETUP(virtual_time)
+{
+    _TEST.hook.before_all_test = _before_all_test;
+    s_worker_start = 0;
+    s_worker_wake = 0;
+}
+
+DEFINE_TEST_TEARDOWN(virtual_time)
+{
+}
+
+DEFINE_TEST_F(virtual_time, hook, "--test_filter=virtual_time.hook", "--test_virtual_time")
+{
+    TEST_PORTING_ASSERT(_TEST.rret == 0);
+}
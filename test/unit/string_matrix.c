@@ -202,3 +202,31 @@ const char* string_matrix_access(string_matrix_t* matrix, size_t line, size_t ra
 {
     return matrix->line[line].rank[rank].data;
 }
+
+size_t string_matrix_count(string_matrix_t* matrix, const char* str)
+{
+    size_t i, cnt = 0;
+    for (i = 0; i < matrix->line_sz; i++)
+    {
+        const char* line = string_matrix_access(matrix, i, 0);
+        if (line != NULL && strstr(line, str) != NULL)
+        {
+            cnt++;
+        }
+    }
+    return cnt;
+}
+
+const char* string_matrix_find(string_matrix_t* matrix, const char* str)
+{
+    size_t i;
+    for (i = 0; i < matrix->line_sz; i++)
+    {
+        const char* line = string_matrix_access(matrix, i, 0);
+        if (line != NULL && strstr(line, str) != NULL)
+        {
+            return line;
+        }
+    }
+    return NULL;
+}
@@ -63,6 +63,22 @@ void string_matrix_destroy(string_matrix_t* matrix);
  */
 const char* string_matrix_access(string_matrix_t* matrix, size_t line, size_t rank);
 
+/**
+ * @brief Count lines that contain \p str.
+ * @param[in] matrix    String matrix.
+ * @param[in] str       Substring to search.
+ * @return              The number of lines.
+ */
+size_t string_matrix_count(string_matrix_t* matrix, const char* str);
+
+/**
+ * @brief Find the first line that contains \p str.
+ * @param[in] matrix    String matrix.
+ * @param[in] str       Substring to search.
+ * @return              The line, or NULL if not found.
+ */
+const char* string_matrix_find(string_matrix_t* matrix, const char* str);
+
 #ifdef __cplusplus
 }
 #endif
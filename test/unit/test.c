@@ -17,6 +17,20 @@ void test_register_case(test_case_t* test_case)
     _TEST.tail = test_case;
 }
 
+static void _on_capture_result(const cutest_result_t* result)
+{
+    _TEST.result = *result;
+    snprintf(_TEST.result_name, sizeof(_TEST.result_name), "%s", result->full_name);
+    _TEST.result.full_name = _TEST.result_name;
+    _TEST.result_cnt++;
+}
+
+void test_capture_result(void)
+{
+    _TEST.hook_ex.version = CUTEST_HOOK_EX_VERSION;
+    _TEST.hook_ex.after_test = _on_capture_result;
+}
+
 static void _run_test(test_case_t* test_case)
 {
     if (test_case->setup != NULL)
@@ -72,6 +86,10 @@ static void _reset_runtime(void)
 {
     _reset_tmpfile();
     memset(&_TEST.hook, 0, sizeof(_TEST.hook));
+    memset(&_TEST.hook_ex, 0, sizeof(_TEST.hook_ex));
+    memset(&_TEST.result, 0, sizeof(_TEST.result));
+    _TEST.result_name[0] = '\0';
+    _TEST.result_cnt = 0;
 }
 
 int main(int argc, char* argv[])
@@ -48,7 +48,9 @@
             NULL\
         };\
         int argc = sizeof(argv) / sizeof(argv[0]) - 1;\
-        _TEST.rret = cutest_run_tests(argc, argv, _TEST.out, &_TEST.hook);\
+        _TEST.rret = _TEST.hook_ex.version == 0 ?\
+            cutest_run_tests(argc, argv, _TEST.out, &_TEST.hook) :\
+            cutest_run_tests_ex(argc, argv, _TEST.out, &_TEST.hook, &_TEST.hook_ex);\
         fn();\
     }
 
@@ -93,8 +95,13 @@ typedef struct test_runtime_s
 
     test_case_t*        cur;        /**< Current running test. */
     cutest_hook_t       hook;
+    cutest_hook_ex_t    hook_ex;    /**< Only used if version is set. */
     FILE*               out;
 
+    cutest_result_t     result;     /**< The last result, see #test_capture_result(). */
+    char                result_name[64];    /**< Copy of #cutest_result_t::full_name. */
+    unsigned            result_cnt; /**< The number of results captured. */
+
     int                 rret;       /**< Run result. */
 } test_runtime_t;
 
@@ -113,6 +120,12 @@ void test_register_case(test_case_t* test_case);
  */
 void test_print_file(FILE* dst, FILE* src);
 
+/**
+ * @brief Save the result of each test into #test_runtime_t::result through the
+ *   extended hook. Call it in DEFINE_TEST_SETUP().
+ */
+void test_capture_result(void);
+
 void cutest_porting_assert_fail_2(const char* expr, const char* file, int line, const char* func);
 
 #ifdef __cplusplus